@@ -0,0 +1,136 @@
+// AllocTracker.cpp - Global operator new/delete replacement for AllocTracker
+//
+// Only active when compiled with -DRIDESHARE_TRACK_ALLOCATIONS; otherwise
+// this translation unit is empty and the standard allocator is untouched.
+
+#include "AllocTracker.h"
+
+#ifdef RIDESHARE_TRACK_ALLOCATIONS
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Every block carries a 16-byte header (keeps malloc's 16-byte alignment)
+// recording its size and the tag it was charged to, so frees can be
+// attributed without a lookup table.
+struct BlockHeader {
+    std::size_t size;
+    std::uint32_t tag;
+    std::uint32_t epoch; // AllocTracker epoch it was counted in; 0 = not counted
+};
+
+static_assert(sizeof(BlockHeader) == 16, "header must preserve 16-byte alignment");
+
+struct Installer {
+    Installer() { AllocTracker::markInstalled(); }
+};
+
+Installer installer;
+
+// Fill the header that sits just before `user` and count the block.
+void* recordBlock(void* user, std::size_t size) {
+    BlockHeader* header = static_cast<BlockHeader*>(user) - 1;
+    header->size = size;
+    header->tag = static_cast<std::uint32_t>(AllocTracker::currentTag());
+    header->epoch = AllocTracker::isEnabled() ? AllocTracker::currentEpoch() : 0u;
+    if (header->epoch != 0) {
+        AllocTracker::onAllocate(static_cast<AllocTag>(header->tag), size);
+    }
+    return user;
+}
+
+// Uncount a block and return its header.
+BlockHeader* releaseBlock(void* p) {
+    BlockHeader* header = static_cast<BlockHeader*>(p) - 1;
+    if (header->epoch == AllocTracker::currentEpoch()) {
+        AllocTracker::onFree(static_cast<AllocTag>(header->tag), header->size);
+    }
+    return header;
+}
+
+void* trackedAllocate(std::size_t size) {
+    void* raw = std::malloc(sizeof(BlockHeader) + size);
+    if (raw == nullptr) {
+        return nullptr;
+    }
+    return recordBlock(static_cast<BlockHeader*>(raw) + 1, size);
+}
+
+void trackedFree(void* p) {
+    if (p == nullptr) {
+        return;
+    }
+    std::free(releaseBlock(p));
+}
+
+// Over-aligned blocks (alignas above 16, e.g. cache-line padded counters):
+// the user pointer sits `alignment` bytes into an aligned_alloc block, so
+// it stays aligned and the header still fits just before it.
+void* trackedAllocateAligned(std::size_t size, std::align_val_t align) {
+    std::size_t alignment = static_cast<std::size_t>(align);
+    if (alignment < sizeof(BlockHeader)) {
+        alignment = sizeof(BlockHeader);
+    }
+    std::size_t total = (alignment + size + alignment - 1) & ~(alignment - 1); // aligned_alloc wants a multiple
+    void* raw = std::aligned_alloc(alignment, total);
+    if (raw == nullptr) {
+        return nullptr;
+    }
+    return recordBlock(static_cast<char*>(raw) + alignment, size);
+}
+
+void trackedFreeAligned(void* p, std::align_val_t align) {
+    if (p == nullptr) {
+        return;
+    }
+    std::size_t alignment = static_cast<std::size_t>(align);
+    if (alignment < sizeof(BlockHeader)) {
+        alignment = sizeof(BlockHeader);
+    }
+    releaseBlock(p);
+    std::free(static_cast<char*>(p) - alignment);
+}
+
+} // namespace
+
+// GCC flags free() on memory from operator new once the replacements are
+// inlined into callers; both sides are ours, so the pairing is correct.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size) {
+    if (void* p = trackedAllocate(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    trackedFree(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    trackedFree(p);
+}
+
+// The aligned forms are replaced too, or over-aligned types would bypass
+// the tracer. The nothrow and array forms forward to these by default.
+void* operator new(std::size_t size, std::align_val_t align) {
+    if (void* p = trackedAllocateAligned(size, align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t align) noexcept {
+    trackedFreeAligned(p, align);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t align) noexcept {
+    trackedFreeAligned(p, align);
+}
+
+#endif // RIDESHARE_TRACK_ALLOCATIONS
@@ -0,0 +1,191 @@
+// AllocTracker.h - Opt-in heap allocation tracing per subsystem
+
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+
+// Subsystems that allocations are charged to.
+enum class AllocTag : std::uint8_t {
+    Untagged,
+    RideCreation, // Ride objects and their strings
+    History,      // growth of assignedRides / requestedRides
+    Reporting,    // rideDetails, getDriverInfo, viewRides
+    Dispatch      // DriverPool, RideTimeouts, ScheduledRideQueue bookkeeping
+};
+
+constexpr std::size_t ALLOC_TAG_COUNT = 5;
+
+inline const char* allocTagName(AllocTag tag) {
+    static constexpr const char* NAMES[ALLOC_TAG_COUNT] = {
+        "untagged", "ride creation", "history", "reporting", "dispatch"
+    };
+    return NAMES[static_cast<std::size_t>(tag)];
+}
+
+struct AllocStats {
+    std::uint64_t allocations = 0;
+    std::uint64_t frees = 0;
+    std::uint64_t bytesAllocated = 0;
+    std::uint64_t liveBytes = 0;
+    std::uint64_t peakLiveBytes = 0; // high-water mark of liveBytes
+};
+
+// Live counters for one tag, on their own cache line.
+struct alignas(64) AllocCounters {
+    std::atomic<std::uint64_t> allocations{0};
+    std::atomic<std::uint64_t> frees{0};
+    std::atomic<std::uint64_t> bytesAllocated{0};
+    std::atomic<std::uint64_t> liveBytes{0};
+    std::atomic<std::uint64_t> peakLiveBytes{0};
+};
+
+// Per-subsystem allocation counters.
+//
+// The counting itself lives in AllocTracker.cpp, which replaces the global
+// operator new/delete when compiled with -DRIDESHARE_TRACK_ALLOCATIONS
+// (without it the file is empty and nothing is replaced). Code only marks
+// which subsystem it is working for with an AllocScope; that costs a
+// thread-local store whether or not tracking is compiled in.
+//
+// Counting starts once enable(true) is called. Frees are charged to the tag
+// the block was allocated under, so live bytes stay exact per subsystem.
+class AllocTracker {
+private:
+    using Counters = AllocCounters;
+
+    inline static std::array<Counters, ALLOC_TAG_COUNT> counters;
+    inline static std::atomic<bool> enabled{false};
+    inline static std::atomic<bool> installed{false};
+    inline static std::atomic<std::uint32_t> epoch{1}; // bumped by reset()
+
+public:
+    // Subsystem the calling thread is currently allocating for.
+    static AllocTag& currentTag() {
+        thread_local AllocTag tag = AllocTag::Untagged;
+        return tag;
+    }
+
+    static void enable(bool on) {
+        enabled.store(on, std::memory_order_relaxed);
+    }
+
+    static bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    // True when AllocTracker.cpp was built with tracking and is replacing
+    // operator new/delete in this program.
+    static bool isInstalled() {
+        return installed.load(std::memory_order_relaxed);
+    }
+
+    // Blocks remember the epoch they were counted in; reset() starts a new
+    // one so blocks from before the reset are not subtracted when freed.
+    static std::uint32_t currentEpoch() {
+        return epoch.load(std::memory_order_relaxed);
+    }
+
+    static void markInstalled() {
+        installed.store(true, std::memory_order_relaxed);
+    }
+
+    static void onAllocate(AllocTag tag, std::size_t size) {
+        Counters& c = counters[static_cast<std::size_t>(tag)];
+        c.allocations.fetch_add(1, std::memory_order_relaxed);
+        c.bytesAllocated.fetch_add(size, std::memory_order_relaxed);
+        std::uint64_t live = c.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+        std::uint64_t peak = c.peakLiveBytes.load(std::memory_order_relaxed);
+        while (live > peak && !c.peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+    }
+
+    static void onFree(AllocTag tag, std::size_t size) {
+        Counters& c = counters[static_cast<std::size_t>(tag)];
+        c.frees.fetch_add(1, std::memory_order_relaxed);
+        c.liveBytes.fetch_sub(size, std::memory_order_relaxed);
+    }
+
+    static AllocStats stats(AllocTag tag) {
+        const Counters& c = counters[static_cast<std::size_t>(tag)];
+        AllocStats s;
+        s.allocations = c.allocations.load(std::memory_order_relaxed);
+        s.frees = c.frees.load(std::memory_order_relaxed);
+        s.bytesAllocated = c.bytesAllocated.load(std::memory_order_relaxed);
+        s.liveBytes = c.liveBytes.load(std::memory_order_relaxed);
+        s.peakLiveBytes = c.peakLiveBytes.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    // Sum over all tags (the peak is the sum of per-tag peaks, an upper bound).
+    static AllocStats totals() {
+        AllocStats total;
+        for (std::size_t i = 0; i < ALLOC_TAG_COUNT; ++i) {
+            AllocStats s = stats(static_cast<AllocTag>(i));
+            total.allocations += s.allocations;
+            total.frees += s.frees;
+            total.bytesAllocated += s.bytesAllocated;
+            total.liveBytes += s.liveBytes;
+            total.peakLiveBytes += s.peakLiveBytes;
+        }
+        return total;
+    }
+
+    // Zero the counters. Live bytes restart from zero, so blocks that were
+    // already allocated are no longer counted when freed.
+    static void reset() {
+        std::uint32_t next = epoch.load(std::memory_order_relaxed) + 1;
+        epoch.store(next == 0 ? 1 : next, std::memory_order_relaxed);
+        for (Counters& c : counters) {
+            c.allocations.store(0, std::memory_order_relaxed);
+            c.frees.store(0, std::memory_order_relaxed);
+            c.bytesAllocated.store(0, std::memory_order_relaxed);
+            c.liveBytes.store(0, std::memory_order_relaxed);
+            c.peakLiveBytes.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    static void report(std::ostream& out) {
+        if (!isInstalled()) {
+            out << "allocation tracking not compiled in (build with -DRIDESHARE_TRACK_ALLOCATIONS)" << std::endl;
+            return;
+        }
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-14s %12s %12s %14s %14s %14s",
+                      "subsystem", "allocs", "frees", "bytes", "live bytes", "peak live");
+        out << line << std::endl;
+        for (std::size_t i = 0; i < ALLOC_TAG_COUNT; ++i) {
+            AllocStats s = stats(static_cast<AllocTag>(i));
+            std::snprintf(line, sizeof(line), "%-14s %12llu %12llu %14llu %14llu %14llu",
+                          allocTagName(static_cast<AllocTag>(i)),
+                          static_cast<unsigned long long>(s.allocations),
+                          static_cast<unsigned long long>(s.frees),
+                          static_cast<unsigned long long>(s.bytesAllocated),
+                          static_cast<unsigned long long>(s.liveBytes),
+                          static_cast<unsigned long long>(s.peakLiveBytes));
+            out << line << std::endl;
+        }
+    }
+};
+
+// Charges allocations made in the enclosing scope (on this thread) to a tag.
+class AllocScope {
+private:
+    AllocTag previous;
+
+public:
+    explicit AllocScope(AllocTag tag) : previous(AllocTracker::currentTag()) {
+        AllocTracker::currentTag() = tag;
+    }
+
+    ~AllocScope() {
+        AllocTracker::currentTag() = previous;
+    }
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+};
@@ -0,0 +1,513 @@
+// CitySimulator.h - Discrete-event city simulation on the ride model
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+#include "Ride.h"
+#include "Driver.h"
+#include "Rider.h"
+#include "DriverPool.h"
+#include "RideTimeouts.h"
+#include "SimEventQueue.h"
+#include "Workload.h"
+#include "SurgeEngine.h"
+#include "Leaderboard.h"
+#include "Sketches.h"
+#include "Metrics.h"
+
+struct SimulationConfig {
+    WorkloadConfig workload;
+    TimestampMs durationMs = 8 * 60 * 60 * 1000; // virtual time to simulate
+    std::uint32_t gridSize = 8;                   // dispatch regions per side of the city
+    double speedMph = 18.0;                       // average driving speed
+    TimestampMs acceptDelayMs = 8 * 1000;         // matched driver accepts the ride
+    TimeoutPolicy timeouts;                       // unserved requests cancel after matchTimeoutMs
+    std::size_t candidateLimit = 8;               // free drivers compared per region
+    std::uint32_t district = 0;                   // metrics label (runPartitioned sets it)
+    bool surge = false;                           // price rides with per-region surge
+    SurgeConfig surgeConfig;
+    TimestampMs surgeTickMs = 5 * 1000;           // surge recomputed this often
+    bool leaderboards = false;                    // keep per-region driver leaderboards
+    bool sketches = false;                        // feed requests to SimulationStats::sketches
+};
+
+struct SimulationStats {
+    std::uint64_t events = 0;
+    std::uint64_t requested = 0;
+    std::uint64_t premium = 0;
+    std::uint64_t completed = 0;
+    std::uint64_t cancelled = 0;
+    std::uint64_t surged = 0;    // requests priced above 1.0x
+    double peakSurge = 1.0;
+    std::uint64_t ratingStars = 0; // stars given by riders, summed over completed rides
+    double revenue = 0.0;        // fares of completed rides
+    double waitMs = 0.0;         // request to pickup, summed over completed rides
+    double busyDriverMs = 0.0;   // match to drop-off, summed over completed rides
+    std::size_t driverCount = 0;
+    TimestampMs simulatedMs = 0;
+    double loopSeconds = 0.0;    // wall time of the event loop alone, without setup
+    RideSketches sketches; // distinct riders, top routes, fare quantiles (config.sketches)
+
+    void merge(const SimulationStats& other) {
+        events += other.events;
+        requested += other.requested;
+        premium += other.premium;
+        completed += other.completed;
+        cancelled += other.cancelled;
+        surged += other.surged;
+        peakSurge = other.peakSurge > peakSurge ? other.peakSurge : peakSurge;
+        ratingStars += other.ratingStars;
+        revenue += other.revenue;
+        waitMs += other.waitMs;
+        busyDriverMs += other.busyDriverMs;
+        driverCount += other.driverCount;
+        simulatedMs = other.simulatedMs > simulatedMs ? other.simulatedMs : simulatedMs;
+        loopSeconds = other.loopSeconds > loopSeconds ? other.loopSeconds : loopSeconds; // shards run in parallel
+        sketches.merge(other.sketches);
+    }
+
+    double meanRating() const {
+        return completed == 0 ? 0.0 : static_cast<double>(ratingStars) / completed;
+    }
+
+    double meanWaitSeconds() const {
+        return completed == 0 ? 0.0 : waitMs / completed / 1000.0;
+    }
+
+    double driverUtilisation() const {
+        double capacity = static_cast<double>(driverCount) * static_cast<double>(simulatedMs);
+        return capacity == 0.0 ? 0.0 : busyDriverMs / capacity;
+    }
+};
+
+// Advances virtual time through a city's ride traffic one event at a time:
+// requests arrive from the workload generator, are dispatched to the nearest
+// free driver in their region (or the neighbouring ones), and move through
+// Matched -> En Route -> In Progress -> Completed as the driver accepts,
+// drives to the pickup and carries the rider to the drop-off. Requests no
+// driver picks up within the match timeout are cancelled. Drivers end each
+// trip at the drop-off, so supply drifts around the city with demand.
+// With config.surge, each region's requests and free drivers feed a
+// SurgeEngine recomputed every surgeTickMs, and new rides are priced at
+// their pickup region's multiplier. With config.leaderboards, drivers are
+// re-ranked in the region where each trip ends (see DriverLeaderboards).
+//
+// Riders own their rides through Rider::requestRide and drivers receive a
+// completed copy through Driver::addRide, as in the demo; riders then rate
+// the driver by how long they waited for pickup. Both calls print, so
+// wrap long runs in QuietCout. A simulator is single-threaded; see
+// runPartitioned() for the parallel mode.
+class CitySimulator {
+private:
+    enum EventKind : std::uint32_t {
+        RIDE_REQUEST,
+        DRIVER_ACCEPTS,
+        DRIVER_ARRIVES,
+        TRIP_COMPLETES,
+        MATCH_TIMEOUT,
+        SURGE_TICK
+    };
+
+    // An in-flight ride. Slots are recycled; the generation tells stale
+    // timeout events and waiting-list entries apart from the current trip.
+    struct Trip {
+        Ride* ride = nullptr; // owned by the rider
+        std::uint32_t pickup = 0;
+        std::uint32_t dropoff = 0;
+        DriverIndex driver = INVALID_DRIVER_INDEX;
+        std::uint32_t generation = 0;
+        bool premium = false;
+        double surge = 1.0;
+    };
+
+    struct WaitingRide {
+        std::uint32_t trip;
+        std::uint32_t generation;
+    };
+
+    SimulationConfig config;
+    WorkloadGenerator generator;
+    SimEventQueue events;
+    std::vector<Rider> riders;
+    std::vector<Driver> drivers;
+    std::vector<std::uint32_t> driverLocation;
+    DriverPool pool;
+    SurgeEngine surge; // zones are the dispatch regions
+    DriverLeaderboards leaderboards; // no regions unless config.leaderboards
+    std::vector<Trip> trips;
+    std::vector<std::uint32_t> freeTrips;
+    std::vector<std::deque<WaitingRide>> waiting; // per region, oldest first
+    std::vector<std::uint32_t> locationRegion;
+    std::vector<DriverIndex> candidates;
+    std::vector<DriverIndex> neighbourCandidates;
+    RideRequestEvent nextRequest;
+    TimestampMs endTime;
+    std::uint64_t rideCounter = 0;
+    SimulationStats stats;
+    ScopedGauge pendingEventsGauge;
+    ScopedGauge waitingRidesGauge;
+    ScopedGauge driversOnlineGauge;
+    ScopedGauge driversFreeGauge;
+
+    static constexpr std::uint64_t GAUGE_PUBLISH_EVENTS = 4096;
+
+    static std::string districtLabel(std::uint32_t district) {
+        return "district=\"" + std::to_string(district) + "\"";
+    }
+
+    // Queue depths and driver availability for a /metrics scrape. Waiting
+    // lists may hold entries that already timed out; they are counted until
+    // a free driver skips past them.
+    void publishGauges() {
+        std::size_t waitingCount = 0;
+        for (const std::deque<WaitingRide>& queue : waiting) {
+            waitingCount += queue.size();
+        }
+        pendingEventsGauge.set(static_cast<double>(events.size()));
+        waitingRidesGauge.set(static_cast<double>(waitingCount));
+        driversOnlineGauge.set(static_cast<double>(pool.onlineCount()));
+        driversFreeGauge.set(static_cast<double>(pool.freeCount()));
+    }
+
+    TimestampMs travelMs(double miles) const {
+        return static_cast<TimestampMs>(miles / config.speedMph * 3600.0 * 1000.0);
+    }
+
+    std::uint32_t regionOfPosition(float x, float y) const {
+        std::uint32_t column = static_cast<std::uint32_t>(x / 20.0f * config.gridSize);
+        std::uint32_t row = static_cast<std::uint32_t>(y / 20.0f * config.gridSize);
+        column = column < config.gridSize ? column : config.gridSize - 1;
+        row = row < config.gridSize ? row : config.gridSize - 1;
+        return row * config.gridSize + column;
+    }
+
+    void placeDriver(DriverIndex d, std::uint32_t location) {
+        driverLocation[d] = location;
+        pool.moveToRegion(d, locationRegion[location]);
+    }
+
+    // Nearest of up to candidateLimit free drivers in the pickup's region,
+    // widening to the eight neighbouring regions if that one is empty.
+    DriverIndex findDriver(std::uint32_t pickup) {
+        std::uint32_t region = locationRegion[pickup];
+        pool.findCandidates(region, config.candidateLimit, candidates);
+        if (candidates.empty()) {
+            std::int64_t row = region / config.gridSize;
+            std::int64_t column = region % config.gridSize;
+            for (std::int64_t dr = -1; dr <= 1; ++dr) {
+                for (std::int64_t dc = -1; dc <= 1; ++dc) {
+                    std::int64_t r = row + dr;
+                    std::int64_t c = column + dc;
+                    if ((dr == 0 && dc == 0) || r < 0 || c < 0 || r >= config.gridSize || c >= config.gridSize) {
+                        continue;
+                    }
+                    pool.findCandidates(static_cast<std::uint32_t>(r * config.gridSize + c), config.candidateLimit,
+                                        neighbourCandidates);
+                    candidates.insert(candidates.end(), neighbourCandidates.begin(), neighbourCandidates.end());
+                }
+            }
+        }
+        DriverIndex best = INVALID_DRIVER_INDEX;
+        double bestMiles = 0.0;
+        for (DriverIndex d : candidates) {
+            double miles = generator.routeDistance(driverLocation[d], pickup);
+            if (best == INVALID_DRIVER_INDEX || miles < bestMiles) {
+                best = d;
+                bestMiles = miles;
+            }
+        }
+        return best;
+    }
+
+    void assign(std::uint32_t slot, DriverIndex d, TimestampMs now) {
+        Trip& trip = trips[slot];
+        trip.driver = d;
+        trip.ride->transitionTo(RideStatus::Matched, now);
+        pool.setBusy(d, true);
+        surge.driverTaken(pool.regionOf(d));
+        events.push(now + config.acceptDelayMs, DRIVER_ACCEPTS, slot, trip.generation);
+    }
+
+    void releaseTrip(std::uint32_t slot) {
+        Trip& trip = trips[slot];
+        trip.ride = nullptr;
+        trip.driver = INVALID_DRIVER_INDEX;
+        ++trip.generation;
+        freeTrips.push_back(slot);
+    }
+
+    void onRideRequest(TimestampMs now) {
+        const RideRequestEvent& request = nextRequest;
+        std::uint32_t slot;
+        if (freeTrips.empty()) {
+            slot = static_cast<std::uint32_t>(trips.size());
+            trips.emplace_back();
+        } else {
+            slot = freeTrips.back();
+            freeTrips.pop_back();
+        }
+        Trip& trip = trips[slot];
+        trip.pickup = request.pickup;
+        trip.dropoff = request.dropoff;
+        trip.premium = request.premium;
+        std::uint32_t region = locationRegion[request.pickup];
+
+        std::string rideID = "S" + std::to_string(rideCounter++);
+        const std::string& pickup = generator.locationName(request.pickup);
+        const std::string& dropoff = generator.locationName(request.dropoff);
+        std::unique_ptr<Ride> ride;
+        if (request.premium) {
+            ride = std::make_unique<PremiumRide>(rideID, pickup, dropoff, request.distance, now);
+            ++stats.premium;
+        } else {
+            ride = std::make_unique<StandardRide>(rideID, pickup, dropoff, request.distance, now);
+        }
+        trip.surge = 1.0;
+        if (config.surge) {
+            surge.recordRequest(region);
+            trip.surge = surge.multiplier(region);
+            ride->applySurge(trip.surge);
+            stats.surged += trip.surge > 1.0 ? 1 : 0;
+        }
+        if (config.sketches) {
+            // Riders are numbered per district, so the district keeps them apart.
+            std::uint64_t rider = (std::uint64_t(config.district) << 32) | request.riderIndex;
+            stats.sketches.record(sketchHash(rider), pickup, dropoff, ride->getFare());
+        }
+        trip.ride = ride.get();
+        riders[request.riderIndex].requestRide(std::move(ride));
+        ++stats.requested;
+
+        DriverIndex d = findDriver(trip.pickup);
+        if (d != INVALID_DRIVER_INDEX) {
+            assign(slot, d, now);
+        } else {
+            waiting[region].push_back(WaitingRide{slot, trip.generation});
+            events.push(now + config.timeouts.matchTimeoutMs, MATCH_TIMEOUT, slot, trip.generation);
+        }
+
+        nextRequest = generator.next();
+        if (nextRequest.timestamp <= endTime) {
+            events.push(nextRequest.timestamp, RIDE_REQUEST, 0);
+        }
+    }
+
+    void onDriverAccepts(std::uint32_t slot, TimestampMs now) {
+        Trip& trip = trips[slot];
+        trip.ride->transitionTo(RideStatus::EnRoute, now);
+        double miles = generator.routeDistance(driverLocation[trip.driver], trip.pickup);
+        events.push(now + travelMs(miles), DRIVER_ARRIVES, slot, trip.generation);
+    }
+
+    void onDriverArrives(std::uint32_t slot, TimestampMs now) {
+        Trip& trip = trips[slot];
+        trip.ride->transitionTo(RideStatus::InProgress, now);
+        placeDriver(trip.driver, trip.pickup);
+        events.push(now + travelMs(generator.routeDistance(trip.pickup, trip.dropoff)), TRIP_COMPLETES, slot,
+                    trip.generation);
+    }
+
+    void onTripCompletes(std::uint32_t slot, TimestampMs now) {
+        Trip& trip = trips[slot];
+        Ride& ride = *trip.ride;
+        ride.transitionTo(RideStatus::Completed, now);
+        TimestampMs requestedAt = ride.getRequestedAt();
+        TimestampMs matchedAt = ride.getStatusTime(RideStatus::Matched);
+        ++stats.completed;
+        stats.revenue += ride.getFare();
+        stats.waitMs += static_cast<double>(ride.getStatusTime(RideStatus::InProgress) - requestedAt);
+        stats.busyDriverMs += static_cast<double>(now - matchedAt);
+
+        // The driver's history gets its own completed record, as in the demo.
+        std::unique_ptr<Ride> record;
+        const std::string& pickup = generator.locationName(trip.pickup);
+        const std::string& dropoff = generator.locationName(trip.dropoff);
+        double distance = generator.routeDistance(trip.pickup, trip.dropoff);
+        if (trip.premium) {
+            record = std::make_unique<PremiumRide>(ride.getRideID() + "-C", pickup, dropoff, distance, requestedAt);
+        } else {
+            record = std::make_unique<StandardRide>(ride.getRideID() + "-C", pickup, dropoff, distance, requestedAt);
+        }
+        record->applySurge(trip.surge);
+        record->transitionTo(RideStatus::Matched, matchedAt);
+        record->transitionTo(RideStatus::EnRoute, ride.getStatusTime(RideStatus::EnRoute));
+        record->transitionTo(RideStatus::InProgress, ride.getStatusTime(RideStatus::InProgress));
+        record->transitionTo(RideStatus::Completed, now);
+        DriverIndex d = trip.driver;
+        pool.driverAt(d).addRide(std::move(record));
+
+        // The rider rates the trip by how long they waited for pickup.
+        TimestampMs waited = ride.getStatusTime(RideStatus::InProgress) - requestedAt;
+        int stars = waited <= 5 * 60000 ? 5 : waited <= 10 * 60000 ? 4 : waited <= 20 * 60000 ? 3 : 2;
+        pool.driverAt(d).rate(stars);
+        stats.ratingStars += static_cast<std::uint64_t>(stars);
+
+        placeDriver(d, trip.dropoff);
+        if (config.leaderboards) {
+            leaderboards.update(d, pool.regionOf(d), pool.driverAt(d), now);
+        }
+        pool.setBusy(d, false);
+        surge.driverFreed(pool.regionOf(d));
+        releaseTrip(slot);
+        serveWaiting(d, now);
+    }
+
+    void onMatchTimeout(std::uint32_t slot, std::uint32_t generation, TimestampMs now) {
+        Trip& trip = trips[slot];
+        if (trip.generation != generation || trip.ride->getStatus() != RideStatus::Requested) {
+            return; // served, or the slot has been reused
+        }
+        trip.ride->transitionTo(RideStatus::Cancelled, now);
+        ++stats.cancelled;
+        releaseTrip(slot);
+    }
+
+    void onSurgeTick(TimestampMs now) {
+        double peak = surge.update();
+        stats.peakSurge = peak > stats.peakSurge ? peak : stats.peakSurge;
+        events.push(now + config.surgeTickMs, SURGE_TICK, 0);
+    }
+
+    // Hand a newly free driver the oldest waiting request in its region.
+    void serveWaiting(DriverIndex d, TimestampMs now) {
+        std::deque<WaitingRide>& queue = waiting[pool.regionOf(d)];
+        while (!queue.empty()) {
+            WaitingRide entry = queue.front();
+            queue.pop_front();
+            const Trip& trip = trips[entry.trip];
+            if (trip.generation == entry.generation && trip.ride->getStatus() == RideStatus::Requested) {
+                assign(entry.trip, d, now);
+                return;
+            }
+        }
+    }
+
+public:
+    explicit CitySimulator(const SimulationConfig& cfg)
+        : config(cfg),
+          generator(cfg.workload),
+          events(cfg.workload.startTime),
+          pool(static_cast<std::size_t>(cfg.gridSize) * cfg.gridSize),
+          surge(static_cast<std::size_t>(cfg.gridSize) * cfg.gridSize, cfg.surgeConfig),
+          leaderboards(cfg.leaderboards ? static_cast<std::size_t>(cfg.gridSize) * cfg.gridSize : 0),
+          waiting(static_cast<std::size_t>(cfg.gridSize) * cfg.gridSize),
+          endTime(cfg.workload.startTime + cfg.durationMs),
+          pendingEventsGauge("rideshare_sim_pending_events", "Events queued in the city simulator.",
+                             districtLabel(cfg.district)),
+          waitingRidesGauge("rideshare_sim_waiting_rides", "Requests queued for a free driver in the city simulator.",
+                            districtLabel(cfg.district)),
+          driversOnlineGauge("rideshare_drivers_online", "Drivers logged in.", districtLabel(cfg.district)),
+          driversFreeGauge("rideshare_drivers_free", "Drivers online and not on a trip.", districtLabel(cfg.district)) {
+        locationRegion.reserve(generator.locationCount());
+        for (std::uint32_t i = 0; i < generator.locationCount(); ++i) {
+            const std::pair<float, float>& position = generator.locationCoordinates(i);
+            locationRegion.push_back(regionOfPosition(position.first, position.second));
+        }
+        riders.reserve(cfg.workload.riderCount);
+        for (std::size_t i = 0; i < cfg.workload.riderCount; ++i) {
+            riders.emplace_back("R" + std::to_string(i), "Rider " + std::to_string(i));
+        }
+        drivers.reserve(cfg.workload.driverCount);
+        for (std::size_t i = 0; i < cfg.workload.driverCount; ++i) {
+            drivers.emplace_back("D" + std::to_string(i), "Driver " + std::to_string(i), 4.0 + (i % 10) / 10.0);
+        }
+        // Drivers start online, spread uniformly over the city's locations.
+        WorkloadRng placement(cfg.workload.seed ^ 0xD1B54A32D192ED03ull);
+        driverLocation.resize(drivers.size());
+        for (Driver& driver : drivers) {
+            DriverIndex d = pool.registerDriver(driver);
+            placeDriver(d, static_cast<std::uint32_t>(placement.below(generator.locationCount())));
+            pool.setOnline(d, true);
+            surge.driverFreed(pool.regionOf(d));
+            if (config.leaderboards) {
+                leaderboards.update(d, pool.regionOf(d), driver, cfg.workload.startTime);
+            }
+        }
+        stats.driverCount = drivers.size();
+        publishGauges();
+    }
+
+    CitySimulator(const CitySimulator&) = delete;
+    CitySimulator& operator=(const CitySimulator&) = delete;
+
+    // Simulate from the workload's start time to start + durationMs.
+    SimulationStats run() {
+        auto loopStart = std::chrono::steady_clock::now();
+        nextRequest = generator.next();
+        if (nextRequest.timestamp <= endTime) {
+            events.push(nextRequest.timestamp, RIDE_REQUEST, 0);
+        }
+        if (config.surge) {
+            events.push(config.workload.startTime + config.surgeTickMs, SURGE_TICK, 0);
+        }
+        SimEvent event;
+        while (events.pop(event) && event.time <= endTime) {
+            if (++stats.events % GAUGE_PUBLISH_EVENTS == 0) {
+                publishGauges();
+            }
+            switch (event.kind) {
+                case RIDE_REQUEST: onRideRequest(event.time); break;
+                case DRIVER_ACCEPTS: onDriverAccepts(event.subject, event.time); break;
+                case DRIVER_ARRIVES: onDriverArrives(event.subject, event.time); break;
+                case TRIP_COMPLETES: onTripCompletes(event.subject, event.time); break;
+                case MATCH_TIMEOUT:
+                    onMatchTimeout(event.subject, static_cast<std::uint32_t>(event.data), event.time);
+                    break;
+                case SURGE_TICK: onSurgeTick(event.time); break;
+            }
+        }
+        stats.simulatedMs = config.durationMs;
+        stats.loopSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loopStart).count();
+        publishGauges();
+        return stats;
+    }
+
+    const SimulationConfig& getConfig() const { return config; }
+    const WorkloadGenerator& getGenerator() const { return generator; }
+    const DriverPool& getPool() const { return pool; }
+    const SurgeEngine& getSurge() const { return surge; }
+    const DriverLeaderboards& getLeaderboards() const { return leaderboards; }
+};
+
+// Parallel mode: cut the city into `partitions` independent districts, each
+// with its share of riders, drivers, locations and demand and its own seed,
+// and simulate each on its own thread. Trips never cross districts, so the
+// shards need no synchronisation; results are deterministic for a given
+// partition count and merged at the end.
+inline SimulationStats runPartitioned(const SimulationConfig& config, std::size_t partitions) {
+    if (partitions <= 1) {
+        CitySimulator simulator(config);
+        return simulator.run();
+    }
+    std::vector<SimulationStats> results(partitions);
+    std::vector<std::thread> threads;
+    threads.reserve(partitions);
+    for (std::size_t p = 0; p < partitions; ++p) {
+        SimulationConfig district = config;
+        WorkloadConfig& w = district.workload;
+        w.seed = config.workload.seed + (p + 1) * 0x9E3779B97F4A7C15ull;
+        w.riderCount = w.riderCount / partitions > 0 ? w.riderCount / partitions : 1;
+        w.driverCount = w.driverCount / partitions > 0 ? w.driverCount / partitions : 1;
+        w.locationCount = w.locationCount / partitions > 2 ? w.locationCount / partitions : 2;
+        w.requestsPerSecond = w.requestsPerSecond / static_cast<double>(partitions);
+        district.district = static_cast<std::uint32_t>(p);
+        threads.emplace_back([district, &results, p] {
+            CitySimulator simulator(district);
+            results[p] = simulator.run();
+        });
+    }
+    SimulationStats merged;
+    for (std::size_t p = 0; p < partitions; ++p) {
+        threads[p].join();
+        merged.merge(results[p]);
+    }
+    return merged;
+}
@@ -0,0 +1,330 @@
+// Driver.h - Driver class
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory> // For std::unique_ptr
+#include <iomanip> // For std::fixed and std::setprecision
+#include <cstdint>
+#include <array>
+#include <atomic>
+
+#include "Ride.h"
+#include "LatencyHistogram.h"
+#include "AllocTracker.h"
+#include "Metrics.h"
+#include "RideHistory.h"
+
+// One UTC day of a driver's completed rides.
+struct DayEarnings {
+    std::int64_t day = -1; // days since the epoch; -1 = no rides that day
+    std::uint32_t rides = 0;
+    double fare = 0.0;
+    double distance = 0.0;
+};
+
+// Running earnings totals, updated as rides join a driver's history so that
+// queries cost O(1) however long the history is: ride count, fares and
+// distance overall and per tier, and per-day buckets for the last DAYS_KEPT
+// days a ride was recorded in (a ring indexed by day number; older days
+// still count in the totals). The ring (about 1 KiB) is allocated with the
+// driver's first ride, so idle drivers only pay for a pointer.
+class DriverEarnings {
+public:
+    static constexpr std::size_t DAYS_KEPT = 32;
+
+private:
+    std::uint64_t rideCount = 0;
+    double totalFare = 0.0;
+    double totalDistance = 0.0;
+    std::array<std::uint64_t, RIDE_TYPE_COUNT> tierRides{};
+    std::array<double, RIDE_TYPE_COUNT> tierFare{};
+    std::unique_ptr<std::array<DayEarnings, DAYS_KEPT>> days; // null until the first ride
+
+public:
+    // Count a ride on the day it completed (or was requested, if it has
+    // not completed).
+    void add(const Ride& ride) {
+        std::size_t tier = static_cast<std::size_t>(ride.getType());
+        double fare = ride.getFare();
+        double distance = ride.getDistance();
+        ++rideCount;
+        totalFare += fare;
+        totalDistance += distance;
+        ++tierRides[tier];
+        tierFare[tier] += fare;
+
+        TimestampMs at = ride.getStatusTime(RideStatus::Completed);
+        std::int64_t day = dayOf(at != 0 ? at : ride.getRequestedAt());
+        if (!days) {
+            days = std::make_unique<std::array<DayEarnings, DAYS_KEPT>>();
+        }
+        DayEarnings& bucket = (*days)[static_cast<std::uint64_t>(day) % DAYS_KEPT];
+        if (bucket.day != day) {
+            if (bucket.day > day) {
+                return; // a ride from a day that has already left the window
+            }
+            bucket = DayEarnings{day, 0, 0.0, 0.0};
+        }
+        ++bucket.rides;
+        bucket.fare += fare;
+        bucket.distance += distance;
+    }
+
+    std::uint64_t rides() const { return rideCount; }
+    double fare() const { return totalFare; }
+    double distance() const { return totalDistance; }
+    std::uint64_t rides(RideType type) const { return tierRides[static_cast<std::size_t>(type)]; }
+    double fare(RideType type) const { return tierFare[static_cast<std::size_t>(type)]; }
+
+    double averageFare() const {
+        return rideCount == 0 ? 0.0 : totalFare / static_cast<double>(rideCount);
+    }
+
+    // Earnings for one day; empty if the driver had no rides that day or it
+    // is older than the DAYS_KEPT most recent days.
+    DayEarnings onDay(std::int64_t day) const {
+        if (!days) {
+            return DayEarnings{day, 0, 0.0, 0.0};
+        }
+        const DayEarnings& bucket = (*days)[static_cast<std::uint64_t>(day) % DAYS_KEPT];
+        return bucket.day == day ? bucket : DayEarnings{day, 0, 0.0, 0.0};
+    }
+};
+
+// A driver's rider ratings, 1 to 5 stars, updated as they arrive from any
+// number of threads without locks:
+// - submit() is one relaxed fetch_add on the star's histogram bucket plus a
+//   compare-and-swap loop folding the rating into the last-ratings average
+// - count, mean and variance are derived from the histogram (sum and sum
+//   of squares of small integers), so they are exact and need no extra
+//   shared state; a reader racing with submissions may see some buckets
+//   before others, never a torn value
+// - lastRatingsAverage() is an exponentially weighted average in which
+//   each new rating has weight LAST_RATINGS_WEIGHT (about the last 20
+//   ratings). It is count-based, not time-based: it moves only when a
+//   rating arrives, so a driver who gets no ratings keeps their last value
+// The rating given at construction stands in for the mean and the
+// last-ratings average until the first rating arrives. The counters sit on
+// their own cache line so ratings for a popular driver don't contend with
+// the rest of the Driver. Copies (used only when driver lists grow) load each value.
+class DriverRatings {
+public:
+    static constexpr int MIN_STARS = 1;
+    static constexpr int MAX_STARS = 5;
+    static constexpr std::size_t STAR_LEVELS = MAX_STARS - MIN_STARS + 1;
+    static constexpr double LAST_RATINGS_WEIGHT = 0.05;
+
+private:
+    struct alignas(64) Cells {
+        std::array<std::atomic<std::uint64_t>, STAR_LEVELS> histogram{};
+        std::atomic<double> lastRatings{0.0};
+    };
+
+    Cells cells;
+    double initial;
+
+    void copyFrom(const DriverRatings& other) {
+        for (std::size_t i = 0; i < STAR_LEVELS; ++i) {
+            cells.histogram[i].store(other.cells.histogram[i].load(std::memory_order_relaxed),
+                                     std::memory_order_relaxed);
+        }
+        cells.lastRatings.store(other.cells.lastRatings.load(std::memory_order_relaxed),
+                                  std::memory_order_relaxed);
+        initial = other.initial;
+    }
+
+public:
+    explicit DriverRatings(double initialRating) : initial(initialRating) {
+        cells.lastRatings.store(initialRating, std::memory_order_relaxed);
+    }
+
+    DriverRatings(const DriverRatings& other) noexcept {
+        copyFrom(other);
+    }
+
+    DriverRatings& operator=(const DriverRatings& other) noexcept {
+        copyFrom(other);
+        return *this;
+    }
+
+    // Record one rating. Returns false (and records nothing) if `stars` is
+    // outside MIN_STARS..MAX_STARS.
+    bool submit(int stars) {
+        if (stars < MIN_STARS || stars > MAX_STARS) {
+            return false;
+        }
+        cells.histogram[static_cast<std::size_t>(stars - MIN_STARS)].fetch_add(1, std::memory_order_relaxed);
+        double current = cells.lastRatings.load(std::memory_order_relaxed);
+        while (!cells.lastRatings.compare_exchange_weak(current, current + LAST_RATINGS_WEIGHT * (stars - current),
+                                                          std::memory_order_relaxed)) {
+        }
+        return true;
+    }
+
+    std::uint64_t count() const {
+        std::uint64_t total = 0;
+        for (const auto& bucket : cells.histogram) {
+            total += bucket.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    std::uint64_t count(int stars) const {
+        if (stars < MIN_STARS || stars > MAX_STARS) {
+            return 0;
+        }
+        return cells.histogram[static_cast<std::size_t>(stars - MIN_STARS)].load(std::memory_order_relaxed);
+    }
+
+    double mean() const {
+        std::uint64_t n = 0;
+        std::uint64_t sum = 0;
+        for (std::size_t i = 0; i < STAR_LEVELS; ++i) {
+            std::uint64_t c = cells.histogram[i].load(std::memory_order_relaxed);
+            n += c;
+            sum += c * (i + MIN_STARS);
+        }
+        return n == 0 ? initial : static_cast<double>(sum) / static_cast<double>(n);
+    }
+
+    // Population variance of the ratings received (0 with fewer than two).
+    double variance() const {
+        std::uint64_t n = 0;
+        std::uint64_t sum = 0;
+        std::uint64_t sumSquares = 0;
+        for (std::size_t i = 0; i < STAR_LEVELS; ++i) {
+            std::uint64_t c = cells.histogram[i].load(std::memory_order_relaxed);
+            std::uint64_t stars = i + MIN_STARS;
+            n += c;
+            sum += c * stars;
+            sumSquares += c * stars * stars;
+        }
+        if (n < 2) {
+            return 0.0;
+        }
+        double m = static_cast<double>(sum) / static_cast<double>(n);
+        double v = static_cast<double>(sumSquares) / static_cast<double>(n) - m * m;
+        return v < 0.0 ? 0.0 : v;
+    }
+
+    double lastRatingsAverage() const {
+        return cells.lastRatings.load(std::memory_order_relaxed);
+    }
+};
+
+// 4. Driver Class
+class Driver {
+private:
+    std::string driverID;
+    std::string name;
+    DriverRatings ratings; // starts at the rating given at construction
+    RideHistory assignedRides; // Encapsulated: private access
+    DriverEarnings earnings; // running totals over every assigned ride, folded or not
+    std::uint32_t poolIndex = 0xFFFFFFFFu; // compact index assigned by DriverPool
+
+public:
+    Driver(const std::string& id, const std::string& n, double r)
+        : driverID(id), name(n), ratings(r) {}
+
+    std::string getDriverID() const {
+        return driverID;
+    }
+
+    std::string getName() const {
+        return name;
+    }
+
+    std::uint32_t getPoolIndex() const {
+        return poolIndex;
+    }
+
+    void setPoolIndex(std::uint32_t index) {
+        poolIndex = index;
+    }
+
+    // Method to add rides to the driver's list
+    // Takes ownership of the unique_ptr
+    void addRide(std::unique_ptr<Ride> ride) {
+        ScopedLatency timer(HotPathLatency::addRide);
+        TRACE_SPAN("Driver::addRide");
+        RideMetrics::assigned(ride->getType()).increment();
+        RideMetrics::revenue(ride->getType()).add(ride->getFare());
+        earnings.add(*ride);
+        assignedRides.add(std::move(ride)); // Ownership transferred
+    }
+
+    // Cap how many rides are kept in full; older ones are summarised.
+    void setHistoryPolicy(const RideHistoryPolicy& policy) {
+        assignedRides.setPolicy(policy);
+    }
+
+    // Visit every ride still held in full without printing (for reports and analytics)
+    template <typename Visitor>
+    void forEachRide(Visitor&& visit) const {
+        assignedRides.forEach(visit);
+    }
+
+    // Visit the rides still held in full that were first requested in
+    // [from, to) (Ride::getRequestedAt()), earliest first: O(log n + k)
+    // through the history's time index.
+    template <typename Visitor>
+    void forEachRideBetween(TimestampMs from, TimestampMs to, Visitor&& visit) const {
+        assignedRides.forEachBetween(from, to, visit);
+    }
+
+    // Every ride assigned, including those folded out of the history.
+    std::size_t getRideCount() const {
+        return static_cast<std::size_t>(assignedRides.totalCount());
+    }
+
+    const RideHistorySummary& getOlderRides() const {
+        return assignedRides.summary();
+    }
+
+    // A rider rates a trip, 1 to 5 stars. Safe from any thread. Returns
+    // false for an out-of-range rating.
+    bool rate(int stars) {
+        return ratings.submit(stars);
+    }
+
+    // Mean of all ratings received (the initial rating until the first one).
+    double getRating() const {
+        return ratings.mean();
+    }
+
+    const DriverRatings& getRatings() const {
+        return ratings;
+    }
+
+    // O(1) earnings queries; no walk over the ride history.
+    const DriverEarnings& getEarnings() const {
+        return earnings;
+    }
+
+    // Method to display driver details
+    void getDriverInfo() const {
+        AllocScope scope(AllocTag::Reporting);
+        std::cout << "\n--- Driver Details ---" << std::endl;
+        std::cout << "Driver ID: " << driverID << std::endl;
+        std::cout << "Name: " << name << std::endl;
+        std::cout << "Rating: " << std::fixed << std::setprecision(1) << ratings.mean() << "/5.0" << std::endl;
+        std::cout << "Completed Rides (" << assignedRides.totalCount() << "):" << std::endl;
+        if (assignedRides.empty()) {
+            std::cout << "  No rides completed yet." << std::endl;
+        } else {
+            const RideHistorySummary& older = assignedRides.summary();
+            if (older.rides != 0) {
+                std::cout << "  (" << older.rides << " older rides, $" << std::fixed << std::setprecision(2)
+                          << older.fare << " in fares)" << std::endl;
+            }
+            assignedRides.forEach([](const Ride& ride) {
+                // Polymorphic call: correct rideDetails (from Standard or Premium) is invoked
+                ride.rideDetails();
+                std::cout << "--------------------" << std::endl;
+            });
+        }
+    }
+};
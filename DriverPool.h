@@ -0,0 +1,211 @@
+// DriverPool.h - Driver availability bitmaps for fast dispatch scans
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "Driver.h"
+#include "AllocTracker.h"
+
+// Compact, dense index assigned to each driver by the pool (0, 1, 2, ...).
+using DriverIndex = std::uint32_t;
+constexpr DriverIndex INVALID_DRIVER_INDEX = 0xFFFFFFFFu;
+
+// Word-level bit helpers. GCC and Clang lower these to single POPCNT / TZCNT
+// instructions only when the target has them (-mpopcnt -mbmi, or
+// -march=native); a baseline x86-64 build gets a short portable sequence.
+inline unsigned popcount64(std::uint64_t word) {
+    return static_cast<unsigned>(__builtin_popcountll(word));
+}
+
+inline unsigned countTrailingZeros64(std::uint64_t word) {
+    return static_cast<unsigned>(__builtin_ctzll(word)); // undefined for 0; callers check first
+}
+
+// A dense bitset over driver indices, stored as 64-bit words.
+class DriverBitset {
+private:
+    std::vector<std::uint64_t> words;
+
+public:
+    static constexpr std::size_t BITS_PER_WORD = 64;
+
+    void resize(std::size_t bitCount) {
+        words.resize((bitCount + BITS_PER_WORD - 1) / BITS_PER_WORD, 0);
+    }
+
+    void set(DriverIndex i) {
+        words[i / BITS_PER_WORD] |= std::uint64_t(1) << (i % BITS_PER_WORD);
+    }
+
+    void reset(DriverIndex i) {
+        words[i / BITS_PER_WORD] &= ~(std::uint64_t(1) << (i % BITS_PER_WORD));
+    }
+
+    bool test(DriverIndex i) const {
+        return (words[i / BITS_PER_WORD] >> (i % BITS_PER_WORD)) & 1u;
+    }
+
+    std::size_t count() const {
+        std::size_t total = 0;
+        for (std::uint64_t word : words) {
+            total += popcount64(word);
+        }
+        return total;
+    }
+
+    // First set bit at or after `from`, or INVALID_DRIVER_INDEX.
+    DriverIndex findNext(DriverIndex from) const {
+        std::size_t w = from / BITS_PER_WORD;
+        if (w >= words.size()) {
+            return INVALID_DRIVER_INDEX;
+        }
+        std::uint64_t word = words[w] & (~std::uint64_t(0) << (from % BITS_PER_WORD));
+        while (true) {
+            if (word != 0) {
+                return static_cast<DriverIndex>(w * BITS_PER_WORD + countTrailingZeros64(word));
+            }
+            if (++w == words.size()) {
+                return INVALID_DRIVER_INDEX;
+            }
+            word = words[w];
+        }
+    }
+
+    // Popcount of (this AND mask) without materialising the intersection.
+    std::size_t countIntersection(const DriverBitset& mask) const {
+        std::size_t n = words.size() < mask.words.size() ? words.size() : mask.words.size();
+        std::size_t total = 0;
+        for (std::size_t w = 0; w < n; ++w) {
+            total += popcount64(words[w] & mask.words[w]);
+        }
+        return total;
+    }
+
+    // Visit set bits of (this AND mask) in index order, one word at a time.
+    // The visitor returns false to stop early.
+    template <typename Visitor>
+    void forEachIntersection(const DriverBitset& mask, Visitor&& visit) const {
+        std::size_t n = words.size() < mask.words.size() ? words.size() : mask.words.size();
+        for (std::size_t w = 0; w < n; ++w) {
+            std::uint64_t word = words[w] & mask.words[w];
+            while (word != 0) {
+                DriverIndex i = static_cast<DriverIndex>(w * BITS_PER_WORD + countTrailingZeros64(word));
+                if (!visit(i)) {
+                    return;
+                }
+                word &= word - 1; // clear lowest set bit
+            }
+        }
+    }
+};
+
+// Registry of drivers with their availability kept as bitmaps:
+// - onlineBits: driver is logged in
+// - busyBits:   driver is on a trip (kept while offline, so a driver who
+//               drops off mid-trip is not dispatchable when they return)
+// - freeBits:   onlineBits & ~busyBits, maintained on every change
+// - one mask per region, holding the drivers currently in that region
+// Dispatch intersects freeBits with a region mask a word at a time instead of
+// walking Driver objects.
+class DriverPool {
+private:
+    std::vector<Driver*> drivers; // DriverIndex -> driver (not owned)
+    std::vector<std::uint32_t> driverRegion;
+    DriverBitset onlineBits;
+    DriverBitset busyBits;
+    DriverBitset freeBits;
+    std::vector<DriverBitset> regionMasks;
+
+    void updateFree(DriverIndex index) {
+        if (onlineBits.test(index) && !busyBits.test(index)) {
+            freeBits.set(index);
+        } else {
+            freeBits.reset(index);
+        }
+    }
+
+public:
+    static constexpr std::uint32_t NO_REGION = 0xFFFFFFFFu;
+
+    explicit DriverPool(std::size_t regionCount = 1) : regionMasks(regionCount) {}
+
+    // Give the driver a compact index. The driver starts offline.
+    DriverIndex registerDriver(Driver& driver) {
+        AllocScope scope(AllocTag::Dispatch);
+        DriverIndex index = static_cast<DriverIndex>(drivers.size());
+        drivers.push_back(&driver);
+        driverRegion.push_back(NO_REGION);
+        onlineBits.resize(drivers.size());
+        busyBits.resize(drivers.size());
+        freeBits.resize(drivers.size());
+        for (DriverBitset& mask : regionMasks) {
+            mask.resize(drivers.size());
+        }
+        driver.setPoolIndex(index);
+        return index;
+    }
+
+    void setOnline(DriverIndex index, bool online) {
+        if (online) {
+            onlineBits.set(index);
+        } else {
+            onlineBits.reset(index);
+        }
+        updateFree(index);
+    }
+
+    // Mark a driver as on a trip (busy) or idle again.
+    void setBusy(DriverIndex index, bool busy) {
+        if (busy) {
+            busyBits.set(index);
+        } else {
+            busyBits.reset(index);
+        }
+        updateFree(index);
+    }
+
+    void moveToRegion(DriverIndex index, std::uint32_t region) {
+        std::uint32_t& current = driverRegion[index];
+        if (current != NO_REGION) {
+            regionMasks[current].reset(index);
+        }
+        regionMasks[region].set(index);
+        current = region;
+    }
+
+    bool isOnline(DriverIndex index) const { return onlineBits.test(index); }
+    bool isBusy(DriverIndex index) const { return busyBits.test(index); }
+    bool isFree(DriverIndex index) const { return freeBits.test(index); }
+    std::uint32_t regionOf(DriverIndex index) const { return driverRegion[index]; }
+    Driver& driverAt(DriverIndex index) const { return *drivers[index]; }
+
+    std::size_t size() const { return drivers.size(); }
+    std::size_t regionCount() const { return regionMasks.size(); }
+    std::size_t onlineCount() const { return onlineBits.count(); }
+    std::size_t freeCount() const { return freeBits.count(); }
+
+    std::size_t freeCountInRegion(std::uint32_t region) const {
+        return freeBits.countIntersection(regionMasks[region]);
+    }
+
+    // Next free driver anywhere at or after `from` (round-robin dispatch).
+    DriverIndex findNextFree(DriverIndex from = 0) const {
+        return freeBits.findNext(from);
+    }
+
+    // Collect up to `limit` free drivers in a region into `out`.
+    std::size_t findCandidates(std::uint32_t region, std::size_t limit, std::vector<DriverIndex>& out) const {
+        out.clear();
+        if (limit == 0) {
+            return 0;
+        }
+        freeBits.forEachIntersection(regionMasks[region], [&](DriverIndex i) {
+            out.push_back(i);
+            return out.size() < limit;
+        });
+        return out.size();
+    }
+};
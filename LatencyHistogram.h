@@ -0,0 +1,237 @@
+// LatencyHistogram.h - Low-overhead per-thread HDR-style latency histograms
+
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <chrono>
+#include <ostream>
+#include <cstdint>
+#include <cstdio>
+
+// Log-linear histogram of nanosecond values in the style of HdrHistogram:
+// values below 128 get exact buckets, above that each power of two is split
+// into 64 sub-buckets, so every recorded value is within ~1.6% of its bucket.
+// Values from 1 ns up to ~18 minutes (2^40 ns) are covered; larger values
+// land in the last bucket.
+//
+// Each histogram has a single writer (its owning thread). Counts are atomics
+// updated with relaxed load + store rather than read-modify-write, which
+// keeps recording to a handful of plain instructions while still letting
+// another thread read a consistent-enough snapshot at any time.
+class LatencyHistogram {
+public:
+    static constexpr unsigned LINEAR_BITS = 7;   // exact buckets for 0..127
+    static constexpr unsigned SUB_BITS = 6;      // 64 sub-buckets per power of two
+    static constexpr unsigned MAX_BIT = 40;      // highest tracked magnitude
+    static constexpr std::size_t BUCKET_COUNT =
+        (std::size_t(1) << LINEAR_BITS) + (MAX_BIT - LINEAR_BITS + 1) * (std::size_t(1) << SUB_BITS);
+
+private:
+    std::array<std::atomic<std::uint64_t>, BUCKET_COUNT> counts;
+    std::atomic<std::uint64_t> total{0};
+    std::atomic<std::uint64_t> maxValue{0};
+
+    static void bump(std::atomic<std::uint64_t>& cell, std::uint64_t by) {
+        cell.store(cell.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+public:
+    LatencyHistogram() {
+        for (auto& c : counts) c.store(0, std::memory_order_relaxed);
+    }
+
+    static std::size_t bucketOf(std::uint64_t value) {
+        if (value < (std::uint64_t(1) << LINEAR_BITS)) {
+            return static_cast<std::size_t>(value);
+        }
+        unsigned msb = 63u - static_cast<unsigned>(__builtin_clzll(value));
+        if (msb > MAX_BIT) {
+            return BUCKET_COUNT - 1;
+        }
+        unsigned shift = msb - SUB_BITS;
+        std::size_t mantissa = static_cast<std::size_t>(value >> shift) - (std::size_t(1) << SUB_BITS);
+        return (std::size_t(1) << LINEAR_BITS) + (msb - LINEAR_BITS) * (std::size_t(1) << SUB_BITS) + mantissa;
+    }
+
+    // Highest value that maps to the bucket (what percentiles report).
+    static std::uint64_t bucketUpperBound(std::size_t bucket) {
+        if (bucket < (std::size_t(1) << LINEAR_BITS)) {
+            return bucket;
+        }
+        std::size_t rest = bucket - (std::size_t(1) << LINEAR_BITS);
+        unsigned msb = LINEAR_BITS + static_cast<unsigned>(rest >> SUB_BITS);
+        std::uint64_t mantissa = (std::uint64_t(1) << SUB_BITS) + (rest & ((std::size_t(1) << SUB_BITS) - 1));
+        unsigned shift = msb - SUB_BITS;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    // Single-writer record. Only the owning thread may call this.
+    void record(std::uint64_t nanos) {
+        bump(counts[bucketOf(nanos)], 1);
+        bump(total, 1);
+        if (nanos > maxValue.load(std::memory_order_relaxed)) {
+            maxValue.store(nanos, std::memory_order_relaxed);
+        }
+    }
+
+    // Accumulate another histogram into this one (used for snapshots).
+    void merge(const LatencyHistogram& other) {
+        for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+            bump(counts[i], other.counts[i].load(std::memory_order_relaxed));
+        }
+        bump(total, other.total.load(std::memory_order_relaxed));
+        std::uint64_t otherMax = other.maxValue.load(std::memory_order_relaxed);
+        if (otherMax > maxValue.load(std::memory_order_relaxed)) {
+            maxValue.store(otherMax, std::memory_order_relaxed);
+        }
+    }
+
+    std::uint64_t count() const {
+        return total.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t max() const {
+        return maxValue.load(std::memory_order_relaxed);
+    }
+
+    // Value at quantile q in [0, 1], reported as its bucket's upper bound.
+    std::uint64_t percentile(double q) const {
+        std::uint64_t n = count();
+        if (n == 0) {
+            return 0;
+        }
+        std::uint64_t rank = static_cast<std::uint64_t>(q * static_cast<double>(n - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += counts[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                std::uint64_t bound = bucketUpperBound(i);
+                return bound < max() ? bound : max();
+            }
+        }
+        return max();
+    }
+};
+
+// A named latency metric. Each thread that records gets its own
+// LatencyHistogram (found through a thread_local table, no locking); the
+// registry lock is only taken the first time a thread records and when a
+// snapshot is merged. Recorders are meant to be long-lived globals.
+class LatencyRecorder {
+private:
+    std::string name;
+    std::size_t id;
+    mutable std::mutex registryMutex;
+    std::vector<std::unique_ptr<LatencyHistogram>> perThread;
+
+    inline static std::atomic<std::size_t> nextId{0};
+    inline static std::atomic<bool> enabled{false};
+
+    static std::vector<LatencyHistogram*>& threadTable() {
+        thread_local std::vector<LatencyHistogram*> table;
+        return table;
+    }
+
+    LatencyHistogram& localHistogram() {
+        std::vector<LatencyHistogram*>& table = threadTable();
+        if (id >= table.size()) {
+            table.resize(id + 1, nullptr);
+        }
+        if (table[id] == nullptr) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            perThread.push_back(std::make_unique<LatencyHistogram>());
+            table[id] = perThread.back().get();
+        }
+        return *table[id];
+    }
+
+public:
+    explicit LatencyRecorder(std::string metricName)
+        : name(std::move(metricName)), id(nextId.fetch_add(1)) {}
+
+    LatencyRecorder(const LatencyRecorder&) = delete;
+    LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+
+    // Recording is off by default so un-instrumented runs pay one relaxed load.
+    static void setEnabled(bool on) {
+        enabled.store(on, std::memory_order_relaxed);
+    }
+
+    static bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    void record(std::uint64_t nanos) {
+        localHistogram().record(nanos);
+    }
+
+    const std::string& getName() const {
+        return name;
+    }
+
+    // Merge all per-thread histograms into one snapshot.
+    std::unique_ptr<LatencyHistogram> snapshot() const {
+        auto merged = std::make_unique<LatencyHistogram>();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto& histogram : perThread) {
+            merged->merge(*histogram);
+        }
+        return merged;
+    }
+
+    void dump(std::ostream& out) const {
+        std::unique_ptr<LatencyHistogram> merged = snapshot();
+        char line[256];
+        std::snprintf(line, sizeof(line),
+                      "%-22s count=%-10llu p50=%lluns p99=%lluns p999=%lluns max=%lluns",
+                      name.c_str(),
+                      static_cast<unsigned long long>(merged->count()),
+                      static_cast<unsigned long long>(merged->percentile(0.50)),
+                      static_cast<unsigned long long>(merged->percentile(0.99)),
+                      static_cast<unsigned long long>(merged->percentile(0.999)),
+                      static_cast<unsigned long long>(merged->max()));
+        out << line << std::endl;
+    }
+};
+
+// Times the enclosing scope into a recorder when latency recording is enabled.
+class ScopedLatency {
+private:
+    LatencyRecorder* recorder;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit ScopedLatency(LatencyRecorder& r)
+        : recorder(LatencyRecorder::isEnabled() ? &r : nullptr) {
+        if (recorder != nullptr) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedLatency() {
+        if (recorder != nullptr) {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            recorder->record(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+    }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+};
+
+// The instrumented hot paths.
+struct HotPathLatency {
+    inline static LatencyRecorder requestRide{"Rider::requestRide"};
+    inline static LatencyRecorder addRide{"Driver::addRide"};
+
+    static void dumpAll(std::ostream& out) {
+        requestRide.dump(out);
+        addRide.dump(out);
+    }
+};
@@ -0,0 +1,199 @@
+// Leaderboard.h - Incrementally maintained top-K rankings of drivers
+
+#pragma once
+
+#include <set>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "Driver.h"
+#include "DriverPool.h"
+
+// A score that only counts on one day, such as rides or earnings today.
+// Ordered by day first, so today's scores rank above every earlier day's.
+struct DailyScore {
+    std::int64_t day = -1;
+    double value = 0.0;
+
+    bool operator<(const DailyScore& other) const {
+        return day != other.day ? day < other.day : value < other.value;
+    }
+};
+
+// Members (dense indices, e.g. DriverIndex) ranked by score, best first.
+// Entries sit in an ordered tree, so:
+// - rescore() re-keys a member in O(log n); the tree node is reused
+//   (extract, modify, reinsert), so updates do not allocate
+// - forEachTop() walks the K best in O(K), ties broken by lower index
+// The board holds only its own members. The caller keeps each member's
+// current score and passes it back to rescore() and erase(), so many boards
+// over one population (one per region, say) share a single score array
+// instead of each sizing one to the largest member index.
+// Not thread-safe; update from the thread that owns the drivers.
+template <typename Score>
+class Leaderboard {
+private:
+    using Entry = std::pair<Score, std::uint32_t>;
+
+    struct Better {
+        bool operator()(const Entry& a, const Entry& b) const {
+            if (b.first < a.first) {
+                return true;
+            }
+            if (a.first < b.first) {
+                return false;
+            }
+            return a.second < b.second;
+        }
+    };
+
+    std::set<Entry, Better> ranked;
+
+public:
+    // Rank a member that is not on the board.
+    void insert(std::uint32_t member, const Score& score) {
+        ranked.emplace(score, member);
+    }
+
+    // Change a member's score from `current` (as last inserted or rescored)
+    // to `score`. A member not ranked at `current` is inserted.
+    void rescore(std::uint32_t member, const Score& current, const Score& score) {
+        auto node = ranked.extract(Entry(current, member));
+        if (node.empty()) {
+            ranked.emplace(score, member);
+            return;
+        }
+        node.value().first = score;
+        ranked.insert(std::move(node));
+    }
+
+    // Take a member ranked at `current` off the board.
+    void erase(std::uint32_t member, const Score& current) {
+        ranked.erase(Entry(current, member));
+    }
+
+    std::size_t size() const {
+        return ranked.size();
+    }
+
+    // Visit up to k members, best first, as visit(member, score). Stops
+    // early if visit returns false.
+    template <typename Visitor>
+    void forEachTop(std::size_t k, Visitor&& visit) const {
+        for (auto it = ranked.begin(); it != ranked.end() && k > 0; ++it, --k) {
+            if (!visit(it->second, it->first)) {
+                return;
+            }
+        }
+    }
+
+    // The k best members, best first.
+    void top(std::size_t k, std::vector<std::uint32_t>& out) const {
+        out.clear();
+        forEachTop(k, [&out](std::uint32_t member, const Score&) {
+            out.push_back(member);
+            return true;
+        });
+    }
+};
+
+// Per-region driver leaderboards by rating, earnings today and rides
+// today. A driver belongs to the region passed with their latest update
+// (e.g. where their last trip ended); call update() whenever a driver's
+// ride history or rating changes. Each update costs O(log n) per board,
+// and reading a region's top K costs O(K). Scores are kept once per driver,
+// not per region, so memory is one tree node per driver and board plus one
+// score row per driver, however many regions there are.
+class DriverLeaderboards {
+private:
+    struct DriverScores {
+        std::uint32_t region = NO_REGION;
+        double rating = 0.0;
+        DailyScore earnings;
+        DailyScore rides;
+    };
+
+    static constexpr std::uint32_t NO_REGION = 0xFFFFFFFFu;
+
+    std::vector<Leaderboard<double>> rating;
+    std::vector<Leaderboard<DailyScore>> earningsToday;
+    std::vector<Leaderboard<DailyScore>> ridesToday;
+    std::vector<DriverScores> scores; // by driver
+
+    template <typename Visitor>
+    static void forEachToday(const Leaderboard<DailyScore>& board, std::int64_t day, std::size_t k, Visitor&& visit) {
+        board.forEachTop(k, [&visit, day](std::uint32_t member, const DailyScore& score) {
+            if (score.day != day) {
+                return false; // everyone below has no rides that day
+            }
+            visit(member, score.value);
+            return true;
+        });
+    }
+
+public:
+    explicit DriverLeaderboards(std::size_t regionCount)
+        : rating(regionCount), earningsToday(regionCount), ridesToday(regionCount) {}
+
+    std::size_t regionCount() const {
+        return rating.size();
+    }
+
+    // Re-rank a driver in `region` as of `now`, moving them off their old
+    // region's boards if it changed.
+    void update(DriverIndex d, std::uint32_t region, const Driver& driver, TimestampMs now) {
+        if (d >= scores.size()) {
+            scores.resize(d + 1);
+        }
+        DriverScores& current = scores[d];
+        std::int64_t day = dayOf(now);
+        DayEarnings today = driver.getEarnings().onDay(day);
+        DriverScores next;
+        next.region = region;
+        next.rating = driver.getRating();
+        next.earnings = DailyScore{today.rides != 0 ? day : -1, today.fare};
+        next.rides = DailyScore{today.rides != 0 ? day : -1, static_cast<double>(today.rides)};
+
+        if (current.region == region) {
+            rating[region].rescore(d, current.rating, next.rating);
+            earningsToday[region].rescore(d, current.earnings, next.earnings);
+            ridesToday[region].rescore(d, current.rides, next.rides);
+        } else {
+            if (current.region != NO_REGION) {
+                rating[current.region].erase(d, current.rating);
+                earningsToday[current.region].erase(d, current.earnings);
+                ridesToday[current.region].erase(d, current.rides);
+            }
+            rating[region].insert(d, next.rating);
+            earningsToday[region].insert(d, next.earnings);
+            ridesToday[region].insert(d, next.rides);
+        }
+        current = next;
+    }
+
+    // Visit the region's top k drivers as visit(DriverIndex, value), best first.
+    template <typename Visitor>
+    void topByRating(std::uint32_t region, std::size_t k, Visitor&& visit) const {
+        rating[region].forEachTop(k, [&visit](std::uint32_t member, double score) {
+            visit(member, score);
+            return true;
+        });
+    }
+
+    // Only drivers with rides on `day` are listed.
+    template <typename Visitor>
+    void topByEarnings(std::uint32_t region, std::int64_t day, std::size_t k, Visitor&& visit) const {
+        forEachToday(earningsToday[region], day, k, visit);
+    }
+
+    template <typename Visitor>
+    void topByRides(std::uint32_t region, std::int64_t day, std::size_t k, Visitor&& visit) const {
+        forEachToday(ridesToday[region], day, k, visit);
+    }
+
+    // Drivers currently ranked in the region.
+    std::size_t driversIn(std::uint32_t region) const {
+        return rating[region].size();
+    }
+};
@@ -0,0 +1,277 @@
+// Metrics.h - Counters and gauges exposed in Prometheus text format
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <ostream>
+#include <cstdio>
+#include <cstdint>
+
+#include "Ride.h"
+
+// One thread's share of a counter, on its own cache line so threads bumping
+// the same counter never contend. Only the owning thread writes it.
+struct alignas(64) MetricCell {
+    std::atomic<double> value{0.0};
+};
+
+class MetricCounter;
+
+// A gauge's current value, published by the thread that owns the measured
+// state (a pool, a queue) with a relaxed store and read by the scraper. The
+// owner decides how often to publish, so the scrape never touches the
+// owner's data structures.
+struct MetricGauge {
+    std::string name;
+    std::string help;
+    std::string labels; // e.g. district="3", or empty
+    MetricCell cell;
+
+    MetricGauge(std::string gaugeName, std::string gaugeHelp, std::string gaugeLabels)
+        : name(std::move(gaugeName)), help(std::move(gaugeHelp)), labels(std::move(gaugeLabels)) {}
+};
+
+// Process-wide list of counters and gauges, rendered in registration order.
+class MetricsRegistry {
+private:
+    struct State {
+        std::mutex mutex;
+        std::vector<const MetricCounter*> counters;
+        std::vector<std::unique_ptr<MetricGauge>> gauges;
+    };
+
+    // Function-local so counters defined as globals in any header can
+    // register during static initialisation.
+    static State& state() {
+        static State instance;
+        return instance;
+    }
+
+    static void writeHeader(std::ostream& out, const std::string& name, const std::string& help,
+                            const char* type, std::string& lastName) {
+        if (name != lastName) {
+            out << "# HELP " << name << ' ' << help << '\n';
+            out << "# TYPE " << name << ' ' << type << '\n';
+            lastName = name;
+        }
+    }
+
+    static void writeSample(std::ostream& out, const std::string& name, const std::string& labels, double value) {
+        char number[64];
+        std::snprintf(number, sizeof(number), "%.17g", value);
+        out << name;
+        if (!labels.empty()) {
+            out << '{' << labels << '}';
+        }
+        out << ' ' << number << '\n';
+    }
+
+public:
+    static void addCounter(const MetricCounter* counter) {
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.counters.push_back(counter);
+    }
+
+    static void removeCounter(const MetricCounter* counter) {
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        for (auto it = s.counters.begin(); it != s.counters.end(); ++it) {
+            if (*it == counter) {
+                s.counters.erase(it);
+                return;
+            }
+        }
+    }
+
+    // The gauge stays registered (and its address valid) until removeGauge().
+    static MetricGauge* addGauge(std::string name, std::string help, std::string labels) {
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.gauges.push_back(std::make_unique<MetricGauge>(std::move(name), std::move(help), std::move(labels)));
+        return s.gauges.back().get();
+    }
+
+    static void removeGauge(const MetricGauge* gauge) {
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        for (auto it = s.gauges.begin(); it != s.gauges.end(); ++it) {
+            if (it->get() == gauge) {
+                s.gauges.erase(it);
+                return;
+            }
+        }
+    }
+
+    // Render every metric in the Prometheus text exposition format (0.0.4).
+    // Counters sharing a name must be registered next to each other so they
+    // form one family under a single HELP/TYPE header.
+    static void writePrometheus(std::ostream& out);
+};
+
+// A monotonically increasing counter (requests, revenue). Each thread adds
+// into its own MetricCell, found through a thread_local table, so add() is
+// a relaxed load and store with no locked instruction; the registry lock is
+// only taken the first time a thread touches the counter and when the cells
+// are summed for a scrape. Counters are meant to be long-lived globals; a
+// shorter-lived one unregisters itself when destroyed.
+class MetricCounter {
+private:
+    std::string name;
+    std::string help;
+    std::string labels;
+    std::size_t id;
+    mutable std::mutex cellsMutex;
+    std::vector<std::unique_ptr<MetricCell>> perThread;
+
+    inline static std::atomic<std::size_t> nextId{0};
+
+    static std::vector<MetricCell*>& threadTable() {
+        thread_local std::vector<MetricCell*> table;
+        return table;
+    }
+
+    MetricCell& localCell() {
+        std::vector<MetricCell*>& table = threadTable();
+        if (id >= table.size()) {
+            table.resize(id + 1, nullptr);
+        }
+        if (table[id] == nullptr) {
+            std::lock_guard<std::mutex> lock(cellsMutex);
+            perThread.push_back(std::make_unique<MetricCell>());
+            table[id] = perThread.back().get();
+        }
+        return *table[id];
+    }
+
+public:
+    MetricCounter(std::string metricName, std::string metricHelp, std::string metricLabels = "")
+        : name(std::move(metricName)), help(std::move(metricHelp)), labels(std::move(metricLabels)),
+          id(nextId.fetch_add(1)) {
+        MetricsRegistry::addCounter(this);
+    }
+
+    ~MetricCounter() {
+        MetricsRegistry::removeCounter(this);
+    }
+
+    MetricCounter(const MetricCounter&) = delete;
+    MetricCounter& operator=(const MetricCounter&) = delete;
+
+    void add(double amount) {
+        std::atomic<double>& cell = localCell().value;
+        cell.store(cell.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    void increment() {
+        add(1.0);
+    }
+
+    // Sum over all threads.
+    double value() const {
+        std::lock_guard<std::mutex> lock(cellsMutex);
+        double total = 0.0;
+        for (const auto& cell : perThread) {
+            total += cell->value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    const std::string& getName() const { return name; }
+    const std::string& getHelp() const { return help; }
+    const std::string& getLabels() const { return labels; }
+};
+
+inline void MetricsRegistry::writePrometheus(std::ostream& out) {
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    std::string lastName;
+    for (const MetricCounter* counter : s.counters) {
+        writeHeader(out, counter->getName(), counter->getHelp(), "counter", lastName);
+        writeSample(out, counter->getName(), counter->getLabels(), counter->value());
+    }
+    // Live rides by lifecycle state, from the ride class's own counters.
+    for (std::size_t i = 0; i < RIDE_STATUS_COUNT; ++i) {
+        RideStatus status = static_cast<RideStatus>(i);
+        writeHeader(out, "rideshare_live_rides", "Live ride objects by lifecycle state.", "gauge", lastName);
+        writeSample(out, "rideshare_live_rides", std::string("status=\"") + rideStatusName(status) + "\"",
+                    static_cast<double>(Ride::countInState(status)));
+    }
+    // Gauges come and go with their owners, so series of one family can be
+    // registered apart (district 0's gauges, then district 1's); emit each
+    // family together, in order of first registration.
+    std::vector<bool> written(s.gauges.size(), false);
+    for (std::size_t i = 0; i < s.gauges.size(); ++i) {
+        if (written[i]) {
+            continue;
+        }
+        for (std::size_t j = i; j < s.gauges.size(); ++j) {
+            const MetricGauge& gauge = *s.gauges[j];
+            if (!written[j] && gauge.name == s.gauges[i]->name) {
+                writeHeader(out, gauge.name, gauge.help, "gauge", lastName);
+                writeSample(out, gauge.name, gauge.labels, gauge.cell.value.load(std::memory_order_relaxed));
+                written[j] = true;
+            }
+        }
+    }
+}
+
+// Registers a gauge for the lifetime of this object. Only the owning thread
+// should call set().
+class ScopedGauge {
+private:
+    MetricGauge* gauge;
+
+public:
+    ScopedGauge(std::string name, std::string help, std::string labels = "")
+        : gauge(MetricsRegistry::addGauge(std::move(name), std::move(help), std::move(labels))) {}
+
+    ~ScopedGauge() {
+        MetricsRegistry::removeGauge(gauge);
+    }
+
+    ScopedGauge(const ScopedGauge&) = delete;
+    ScopedGauge& operator=(const ScopedGauge&) = delete;
+
+    void set(double value) {
+        gauge->cell.value.store(value, std::memory_order_relaxed);
+    }
+};
+
+// The counters maintained by the ride classes themselves.
+struct RideMetrics {
+    inline static MetricCounter requestedStandard{
+        "rideshare_rides_requested_total", "Rides requested through Rider::requestRide.", "type=\"standard\""};
+    inline static MetricCounter requestedPremium{
+        "rideshare_rides_requested_total", "Rides requested through Rider::requestRide.", "type=\"premium\""};
+    inline static MetricCounter assignedStandard{
+        "rideshare_rides_assigned_total", "Rides added to driver histories through Driver::addRide.", "type=\"standard\""};
+    inline static MetricCounter assignedPremium{
+        "rideshare_rides_assigned_total", "Rides added to driver histories through Driver::addRide.", "type=\"premium\""};
+    inline static MetricCounter revenueStandard{
+        "rideshare_revenue_dollars_total", "Sum of getFare() over rides added to driver histories.", "type=\"standard\""};
+    inline static MetricCounter revenuePremium{
+        "rideshare_revenue_dollars_total", "Sum of getFare() over rides added to driver histories.", "type=\"premium\""};
+    inline static MetricCounter quotes{
+        "rideshare_quotes_total", "Fare quotes served by RideEngine::quote."};
+    inline static MetricCounter quoteCacheHits{
+        "rideshare_quote_cache_lookups_total", "RideEngine quote cache lookups.", "result=\"hit\""};
+    inline static MetricCounter quoteCacheMisses{
+        "rideshare_quote_cache_lookups_total", "RideEngine quote cache lookups.", "result=\"miss\""};
+
+    static MetricCounter& requested(RideType type) {
+        return type == RideType::Premium ? requestedPremium : requestedStandard;
+    }
+
+    static MetricCounter& assigned(RideType type) {
+        return type == RideType::Premium ? assignedPremium : assignedStandard;
+    }
+
+    static MetricCounter& revenue(RideType type) {
+        return type == RideType::Premium ? revenuePremium : revenueStandard;
+    }
+};
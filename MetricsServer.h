@@ -0,0 +1,163 @@
+// MetricsServer.h - Minimal localhost HTTP endpoint serving /metrics
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <string>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+
+#include "Metrics.h"
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define RIDESHARE_HAVE_METRICS_SERVER 1
+#endif
+
+// Serves MetricsRegistry::writePrometheus() to GET /metrics on 127.0.0.1
+// from a background thread, one connection at a time. A scrape only reads
+// the per-thread metric cells, so the threads doing ride work never wait on
+// it. This is meant for a local Prometheus or curl, not for the open
+// network: there is no keep-alive, TLS or request body handling.
+class MetricsServer {
+private:
+    std::thread worker;
+    std::atomic<bool> running{false};
+    int listenFd = -1;
+    std::uint16_t boundPort = 0;
+
+#ifdef RIDESHARE_HAVE_METRICS_SERVER
+    static void sendAll(int fd, const std::string& data) {
+        std::size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return;
+            }
+            sent += static_cast<std::size_t>(n);
+        }
+    }
+
+    static void handle(int fd) {
+        // Read until the end of the request head (or 4 KiB, or 1 s idle).
+        std::string request;
+        char chunk[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 4096) {
+            pollfd p{fd, POLLIN, 0};
+            if (::poll(&p, 1, 1000) <= 0) {
+                break;
+            }
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) {
+                break;
+            }
+            request.append(chunk, static_cast<std::size_t>(n));
+        }
+
+        std::string status = "200 OK";
+        std::string body;
+        if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 14, "HEAD /metrics ") == 0) {
+            std::ostringstream text;
+            MetricsRegistry::writePrometheus(text);
+            body = text.str();
+        } else if (request.compare(0, 4, "GET ") == 0 || request.compare(0, 5, "HEAD ") == 0) {
+            status = "404 Not Found";
+            body = "try /metrics\n";
+        } else {
+            status = "405 Method Not Allowed";
+            body = "GET only\n";
+        }
+        std::string response = "HTTP/1.1 " + status + "\r\n"
+                               "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                               "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                               "Connection: close\r\n\r\n";
+        if (request.compare(0, 5, "HEAD ") != 0) {
+            response += body;
+        }
+        sendAll(fd, response);
+    }
+
+    void serve() {
+        while (running.load(std::memory_order_acquire)) {
+            pollfd p{listenFd, POLLIN, 0};
+            if (::poll(&p, 1, 100) <= 0) {
+                continue; // timeout: re-check running
+            }
+            int client = ::accept(listenFd, nullptr, nullptr);
+            if (client < 0) {
+                continue;
+            }
+            handle(client);
+            ::close(client);
+        }
+    }
+#endif
+
+public:
+    MetricsServer() = default;
+
+    ~MetricsServer() {
+        stop();
+    }
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // Listen on 127.0.0.1:port (0 picks a free port, see port()). Returns
+    // false if the socket cannot be bound or the platform has no sockets.
+    bool start(std::uint16_t port) {
+#ifdef RIDESHARE_HAVE_METRICS_SERVER
+        stop();
+        listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listenFd < 0) {
+            return false;
+        }
+        int reuse = 1;
+        ::setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        socklen_t length = sizeof(address);
+        if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(listenFd, 16) != 0 ||
+            ::getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+            ::close(listenFd);
+            listenFd = -1;
+            return false;
+        }
+        boundPort = ntohs(address.sin_port);
+        running.store(true, std::memory_order_release);
+        worker = std::thread(&MetricsServer::serve, this);
+        return true;
+#else
+        (void)port;
+        return false;
+#endif
+    }
+
+    // Stop serving and close the socket. Safe to call more than once.
+    void stop() {
+#ifdef RIDESHARE_HAVE_METRICS_SERVER
+        running.store(false, std::memory_order_release);
+        if (worker.joinable()) {
+            worker.join();
+        }
+        if (listenFd >= 0) {
+            ::close(listenFd);
+            listenFd = -1;
+        }
+#endif
+    }
+
+    std::uint16_t port() const {
+        return boundPort;
+    }
+};
@@ -0,0 +1,182 @@
+// PerfCounters.h - Hardware performance counters around hot code (Linux)
+
+#pragma once
+
+#include <array>
+#include <string>
+#include <ostream>
+#include <cstdint>
+#include <cstdio>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// The hardware events we sample, in report order.
+enum class PerfEvent : std::uint8_t {
+    Cycles,
+    Instructions,
+    CacheMisses,
+    BranchMisses
+};
+
+constexpr std::size_t PERF_EVENT_COUNT = 4;
+
+inline const char* perfEventName(PerfEvent event) {
+    static constexpr const char* NAMES[PERF_EVENT_COUNT] = {
+        "cycles", "instructions", "cache-misses", "branch-misses"
+    };
+    return NAMES[static_cast<std::size_t>(event)];
+}
+
+// Counter totals for one measured region, plus how many operations it ran.
+struct PerfReport {
+    std::string label;
+    std::uint64_t ops = 0;
+    std::array<std::uint64_t, PERF_EVENT_COUNT> counts{};
+    std::array<bool, PERF_EVENT_COUNT> valid{};
+
+    bool has(PerfEvent event) const {
+        return valid[static_cast<std::size_t>(event)];
+    }
+
+    double perOp(PerfEvent event) const {
+        return ops == 0 ? 0.0 : static_cast<double>(counts[static_cast<std::size_t>(event)]) / ops;
+    }
+
+    double instructionsPerCycle() const {
+        std::uint64_t cycles = counts[static_cast<std::size_t>(PerfEvent::Cycles)];
+        return cycles == 0 ? 0.0 : static_cast<double>(counts[static_cast<std::size_t>(PerfEvent::Instructions)]) / cycles;
+    }
+
+    void print(std::ostream& out) const {
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-28s ops=%-10llu", label.c_str(), static_cast<unsigned long long>(ops));
+        out << line;
+        bool any = false;
+        for (std::size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+            if (valid[i]) {
+                std::snprintf(line, sizeof(line), " %s/op=%.2f", perfEventName(static_cast<PerfEvent>(i)),
+                              perOp(static_cast<PerfEvent>(i)));
+                out << line;
+                any = true;
+            }
+        }
+        if (has(PerfEvent::Cycles) && has(PerfEvent::Instructions)) {
+            std::snprintf(line, sizeof(line), " IPC=%.2f", instructionsPerCycle());
+            out << line;
+        }
+        if (!any) {
+            out << " (hardware counters unavailable)";
+        }
+        out << std::endl;
+    }
+};
+
+// Opens one perf_event counter per PerfEvent for the calling thread
+// (user-space only). Events the kernel or hardware refuses - common in VMs
+// and containers, or with perf_event_paranoid > 2 - are simply reported as
+// unavailable; measuring still runs the code. On non-Linux platforms every
+// event is unavailable.
+//
+// Typical use:
+//     PerfCounters counters;
+//     PerfReport r = counters.measure("calculateFare batch", n, [&] { ... });
+//     r.print(std::cout);
+class PerfCounters {
+private:
+    std::array<int, PERF_EVENT_COUNT> fds;
+
+#ifdef __linux__
+    static int openCounter(PerfEvent event) {
+        static constexpr std::uint64_t CONFIGS[PERF_EVENT_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+        };
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = CONFIGS[static_cast<std::size_t>(event)];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+
+public:
+    PerfCounters() {
+        fds.fill(-1);
+#ifdef __linux__
+        for (std::size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+            fds[i] = openCounter(static_cast<PerfEvent>(i));
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void start() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    // Stop counting and return the totals since start().
+    PerfReport stop(const std::string& label, std::uint64_t ops) {
+        PerfReport report;
+        report.label = label;
+        report.ops = ops;
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+        for (std::size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+            std::uint64_t value = 0;
+            if (fds[i] >= 0 && read(fds[i], &value, sizeof(value)) == static_cast<ssize_t>(sizeof(value))) {
+                report.counts[i] = value;
+                report.valid[i] = true;
+            }
+        }
+#endif
+        return report;
+    }
+
+    // Run `body` (which performs `ops` operations) between start() and stop().
+    template <typename Body>
+    PerfReport measure(const std::string& label, std::uint64_t ops, Body&& body) {
+        start();
+        body();
+        return stop(label, ops);
+    }
+};
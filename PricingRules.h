@@ -0,0 +1,404 @@
+// PricingRules.h - Pricing rule files compiled to flat fare tables
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <initializer_list>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <cstdlib>
+
+#include "Ride.h"
+
+// Rule file syntax, one rule per line, '#' starts a comment, names with
+// spaces are quoted:
+//
+//   tier standard rate 2.00                  # $/mile; optional: base B, minimum M
+//   tier premium rate 3.50 base 5.00
+//   time 07:00-10:00 multiplier 1.25         # UTC; optional: tier standard|premium
+//   time 22:00-02:00 multiplier 1.10         # ranges may wrap midnight;
+//                                            # equal ends cover the whole day
+//   zone Downtown multiplier 1.15            # trips picked up in the zone
+//   zone Airport pickup-fee 4.50 dropoff-fee 4.50
+//   airport Airport fee 4.50                 # same as pickup-fee + dropoff-fee
+//
+// fare = max(minimum, (base + distance * rate) * time multiplier * pickup-zone
+// multiplier) + pickup fee + dropoff fee. Overlapping time rules and repeated
+// zone rules multiply (multipliers) or add up (fees). Tiers without a rule
+// keep their compiled-in FarePolicy. Times of day are UTC: a ride's minute is
+// taken from its Unix timestamp with no timezone offset, so a city in another
+// zone writes its local hours shifted to UTC.
+
+struct PricingTierRule {
+    double rate;
+    double base;
+    double minimum;
+};
+
+struct PricingTimeRule {
+    std::uint32_t startMinute; // minute of day, inclusive
+    std::uint32_t endMinute;   // exclusive; at or below startMinute wraps midnight
+    double multiplier;
+    std::uint32_t tierMask;    // bit per RideType
+};
+
+struct PricingZoneRule {
+    std::string location;
+    double multiplier;
+    double pickupFee;
+    double dropoffFee;
+};
+
+// The parsed, human-level form of a rule file.
+class PricingRuleSet {
+private:
+    std::vector<PricingTierRule> tiers;
+    std::vector<PricingTimeRule> timeRules;
+    std::vector<PricingZoneRule> zoneRules;
+
+    // Split a line into words, keeping "quoted names" whole and dropping comments.
+    static bool tokenize(const std::string& line, std::vector<std::string>& words) {
+        words.clear();
+        std::size_t i = 0;
+        while (i < line.size()) {
+            char c = line[i];
+            if (c == '#') {
+                break;
+            }
+            if (c == ' ' || c == '\t' || c == '\r') {
+                ++i;
+                continue;
+            }
+            if (c == '"') {
+                std::size_t close = line.find('"', i + 1);
+                if (close == std::string::npos) {
+                    return false;
+                }
+                words.push_back(line.substr(i + 1, close - i - 1));
+                i = close + 1;
+                continue;
+            }
+            std::size_t end = i;
+            while (end < line.size() && line[end] != ' ' && line[end] != '\t' && line[end] != '\r' &&
+                   line[end] != '#') {
+                ++end;
+            }
+            words.push_back(line.substr(i, end - i));
+            i = end;
+        }
+        return true;
+    }
+
+    static bool parseNumber(const std::string& word, double& out) {
+        char* end = nullptr;
+        out = std::strtod(word.c_str(), &end);
+        return !word.empty() && *end == '\0' && out >= 0.0;
+    }
+
+    static bool parseTier(const std::string& word, RideType& out) {
+        if (word == "standard") {
+            out = RideType::Standard;
+            return true;
+        }
+        if (word == "premium") {
+            out = RideType::Premium;
+            return true;
+        }
+        return false;
+    }
+
+    // "HH:MM" -> minute of day; 24:00 is accepted as an end time.
+    static bool parseClock(const std::string& word, std::uint32_t& minute) {
+        if (word.size() != 5 || word[2] != ':') {
+            return false;
+        }
+        for (std::size_t i : {0, 1, 3, 4}) {
+            if (word[i] < '0' || word[i] > '9') {
+                return false;
+            }
+        }
+        std::uint32_t hours = (word[0] - '0') * 10 + (word[1] - '0');
+        std::uint32_t minutes = (word[3] - '0') * 10 + (word[4] - '0');
+        if (minutes >= 60 || hours > 24 || (hours == 24 && minutes != 0)) {
+            return false;
+        }
+        minute = hours * 60 + minutes;
+        return true;
+    }
+
+    // Read "key value" pairs from words[first..]; every key must be in `allowed`.
+    static bool parseOptions(const std::vector<std::string>& words, std::size_t first,
+                             std::initializer_list<const char*> allowed,
+                             std::unordered_map<std::string, std::string>& options, std::string& error) {
+        if ((words.size() - first) % 2 != 0) {
+            error = "expected key/value pairs";
+            return false;
+        }
+        for (std::size_t i = first; i < words.size(); i += 2) {
+            bool known = false;
+            for (const char* key : allowed) {
+                known |= words[i] == key;
+            }
+            if (!known) {
+                error = "unknown option '" + words[i] + "'";
+                return false;
+            }
+            options[words[i]] = words[i + 1];
+        }
+        return true;
+    }
+
+    static bool option(const std::unordered_map<std::string, std::string>& options, const char* key,
+                       double fallback, double& out, std::string& error) {
+        auto it = options.find(key);
+        if (it == options.end()) {
+            out = fallback;
+            return true;
+        }
+        if (!parseNumber(it->second, out)) {
+            error = std::string("bad number for ") + key + ": '" + it->second + "'";
+            return false;
+        }
+        return true;
+    }
+
+    bool parseRule(const std::vector<std::string>& words, std::string& error) {
+        const std::string& directive = words[0];
+        std::unordered_map<std::string, std::string> options;
+        if (directive == "tier") {
+            RideType type;
+            if (words.size() < 2 || !parseTier(words[1], type)) {
+                error = "expected tier standard|premium";
+                return false;
+            }
+            PricingTierRule& tier = tiers[static_cast<std::size_t>(type)];
+            return parseOptions(words, 2, {"rate", "base", "minimum"}, options, error) &&
+                   option(options, "rate", tier.rate, tier.rate, error) &&
+                   option(options, "base", tier.base, tier.base, error) &&
+                   option(options, "minimum", tier.minimum, tier.minimum, error);
+        }
+        if (directive == "time") {
+            PricingTimeRule rule{0, 0, 1.0, (1u << RIDE_TYPE_COUNT) - 1};
+            std::size_t dash = words.size() >= 2 ? words[1].find('-') : std::string::npos;
+            if (dash == std::string::npos || !parseClock(words[1].substr(0, dash), rule.startMinute) ||
+                !parseClock(words[1].substr(dash + 1), rule.endMinute) || rule.startMinute == 1440) {
+                error = "expected time HH:MM-HH:MM";
+                return false;
+            }
+            if (!parseOptions(words, 2, {"multiplier", "tier"}, options, error) ||
+                !option(options, "multiplier", 1.0, rule.multiplier, error)) {
+                return false;
+            }
+            auto tier = options.find("tier");
+            if (tier != options.end()) {
+                RideType type;
+                if (!parseTier(tier->second, type)) {
+                    error = "unknown tier '" + tier->second + "'";
+                    return false;
+                }
+                rule.tierMask = 1u << static_cast<std::uint32_t>(type);
+            }
+            timeRules.push_back(rule);
+            return true;
+        }
+        if (directive == "zone" || directive == "airport") {
+            if (words.size() < 2) {
+                error = "expected a location name";
+                return false;
+            }
+            PricingZoneRule rule{words[1], 1.0, 0.0, 0.0};
+            if (directive == "airport") {
+                double fee;
+                if (!parseOptions(words, 2, {"fee"}, options, error) || !option(options, "fee", 0.0, fee, error)) {
+                    return false;
+                }
+                rule.pickupFee = fee;
+                rule.dropoffFee = fee;
+            } else if (!parseOptions(words, 2, {"multiplier", "pickup-fee", "dropoff-fee"}, options, error) ||
+                       !option(options, "multiplier", 1.0, rule.multiplier, error) ||
+                       !option(options, "pickup-fee", 0.0, rule.pickupFee, error) ||
+                       !option(options, "dropoff-fee", 0.0, rule.dropoffFee, error)) {
+                return false;
+            }
+            zoneRules.push_back(rule);
+            return true;
+        }
+        error = "unknown rule '" + directive + "'";
+        return false;
+    }
+
+public:
+    // Starts out as the compiled-in tier prices with no other rules.
+    PricingRuleSet() {
+        clear();
+    }
+
+    void clear() {
+        tiers.assign(RIDE_TYPE_COUNT, PricingTierRule{});
+        tiers[static_cast<std::size_t>(RideType::Standard)] =
+            PricingTierRule{StandardFare::RATE_PER_MILE, StandardFare::BASE_FEE + StandardFare::SURCHARGE,
+                            StandardFare::MINIMUM};
+        tiers[static_cast<std::size_t>(RideType::Premium)] =
+            PricingTierRule{PremiumFare::RATE_PER_MILE, PremiumFare::BASE_FEE + PremiumFare::SURCHARGE,
+                            PremiumFare::MINIMUM};
+        timeRules.clear();
+        zoneRules.clear();
+    }
+
+    // Parse rule text, replacing any previous rules. On failure `error`
+    // names the offending line and the rule set is left empty of rules.
+    bool parse(const std::string& text, std::string& error) {
+        clear();
+        std::istringstream lines(text);
+        std::string line;
+        std::vector<std::string> words;
+        for (std::size_t number = 1; std::getline(lines, line); ++number) {
+            std::string reason;
+            if (!tokenize(line, words)) {
+                reason = "unterminated quote";
+            } else if (words.empty() || parseRule(words, reason)) {
+                continue;
+            }
+            error = "line " + std::to_string(number) + ": " + reason;
+            clear();
+            return false;
+        }
+        return true;
+    }
+
+    bool load(const std::string& path, std::string& error) {
+        std::ifstream file(path);
+        if (!file) {
+            error = "cannot read " + path;
+            return false;
+        }
+        std::ostringstream text;
+        text << file.rdbuf();
+        return parse(text.str(), error);
+    }
+
+    const std::vector<PricingTierRule>& getTiers() const { return tiers; }
+    const std::vector<PricingTimeRule>& getTimeRules() const { return timeRules; }
+    const std::vector<PricingZoneRule>& getZoneRules() const { return zoneRules; }
+};
+
+// One trip to price through the indexed/batch API. Zones are table entries
+// from PricingTable::zoneOf().
+struct PricingInput {
+    double distance;
+    TimestampMs time;
+    std::uint32_t pickupZone;
+    std::uint32_t dropoffZone;
+    RideType type;
+};
+
+// A rule set compiled to flat arrays:
+// - one row per tier (rate, base, minimum)
+// - a minute-of-day multiplier table per tier, with every overlapping time
+//   rule already multiplied in
+// - one entry per named zone (multiplier, pickup fee, dropoff fee), plus a
+//   neutral entry for every other location
+// Evaluating a fare is then a fixed sequence of table loads, multiplies and
+// one max, with no branches on the rules themselves.
+class PricingTable {
+private:
+    struct TierRow {
+        double rate;
+        double base;
+        double minimum;
+    };
+
+    struct ZoneRow {
+        double multiplier;
+        double pickupFee;
+        double dropoffFee;
+    };
+
+    static constexpr std::uint32_t MINUTES_PER_DAY = 24 * 60;
+
+    std::vector<TierRow> tierRows;
+    std::vector<double> timeMultipliers; // [tier * MINUTES_PER_DAY + minute]
+    std::vector<ZoneRow> zones;          // last entry is the neutral zone
+    std::unordered_map<std::string, std::uint32_t> zoneIndex;
+
+public:
+    // Minute of the UTC day, the clock time rules are written in.
+    static std::uint32_t minuteOfDay(TimestampMs at) {
+        TimestampMs minute = (at / 60000) % MINUTES_PER_DAY;
+        return static_cast<std::uint32_t>(minute < 0 ? minute + MINUTES_PER_DAY : minute);
+    }
+
+    PricingTable() : PricingTable(PricingRuleSet()) {}
+
+    explicit PricingTable(const PricingRuleSet& rules) {
+        for (const PricingTierRule& tier : rules.getTiers()) {
+            tierRows.push_back(TierRow{tier.rate, tier.base, tier.minimum});
+        }
+        timeMultipliers.assign(tierRows.size() * MINUTES_PER_DAY, 1.0);
+        for (const PricingTimeRule& rule : rules.getTimeRules()) {
+            for (std::uint32_t tier = 0; tier < tierRows.size(); ++tier) {
+                if ((rule.tierMask & (1u << tier)) == 0) {
+                    continue;
+                }
+                std::uint32_t length = rule.endMinute > rule.startMinute
+                                           ? rule.endMinute - rule.startMinute
+                                           : rule.endMinute + MINUTES_PER_DAY - rule.startMinute;
+                for (std::uint32_t k = 0; k < length; ++k) {
+                    timeMultipliers[tier * MINUTES_PER_DAY + (rule.startMinute + k) % MINUTES_PER_DAY] *= rule.multiplier;
+                }
+            }
+        }
+        for (const PricingZoneRule& rule : rules.getZoneRules()) {
+            auto inserted = zoneIndex.emplace(rule.location, static_cast<std::uint32_t>(zones.size()));
+            if (inserted.second) {
+                zones.push_back(ZoneRow{1.0, 0.0, 0.0});
+            }
+            ZoneRow& zone = zones[inserted.first->second];
+            zone.multiplier *= rule.multiplier;
+            zone.pickupFee += rule.pickupFee;
+            zone.dropoffFee += rule.dropoffFee;
+        }
+        zones.push_back(ZoneRow{1.0, 0.0, 0.0});
+    }
+
+    // Table entry for a location name; unnamed locations share the neutral entry.
+    // Resolve names once and price with the indexed API on hot paths.
+    std::uint32_t zoneOf(const std::string& location) const {
+        auto it = zoneIndex.find(location);
+        return it != zoneIndex.end() ? it->second : neutralZone();
+    }
+
+    std::uint32_t neutralZone() const {
+        return static_cast<std::uint32_t>(zones.size() - 1);
+    }
+
+    double fare(RideType type, std::uint32_t pickupZone, std::uint32_t dropoffZone, double distance,
+                TimestampMs at) const {
+        std::size_t tier = static_cast<std::size_t>(type);
+        const TierRow& row = tierRows[tier];
+        const ZoneRow& pickup = zones[pickupZone];
+        double total = (row.base + distance * row.rate) * timeMultipliers[tier * MINUTES_PER_DAY + minuteOfDay(at)] *
+                       pickup.multiplier;
+        total = total < row.minimum ? row.minimum : total;
+        return total + pickup.pickupFee + zones[dropoffZone].dropoffFee;
+    }
+
+    double fare(RideType type, const std::string& pickup, const std::string& dropoff, double distance,
+                TimestampMs at) const {
+        return fare(type, zoneOf(pickup), zoneOf(dropoff), distance, at);
+    }
+
+    void fareBatch(const PricingInput* trips, double* fares, std::size_t n) const {
+        for (std::size_t i = 0; i < n; ++i) {
+            const PricingInput& trip = trips[i];
+            fares[i] = fare(trip.type, trip.pickupZone, trip.dropoffZone, trip.distance, trip.time);
+        }
+    }
+
+    std::size_t zoneCount() const {
+        return zones.size() - 1;
+    }
+};
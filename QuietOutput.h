@@ -0,0 +1,29 @@
+// QuietOutput.h - Silence std::cout while driving the printing APIs at scale
+
+#pragma once
+
+#include <iostream>
+#include <streambuf>
+
+// Stream buffer that discards everything written to it.
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+// Redirects std::cout to a NullBuffer for the lifetime of the object, so
+// Rider::requestRide and friends can be called millions of times without
+// flooding the terminal. The formatting work still happens and is measured.
+class QuietCout {
+private:
+    NullBuffer nullBuffer;
+    std::streambuf* previous;
+
+public:
+    QuietCout() : previous(std::cout.rdbuf(&nullBuffer)) {}
+    ~QuietCout() { std::cout.rdbuf(previous); }
+
+    QuietCout(const QuietCout&) = delete;
+    QuietCout& operator=(const QuietCout&) = delete;
+};
@@ -0,0 +1,128 @@
+// QuoteCache.h - Concurrent fare quote cache with O(1) invalidation
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <functional>
+#include <cstdint>
+
+#include "Ride.h"
+
+// One cached quote. The sequence number makes the entry a seqlock: odd
+// while a writer is filling it, so readers never see a torn entry.
+// Padded to a cache line, so an entry never straddles two.
+struct alignas(64) QuoteCacheEntry {
+    std::atomic<std::uint32_t> sequence{0};
+    std::atomic<std::uint32_t> version{0}; // cache version when stored; 0 = empty
+    std::atomic<std::uint64_t> key{0};
+    std::atomic<std::uint64_t> epoch{0};   // e.g. SurgeEngine::epoch() when priced
+    std::atomic<double> fare{0.0};
+    std::atomic<double> distance{0.0};     // route distance the fare was priced at
+};
+
+// A direct-mapped cache of fare quotes keyed by route and tier, shared by any
+// number of threads without locks:
+// - lookups read an entry under its seqlock and check the key, the cache
+//   version and the caller's epoch; a hit returns the fare and the route
+//   distance it was priced at, so it skips both the distance lookup and
+//   pricing
+// - stores claim the entry with one compare-and-swap and give up if another
+//   thread is writing it (the quote is simply not cached)
+// - invalidate() bumps the cache version, which makes every entry stale in
+//   O(1); call it whenever the pricing rules change
+// Colliding routes evict each other. Keys are 64-bit hashes of the route, so
+// two routes match only if their hashes collide (about 2^-64 per lookup).
+class QuoteCache {
+private:
+    std::vector<QuoteCacheEntry> entries;
+    std::uint64_t mask;
+    std::atomic<std::uint32_t> currentVersion{1};
+
+    static std::size_t roundUpToPowerOfTwo(std::size_t n) {
+        std::size_t size = 1;
+        while (size < n) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    static std::uint64_t mix(std::uint64_t h, std::uint64_t value) {
+        h ^= value + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+        return h;
+    }
+
+public:
+    // `capacity` is rounded up to a power of two.
+    explicit QuoteCache(std::size_t capacity = 16384)
+        : entries(roundUpToPowerOfTwo(capacity)), mask(entries.size() - 1) {}
+
+    QuoteCache(const QuoteCache&) = delete;
+    QuoteCache& operator=(const QuoteCache&) = delete;
+
+    // Key for a quote: the route, the tier and a time slot (e.g. minute of
+    // day for time-of-day rules). The trip distance is a property of the
+    // route, so it is stored with the entry rather than hashed into the key;
+    // callers can look a quote up before they know the distance.
+    static std::uint64_t keyOf(RideType type, const std::string& pickup, const std::string& dropoff,
+                               std::uint32_t timeSlot) {
+        std::uint64_t h = std::hash<std::string>()(pickup);
+        h = mix(h, std::hash<std::string>()(dropoff));
+        h = mix(h, (static_cast<std::uint64_t>(type) << 32) | timeSlot);
+        return h * 0xD6E8FEB86659FD93ull;
+    }
+
+    bool lookup(std::uint64_t key, std::uint64_t epoch, double& fare, double& distance) const {
+        const QuoteCacheEntry& entry = entries[(key >> 17) & mask];
+        std::uint32_t before = entry.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            return false;
+        }
+        std::uint64_t storedKey = entry.key.load(std::memory_order_relaxed);
+        std::uint32_t storedVersion = entry.version.load(std::memory_order_relaxed);
+        std::uint64_t storedEpoch = entry.epoch.load(std::memory_order_relaxed);
+        double storedFare = entry.fare.load(std::memory_order_relaxed);
+        double storedDistance = entry.distance.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.sequence.load(std::memory_order_relaxed) != before || storedKey != key ||
+            storedVersion != currentVersion.load(std::memory_order_acquire) || storedEpoch != epoch) {
+            return false;
+        }
+        fare = storedFare;
+        distance = storedDistance;
+        return true;
+    }
+
+    // Cache a fare priced under `pricedVersion`, the version() read before
+    // pricing started: if the cache was invalidated meanwhile, the entry is
+    // stale on arrival instead of serving a fare from the old rules.
+    void store(std::uint64_t key, std::uint64_t epoch, double fare, double distance, std::uint32_t pricedVersion) {
+        QuoteCacheEntry& entry = entries[(key >> 17) & mask];
+        std::uint32_t sequence = entry.sequence.load(std::memory_order_relaxed);
+        if ((sequence & 1) ||
+            !entry.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire)) {
+            return; // another thread is writing this entry
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        entry.key.store(key, std::memory_order_relaxed);
+        entry.version.store(pricedVersion, std::memory_order_relaxed);
+        entry.epoch.store(epoch, std::memory_order_relaxed);
+        entry.fare.store(fare, std::memory_order_relaxed);
+        entry.distance.store(distance, std::memory_order_relaxed);
+        entry.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Drop every cached quote in O(1).
+    void invalidate() {
+        currentVersion.fetch_add(1, std::memory_order_release);
+    }
+
+    std::uint32_t version() const {
+        return currentVersion.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const {
+        return entries.size();
+    }
+};
@@ -0,0 +1,355 @@
+// Ride.h - Ride lifecycle and the Ride class hierarchy
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <iomanip> // For std::fixed and std::setprecision
+#include <array> // For per-status timestamps and counters
+#include <chrono> // For stamping status transitions
+#include <cstdint> // For fixed-width status and timestamp types
+#include <atomic> // For the per-thread state counters
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Trace.h"
+#include "AllocTracker.h"
+
+// 0. Ride Lifecycle
+// Every ride moves through a fixed set of states. The status is stored as a
+// single byte per ride; the transition table below decides which moves are legal.
+enum class RideStatus : std::uint8_t {
+    Requested,
+    Matched,
+    EnRoute,
+    InProgress,
+    Completed,
+    Cancelled,
+    Scheduled // booked for a future pickup, not yet in the dispatch pipeline
+};
+
+constexpr std::size_t RIDE_STATUS_COUNT = 7;
+
+// Milliseconds since the Unix epoch. Transitions take an explicit timestamp so
+// callers replaying or simulating traffic can supply their own clock.
+using TimestampMs = std::int64_t;
+
+constexpr TimestampMs MS_PER_DAY = 24 * 60 * 60 * 1000;
+
+// Days since the epoch (UTC days) for a timestamp, flooring so before-epoch
+// times land on negative days.
+inline std::int64_t dayOf(TimestampMs at) {
+    std::int64_t day = at / MS_PER_DAY;
+    return (at % MS_PER_DAY < 0) ? day - 1 : day;
+}
+
+inline TimestampMs currentTimeMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+inline const char* rideStatusName(RideStatus status) {
+    static constexpr const char* NAMES[RIDE_STATUS_COUNT] = {
+        "Requested", "Matched", "En Route", "In Progress", "Completed", "Cancelled", "Scheduled"
+    };
+    return NAMES[static_cast<std::size_t>(status)];
+}
+
+// One bit per allowed target state, indexed by the current state.
+// A matched ride may fall back to Requested if the driver does not accept it.
+// A requested ride may be deferred to a future pickup (Scheduled) and is
+// released back to Requested when its pickup time approaches.
+inline bool isValidTransition(RideStatus from, RideStatus to) {
+    static constexpr std::uint8_t ALLOWED[RIDE_STATUS_COUNT] = {
+        /* Requested  */ (1u << 1) | (1u << 5) | (1u << 6),
+        /* Matched    */ (1u << 0) | (1u << 2) | (1u << 5),
+        /* EnRoute    */ (1u << 3) | (1u << 5),
+        /* InProgress */ (1u << 4),
+        /* Completed  */ 0,
+        /* Cancelled  */ 0,
+        /* Scheduled  */ (1u << 0) | (1u << 5)
+    };
+    return (ALLOWED[static_cast<std::size_t>(from)] >> static_cast<unsigned>(to)) & 1u;
+}
+
+// The concrete ride tiers, for code that records or counts rides by type.
+enum class RideType : std::uint8_t {
+    Standard,
+    Premium
+};
+
+constexpr std::size_t RIDE_TYPE_COUNT = 2;
+
+inline const char* rideTypeName(RideType type) {
+    return type == RideType::Premium ? "Premium" : "Standard";
+}
+
+// Live-ride counts for one thread, one cell per state. Only the owning thread
+// writes its cells (a relaxed load and store, no locked instruction); readers
+// sum the cells of every thread. A ride destroyed on a different thread than
+// the one that created it makes single cells wrap, but the unsigned sum is exact.
+struct RideStateCells {
+    std::array<std::atomic<std::size_t>, RIDE_STATUS_COUNT> counts{};
+
+    void add(RideStatus s, std::size_t delta) {
+        std::atomic<std::size_t>& cell = counts[static_cast<std::size_t>(s)];
+        cell.store(cell.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+};
+
+// 1. Ride Class (Base Class)
+class Ride {
+protected:
+    std::string rideID;
+    std::string pickupLocation;
+    std::string dropoffLocation;
+    double distance; // in miles
+    double fare;
+    RideStatus status;
+    std::array<TimestampMs, RIDE_STATUS_COUNT> statusTimes; // 0 = state never entered
+    TimestampMs requestTime; // first request; unlike statusTimes, never re-stamped
+
+    // Number of live rides currently in each state, maintained on every
+    // construction, transition and destruction so counts are cheap to read.
+    // Kept per thread so simulations can create rides on many threads at once.
+    inline static std::mutex stateCellsMutex;
+    inline static std::vector<std::unique_ptr<RideStateCells>> stateCells;
+
+    static RideStateCells& localStateCells() {
+        thread_local RideStateCells* cells = nullptr;
+        if (cells == nullptr) {
+            std::lock_guard<std::mutex> lock(stateCellsMutex);
+            stateCells.push_back(std::make_unique<RideStateCells>());
+            cells = stateCells.back().get();
+        }
+        return *cells;
+    }
+
+public:
+    Ride(const std::string& id, const std::string& pickup, const std::string& dropoff, double dist)
+        : Ride(id, pickup, dropoff, dist, currentTimeMs()) {}
+
+    Ride(const std::string& id, const std::string& pickup, const std::string& dropoff, double dist,
+         TimestampMs requestedAt)
+        : distance(dist), fare(0.0), status(RideStatus::Requested), statusTimes{}, requestTime(requestedAt) {
+        // Assigned in the body so the string copies are charged to ride creation.
+        AllocScope scope(AllocTag::RideCreation);
+        rideID = id;
+        pickupLocation = pickup;
+        dropoffLocation = dropoff;
+        statusTimes[static_cast<std::size_t>(RideStatus::Requested)] = requestedAt;
+        localStateCells().add(RideStatus::Requested, 1);
+    }
+
+    // Rides are tracked by the state counters, so they are not copyable.
+    Ride(const Ride&) = delete;
+    Ride& operator=(const Ride&) = delete;
+
+    // Charge the ride objects themselves to ride creation, wherever they are made.
+    static void* operator new(std::size_t size) {
+        AllocScope scope(AllocTag::RideCreation);
+        return ::operator new(size);
+    }
+
+    static void operator delete(void* p) {
+        ::operator delete(p);
+    }
+
+    // Virtual destructor: Essential for correct polymorphic deletion
+    // Ensures that derived class destructors are called when
+    // a base class pointer (like unique_ptr<Ride>) deletes a derived object.
+    virtual ~Ride() {
+        localStateCells().add(status, ~std::size_t(0));
+    }
+
+    // Move the ride to a new state. Returns false (and leaves the ride untouched)
+    // if the transition table does not allow the move.
+    bool transitionTo(RideStatus next, TimestampMs at) {
+        if (!isValidTransition(status, next)) {
+            return false;
+        }
+        RideStateCells& cells = localStateCells();
+        cells.add(status, ~std::size_t(0));
+        cells.add(next, 1);
+        status = next;
+        statusTimes[static_cast<std::size_t>(next)] = at;
+        return true;
+    }
+
+    bool transitionTo(RideStatus next) {
+        return transitionTo(next, currentTimeMs());
+    }
+
+    RideStatus getStatus() const {
+        return status;
+    }
+
+    // Time the ride last entered the given state, or 0 if it never did.
+    TimestampMs getStatusTime(RideStatus s) const {
+        return statusTimes[static_cast<std::size_t>(s)];
+    }
+
+    // Time the ride was created (first requested). Fixed for the ride's
+    // life, whereas getStatusTime(RideStatus::Requested) moves when a
+    // scheduled ride is released or a matched ride falls back to Requested.
+    TimestampMs getRequestedAt() const {
+        return requestTime;
+    }
+
+    // Count of live rides in a state, for dashboards. Costs one load per
+    // thread that has ever created or moved a ride.
+    static std::size_t countInState(RideStatus s) {
+        std::lock_guard<std::mutex> lock(stateCellsMutex);
+        std::size_t total = 0;
+        for (const auto& cells : stateCells) {
+            total += cells->counts[static_cast<std::size_t>(s)].load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    // Virtual method for fare calculation - demonstrates polymorphism
+    virtual void calculateFare() = 0; // Pure virtual function, makes Ride an abstract class
+
+    virtual RideType getType() const = 0;
+
+    // Method to display ride information
+    void rideDetails() const {
+        TRACE_SPAN("Ride::rideDetails");
+        AllocScope scope(AllocTag::Reporting);
+        std::cout << "Ride ID: " << rideID << std::endl;
+        std::cout << "  Pickup: " << pickupLocation << std::endl;
+        std::cout << "  Dropoff: " << dropoffLocation << std::endl;
+        std::cout << "  Distance: " << std::fixed << std::setprecision(1) << distance << " miles" << std::endl;
+        std::cout << "  Fare: $" << std::fixed << std::setprecision(2) << fare << std::endl;
+        std::cout << "  Status: " << rideStatusName(status) << std::endl;
+    }
+
+    double getFare() const {
+        return fare;
+    }
+
+    // Replace the tier's fare with one priced elsewhere (e.g. by a
+    // PricingTable). calculateFare() restores the tier's own fare.
+    void setFare(double priced) {
+        fare = priced;
+    }
+
+    double getDistance() const {
+        return distance;
+    }
+
+    // Scale the priced fare by a surge multiplier (see SurgeEngine). Apply
+    // once, after construction; calculateFare() resets the base fare.
+    void applySurge(double multiplier) {
+        fare *= multiplier;
+    }
+
+    std::string getRideID() const {
+        return rideID;
+    }
+
+    const std::string& getPickupLocation() const {
+        return pickupLocation;
+    }
+
+    const std::string& getDropoffLocation() const {
+        return dropoffLocation;
+    }
+};
+
+// 2. Fare policies
+// A fare policy is a type. Its parameters are in cents (C++17 does not allow
+// floating-point template arguments) and become dollar constants at compile
+// time, so a tier's fare function inlines to a multiply and an add or two and
+// can be evaluated in constant expressions. Terms that are zero for a tier
+// (no base fee, no minimum) are compiled out, not added as 0.
+template <std::uint32_t RateCentsPerMile, std::uint32_t BaseFeeCents, std::uint32_t SurchargeCents,
+          std::uint32_t MinimumCents>
+struct FarePolicy {
+    static constexpr double RATE_PER_MILE = RateCentsPerMile / 100.0;
+    static constexpr double BASE_FEE = BaseFeeCents / 100.0;
+    static constexpr double SURCHARGE = SurchargeCents / 100.0; // tier's flat extra
+    static constexpr double MINIMUM = MinimumCents / 100.0;     // fare floor
+
+    static constexpr double fare(double dist) {
+        double total = dist * RATE_PER_MILE;
+        if constexpr (BaseFeeCents != 0) {
+            total += BASE_FEE;
+        }
+        if constexpr (SurchargeCents != 0) {
+            total += SURCHARGE;
+        }
+        if constexpr (MinimumCents != 0) {
+            total = total < MINIMUM ? MINIMUM : total;
+        }
+        return total;
+    }
+
+    // Price n trips. The body is branch-free per element, so each tier gets
+    // its own vectorised loop with the constants folded in.
+    static void fareBatch(const double* distances, double* fares, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) {
+            fares[i] = fare(distances[i]);
+        }
+    }
+};
+
+using StandardFare = FarePolicy<200, 0, 0, 0>;  // $2.00/mile
+using PremiumFare = FarePolicy<350, 0, 500, 0>; // $3.50/mile + $5.00
+
+static_assert(StandardFare::fare(10.0) == 20.0, "standard fare changed");
+static_assert(PremiumFare::fare(10.0) == 40.0, "premium fare changed");
+
+// 3. Ride tiers
+// A tier is a RideType bound to a fare policy. Adding one takes an enum
+// value, a FarePolicy and an alias below, plus a case in the dispatchers.
+template <RideType Type, typename Fare>
+class TieredRide : public Ride {
+public:
+    using Policy = Fare;
+    static constexpr RideType TYPE = Type;
+
+    TieredRide(const std::string& id, const std::string& pickup, const std::string& dropoff, double dist)
+        : Ride(id, pickup, dropoff, dist) {
+        calculateFare(); // Calculate fare upon construction
+    }
+
+    TieredRide(const std::string& id, const std::string& pickup, const std::string& dropoff, double dist,
+               TimestampMs requestedAt)
+        : Ride(id, pickup, dropoff, dist, requestedAt) {
+        calculateFare();
+    }
+
+    // Fare for a trip of the given length, without creating a ride (for quotes).
+    static constexpr double fareFor(double dist) {
+        return Fare::fare(dist);
+    }
+
+    void calculateFare() override {
+        TRACE_SPAN("TieredRide::calculateFare");
+        fare = fareFor(distance);
+    }
+
+    RideType getType() const override {
+        return Type;
+    }
+};
+
+using StandardRide = TieredRide<RideType::Standard, StandardFare>;
+using PremiumRide = TieredRide<RideType::Premium, PremiumFare>;
+
+// Fare for a trip in the given tier.
+inline double fareFor(RideType type, double dist) {
+    return type == RideType::Premium ? PremiumRide::fareFor(dist) : StandardRide::fareFor(dist);
+}
+
+// Price a batch of trips of one tier: dispatch once, then run that tier's
+// kernel over the whole batch.
+inline void fareBatch(RideType type, const double* distances, double* fares, std::size_t n) {
+    if (type == RideType::Premium) {
+        PremiumFare::fareBatch(distances, fares, n);
+    } else {
+        StandardFare::fareBatch(distances, fares, n);
+    }
+}
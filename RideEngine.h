@@ -0,0 +1,368 @@
+// RideEngine.h - Single entry point for inbound ride traffic, with record/replay
+
+#pragma once
+
+#include <deque>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+
+#include "Ride.h"
+#include "Driver.h"
+#include "Rider.h"
+#include "TrafficLog.h"
+#include "Metrics.h"
+#include "PricingRules.h"
+#include "SurgeEngine.h"
+#include "QuoteCache.h"
+#include "Sketches.h"
+
+using RiderHandle = std::uint32_t;
+using DriverHandle = std::uint32_t;
+
+// Zones for RideEngine::setSurge() in loadgen and replay; both sides of a
+// recording must use the same count.
+constexpr std::size_t ENGINE_SURGE_ZONES = 256;
+
+// Construct a ride of the given tier.
+inline std::unique_ptr<Ride> makeRide(RideType type, const std::string& id, const std::string& pickup,
+                                      const std::string& dropoff, double distance, TimestampMs requestedAt) {
+    if (type == RideType::Premium) {
+        return std::make_unique<PremiumRide>(id, pickup, dropoff, distance, requestedAt);
+    }
+    return std::make_unique<StandardRide>(id, pickup, dropoff, distance, requestedAt);
+}
+
+// Owns the riders and drivers and accepts every inbound call: registering
+// riders and drivers, requestRide, addRide (a driver's completed trip) and
+// fare quotes. Riders and drivers are addressed by the dense handle returned
+// when they were added.
+//
+// With a TrafficRecorder attached, every call is appended to a traffic log
+// before it runs; apply() runs a decoded call through the same entry points,
+// so a replay is a loop over a TrafficReader.
+// The engine keeps a running digest (a multiply-rotate hash over each call's
+// handle, the ride's ID, status and locations, and the exact bits of the fare
+// it produced), so two builds replaying the same log can be compared with one
+// number. Strings are hashed with FNV-1a, not std::hash, so the digest does
+// not depend on the standard library.
+//
+// requestRide and addRide reject a handle the engine never issued: nothing is
+// recorded or digested and they return REJECTED.
+class RideEngine {
+private:
+    std::deque<Rider> riders;   // deque: references stay valid as the city grows
+    std::deque<Driver> drivers;
+    TrafficRecorder* recorder = nullptr;
+    const PricingTable* pricing = nullptr;
+    QuoteCache* quoteCache = nullptr;
+    RideHistoryPolicy historyPolicy;
+    RideSketches* sketches = nullptr;
+    SurgeEngine* surge = nullptr;
+    TimestampMs surgeTickMs = 5 * 1000;
+    TimestampMs nextSurgeUpdate = 0;
+    bool surgeClockStarted = false;
+    std::uint64_t digestState = 0xCBF29CE484222325ull;
+    std::uint64_t calls = 0;
+
+    void mix(std::uint64_t value) {
+        digestState ^= value * 0x9E3779B97F4A7C15ull;
+        digestState = ((digestState << 27) | (digestState >> 37)) * 0x94D049BB133111EBull;
+    }
+
+    void mixFare(TrafficOp op, std::uint64_t handle, double fare) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &fare, sizeof(bits));
+        mix(static_cast<std::uint64_t>(op));
+        mix(handle);
+        mix(bits);
+        ++calls;
+    }
+
+    static std::uint64_t digestString(const std::string& s) {
+        std::uint64_t h = 0xCBF29CE484222325ull;
+        for (unsigned char c : s) {
+            h = (h ^ c) * 0x100000001B3ull;
+        }
+        return h;
+    }
+
+    void mixRide(TrafficOp op, std::uint64_t handle, const std::string& rideID, RideStatus status,
+                 const std::string& pickup, const std::string& dropoff, double fare) {
+        mix(digestString(rideID));
+        mix(static_cast<std::uint64_t>(status));
+        mix(digestString(pickup));
+        mix(digestString(dropoff));
+        mixFare(op, handle, fare);
+    }
+
+    // Shared quote path. With `expectedDistance`, a cached quote priced at
+    // another distance counts as a miss and is re-priced.
+    template <typename RouteDistance>
+    double quoteWith(TimestampMs at, RideType type, const std::string& pickup, const std::string& dropoff,
+                     RouteDistance&& routeDistance, const double* expectedDistance) {
+        advanceSurge(at);
+        double fare;
+        double distance;
+        if (quoteCache == nullptr) {
+            distance = routeDistance();
+            fare = priceQuote(at, type, pickup, dropoff, distance);
+        } else {
+            // Time-of-day rules make the fare depend on the minute; the
+            // built-in policies don't. Quotes priced before the last surge
+            // change carry an older epoch and miss.
+            std::uint32_t slot = pricing != nullptr ? PricingTable::minuteOfDay(at) : 0;
+            std::uint64_t key = QuoteCache::keyOf(type, pickup, dropoff, slot);
+            std::uint64_t epoch = surge != nullptr ? surge->epoch() : 0;
+            std::uint32_t version = quoteCache->version();
+            if (quoteCache->lookup(key, epoch, fare, distance) &&
+                (expectedDistance == nullptr || distance == *expectedDistance)) {
+                RideMetrics::quoteCacheHits.increment();
+            } else {
+                distance = routeDistance();
+                fare = priceQuote(at, type, pickup, dropoff, distance);
+                quoteCache->store(key, epoch, fare, distance, version);
+                RideMetrics::quoteCacheMisses.increment();
+            }
+        }
+        if (recorder != nullptr) {
+            recorder->quote(at, type, pickup, dropoff, distance);
+        }
+        RideMetrics::quotes.increment();
+        mix(digestString(pickup));
+        mix(digestString(dropoff));
+        mixFare(TrafficOp::Quote, static_cast<std::uint64_t>(type), fare);
+        return fare;
+    }
+
+    double priceQuote(TimestampMs at, RideType type, const std::string& pickup, const std::string& dropoff,
+                      double distance) const {
+        double fare = pricing != nullptr ? pricing->fare(type, pickup, dropoff, distance, at) : fareFor(type, distance);
+        return surge != nullptr ? fare * surge->multiplier(surgeZoneOf(pickup)) : fare;
+    }
+
+    std::size_t surgeZoneOf(const std::string& pickup) const {
+        return static_cast<std::size_t>(digestString(pickup) % surge->zoneCount());
+    }
+
+    // Run every surge update due by `at`, on the calls' own clock.
+    void advanceSurge(TimestampMs at) {
+        if (surge == nullptr) {
+            return;
+        }
+        if (!surgeClockStarted) {
+            surgeClockStarted = true;
+            nextSurgeUpdate = at + surgeTickMs;
+        }
+        while (at >= nextSurgeUpdate) {
+            surge->update();
+            nextSurgeUpdate += surgeTickMs;
+        }
+    }
+
+public:
+    static constexpr double REJECTED = -1.0; // fare returned for an unknown handle
+
+    RideEngine() = default;
+    RideEngine(const RideEngine&) = delete;
+    RideEngine& operator=(const RideEngine&) = delete;
+
+    // Record every subsequent call to `log` (nullptr stops recording).
+    void setRecorder(TrafficRecorder* log) {
+        recorder = log;
+    }
+
+    // Price quotes and rides with compiled pricing rules instead of the
+    // tiers' built-in fare policies (nullptr restores those). A replay must
+    // use the same rules as the recording to reproduce its digest.
+    void setPricing(const PricingTable* table) {
+        pricing = table;
+        if (quoteCache != nullptr) {
+            quoteCache->invalidate();
+        }
+    }
+
+    // Serve repeated quotes from `cache` (nullptr turns caching off). The
+    // cache may be shared with other engines using the same pricing.
+    void setQuoteCache(QuoteCache* cache) {
+        quoteCache = cache;
+        if (quoteCache != nullptr) {
+            quoteCache->invalidate();
+        }
+    }
+
+    // Price quotes and rides with per-zone surge from `surgeEngine`
+    // (nullptr turns surge off). The engine feeds it from its own calls, so
+    // a replay with the same zone count reproduces every multiplier:
+    // - a pickup location's zone is a hash of its name
+    // - each requestRide counts as demand in its pickup zone
+    // - drivers have no position here: each counts as free supply in zone
+    //   (handle mod zone count), and completed trips never take them off it
+    // - update() runs every `tickMs` of call time
+    void setSurge(SurgeEngine* surgeEngine, TimestampMs tickMs = 5 * 1000) {
+        surge = surgeEngine;
+        surgeTickMs = tickMs > 0 ? tickMs : 1;
+        surgeClockStarted = false;
+        if (quoteCache != nullptr) {
+            quoteCache->invalidate();
+        }
+        if (surge != nullptr) {
+            for (std::size_t d = 0; d < drivers.size(); ++d) {
+                surge->driverFreed(d % surge->zoneCount());
+            }
+        }
+    }
+
+    // Feed every requested ride to `rideSketches` (nullptr stops). Riders
+    // are counted by ID, so sketches from several engines merge correctly.
+    void setSketches(RideSketches* rideSketches) {
+        sketches = rideSketches;
+    }
+
+    // Cap the ride histories of every rider and driver, current and future.
+    // Nothing else holds on to the engine's rides, so unfinished rider
+    // records (which the engine never advances) are folded like any other.
+    void setHistoryPolicy(const RideHistoryPolicy& policy) {
+        historyPolicy = policy;
+        for (Rider& r : riders) {
+            r.setHistoryPolicy(policy);
+        }
+        for (Driver& d : drivers) {
+            d.setHistoryPolicy(policy);
+        }
+    }
+
+    RiderHandle addRider(TimestampMs at, const std::string& id, const std::string& name) {
+        if (recorder != nullptr) {
+            recorder->addRider(at, id, name);
+        }
+        riders.emplace_back(id, name);
+        if (historyPolicy.recentRides != 0) {
+            riders.back().setHistoryPolicy(historyPolicy);
+        }
+        mixFare(TrafficOp::AddRider, riders.size() - 1, 0.0);
+        return static_cast<RiderHandle>(riders.size() - 1);
+    }
+
+    DriverHandle addDriver(TimestampMs at, const std::string& id, const std::string& name, double rating) {
+        if (recorder != nullptr) {
+            recorder->addDriver(at, id, name, rating);
+        }
+        drivers.emplace_back(id, name, rating);
+        if (historyPolicy.recentRides != 0) {
+            drivers.back().setHistoryPolicy(historyPolicy);
+        }
+        if (surge != nullptr) {
+            surge->driverFreed((drivers.size() - 1) % surge->zoneCount());
+        }
+        mixFare(TrafficOp::AddDriver, drivers.size() - 1, rating);
+        return static_cast<DriverHandle>(drivers.size() - 1);
+    }
+
+    // A rider requests a ride; returns its fare, or REJECTED if `rider` is
+    // not a handle this engine issued.
+    double requestRide(TimestampMs at, RiderHandle rider, RideType type, const std::string& rideID,
+                       const std::string& pickup, const std::string& dropoff, double distance) {
+        if (rider >= riders.size()) {
+            return REJECTED;
+        }
+        if (recorder != nullptr) {
+            recorder->rideCall(TrafficOp::RequestRide, at, rider, type, rideID, pickup, dropoff, distance);
+        }
+        std::unique_ptr<Ride> ride = makeRide(type, rideID, pickup, dropoff, distance, at);
+        if (pricing != nullptr) {
+            ride->setFare(pricing->fare(type, pickup, dropoff, distance, at));
+        }
+        advanceSurge(at);
+        if (surge != nullptr) {
+            std::size_t zone = surgeZoneOf(pickup);
+            surge->recordRequest(zone);
+            ride->applySurge(surge->multiplier(zone));
+        }
+        double fare = ride->getFare();
+        if (sketches != nullptr) {
+            sketches->record(sketchHash(riders[rider].getRiderID()), pickup, dropoff, fare);
+        }
+        RideStatus status = ride->getStatus();
+        riders[rider].requestRide(std::move(ride));
+        mixRide(TrafficOp::RequestRide, rider, rideID, status, pickup, dropoff, fare);
+        return fare;
+    }
+
+    // A driver completes a trip; the completed ride joins their history.
+    // Returns its fare, or REJECTED if `driver` is not a handle this engine
+    // issued.
+    double addRide(TimestampMs at, DriverHandle driver, RideType type, const std::string& rideID,
+                   const std::string& pickup, const std::string& dropoff, double distance) {
+        if (driver >= drivers.size()) {
+            return REJECTED;
+        }
+        if (recorder != nullptr) {
+            recorder->rideCall(TrafficOp::AddRide, at, driver, type, rideID, pickup, dropoff, distance);
+        }
+        std::unique_ptr<Ride> ride = makeRide(type, rideID, pickup, dropoff, distance, at);
+        if (pricing != nullptr) {
+            ride->setFare(pricing->fare(type, pickup, dropoff, distance, at));
+        }
+        advanceSurge(at);
+        if (surge != nullptr) {
+            ride->applySurge(surge->multiplier(surgeZoneOf(pickup)));
+        }
+        ride->transitionTo(RideStatus::Matched, at);
+        ride->transitionTo(RideStatus::EnRoute, at);
+        ride->transitionTo(RideStatus::InProgress, at);
+        ride->transitionTo(RideStatus::Completed, at);
+        double fare = ride->getFare();
+        RideStatus status = ride->getStatus();
+        drivers[driver].addRide(std::move(ride));
+        mixRide(TrafficOp::AddRide, driver, rideID, status, pickup, dropoff, fare);
+        return fare;
+    }
+
+    // Price a trip without creating a ride.
+    double quote(TimestampMs at, RideType type, const std::string& pickup, const std::string& dropoff,
+                 double distance) {
+        return quoteWith(at, type, pickup, dropoff, [distance]() { return distance; }, &distance);
+    }
+
+    // Price a trip whose distance is computed by routeDistance() (e.g. a
+    // routing lookup). A quote cache hit supplies the distance it was priced
+    // at, so routeDistance() is only called on a miss.
+    template <typename RouteDistance>
+    double quoteRoute(TimestampMs at, RideType type, const std::string& pickup, const std::string& dropoff,
+                      RouteDistance&& routeDistance) {
+        return quoteWith(at, type, pickup, dropoff, routeDistance, nullptr);
+    }
+
+    // Run one recorded call. Returns false if it names an unknown rider or driver.
+    bool apply(const TrafficCall& call) {
+        switch (call.op) {
+            case TrafficOp::AddRider:
+                addRider(call.timestamp, call.id, call.name);
+                return true;
+            case TrafficOp::AddDriver:
+                addDriver(call.timestamp, call.id, call.name, call.rating);
+                return true;
+            case TrafficOp::RequestRide:
+                return requestRide(call.timestamp, call.handle, call.type, call.id, *call.pickup, *call.dropoff,
+                                   call.distance) != REJECTED;
+            case TrafficOp::AddRide:
+                return addRide(call.timestamp, call.handle, call.type, call.id, *call.pickup, *call.dropoff,
+                               call.distance) != REJECTED;
+            case TrafficOp::Quote:
+                quote(call.timestamp, call.type, *call.pickup, *call.dropoff, call.distance);
+                return true;
+        }
+        return false;
+    }
+
+    Rider& rider(RiderHandle handle) { return riders.at(handle); }
+    Driver& driver(DriverHandle handle) { return drivers.at(handle); }
+    std::size_t riderCount() const { return riders.size(); }
+    std::size_t driverCount() const { return drivers.size(); }
+
+    // Calls handled so far and the digest of their results.
+    std::uint64_t callCount() const { return calls; }
+    std::uint64_t digest() const { return digestState; }
+};
@@ -0,0 +1,490 @@
+// RideHistory.h - Bounded per-entity ride history with a summarised tail
+
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <memory>
+#include <array>
+#include <functional>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "Ride.h"
+#include "AllocTracker.h"
+
+// File layout of a ride archive (all integers little-endian):
+//   header:  "RSRA" magic, u32 format version
+//   record:  u8 type, u8 status, str ride id, str pickup, str dropoff,
+//            f64 distance, f64 fare, then one zigzag varint per RideStatus
+//            (in enum order) holding the time the ride entered that state
+//            (0 = never)
+//   str = varint length + bytes; f64 = the IEEE-754 bits as a u64.
+constexpr char RIDE_ARCHIVE_MAGIC[4] = {'R', 'S', 'R', 'A'};
+constexpr std::uint32_t RIDE_ARCHIVE_VERSION = 1;
+
+// Appends full ride records to an archive file through a 64 KiB buffer, so
+// rides evicted from in-memory histories can still be looked up offline.
+// One archive may be shared by any number of histories on the same thread.
+class RideArchive {
+private:
+    std::FILE* file = nullptr;
+    std::vector<std::uint8_t> buffer;
+    std::uint64_t rideCount = 0;
+    bool failed = false;
+
+    static constexpr std::size_t BUFFER_BYTES = 64 * 1024;
+
+    void putVarint(std::uint64_t value) {
+        while (value >= 0x80) {
+            buffer.push_back(static_cast<std::uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        buffer.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    void putFixed(std::uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) {
+            buffer.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void putDouble(double value) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        putFixed(bits, 8);
+    }
+
+    void putString(const std::string& s) {
+        putVarint(s.size());
+        buffer.insert(buffer.end(), s.begin(), s.end());
+    }
+
+public:
+    RideArchive() {
+        buffer.reserve(BUFFER_BYTES + 1024);
+    }
+
+    ~RideArchive() {
+        close();
+    }
+
+    RideArchive(const RideArchive&) = delete;
+    RideArchive& operator=(const RideArchive&) = delete;
+
+    // Start a new archive at `path`. Returns false if it cannot be created.
+    bool open(const std::string& path) {
+        close();
+        file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+            return false;
+        }
+        failed = false;
+        rideCount = 0;
+        buffer.insert(buffer.end(), RIDE_ARCHIVE_MAGIC, RIDE_ARCHIVE_MAGIC + 4);
+        putFixed(RIDE_ARCHIVE_VERSION, 4);
+        return true;
+    }
+
+    bool flush() {
+        if (file != nullptr && !buffer.empty()) {
+            failed |= std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size();
+        }
+        buffer.clear();
+        return !failed;
+    }
+
+    // Flush and close. Returns false if any write failed.
+    bool close() {
+        if (file == nullptr) {
+            return !failed;
+        }
+        flush();
+        failed |= std::fclose(file) != 0;
+        file = nullptr;
+        return !failed;
+    }
+
+    bool isOpen() const {
+        return file != nullptr;
+    }
+
+    std::uint64_t archivedRides() const {
+        return rideCount;
+    }
+
+    void append(const Ride& ride) {
+        if (file == nullptr) {
+            return;
+        }
+        buffer.push_back(static_cast<std::uint8_t>(ride.getType()));
+        buffer.push_back(static_cast<std::uint8_t>(ride.getStatus()));
+        putString(ride.getRideID());
+        putString(ride.getPickupLocation());
+        putString(ride.getDropoffLocation());
+        putDouble(ride.getDistance());
+        putDouble(ride.getFare());
+        for (std::size_t s = 0; s < RIDE_STATUS_COUNT; ++s) {
+            std::int64_t at = ride.getStatusTime(static_cast<RideStatus>(s));
+            putVarint((static_cast<std::uint64_t>(at) << 1) ^ static_cast<std::uint64_t>(at >> 63)); // zigzag
+        }
+        ++rideCount;
+        if (buffer.size() >= BUFFER_BYTES) {
+            flush();
+        }
+    }
+};
+
+// How much of a history stays in memory.
+struct RideHistoryPolicy {
+    std::size_t recentRides = 0;     // full rides kept; 0 = keep every ride
+    RideArchive* archive = nullptr;  // if set, folded rides are appended here first
+    // Called with each unfinished ride just before it is folded and freed,
+    // so whatever still points at it (e.g. RideTimeouts::forget) lets go.
+    std::function<void(Ride&)> onFold;
+};
+
+// Totals over the rides folded out of a history.
+struct RideHistorySummary {
+    std::uint64_t rides = 0;
+    double fare = 0.0;
+    double distance = 0.0;
+    std::array<std::uint64_t, RIDE_TYPE_COUNT> tierRides{};
+    std::array<std::uint64_t, RIDE_STATUS_COUNT> statusRides{}; // by status when folded
+    TimestampMs firstRequested = 0; // 0 = no folded rides
+    TimestampMs lastRequested = 0;
+
+    void add(const Ride& ride) {
+        TimestampMs requested = ride.getRequestedAt();
+        if (rides == 0 || requested < firstRequested) {
+            firstRequested = requested;
+        }
+        if (rides == 0 || requested > lastRequested) {
+            lastRequested = requested;
+        }
+        ++rides;
+        fare += ride.getFare();
+        distance += ride.getDistance();
+        ++tierRides[static_cast<std::size_t>(ride.getType())];
+        ++statusRides[static_cast<std::size_t>(ride.getStatus())];
+    }
+};
+
+// Rides ordered by request time (Ride::getRequestedAt(), which never
+// changes once the ride exists), for range queries over a history. Entries
+// sit in sorted blocks of up to BLOCK_ROWS, each tagged with the earliest
+// and latest time it holds; the blocks are in time order (neighbours share
+// at most a boundary time).
+// - a range query binary-searches the block list, then the first block,
+//   and walks forward: O(log n + k) for k rides in the range
+// - rides arriving in time order (the common case) are appended to the
+//   last block; a late ride is inserted into the block covering its time,
+//   which is split in two once it holds 2 * BLOCK_ROWS
+// - removal finds the ride the same way and drops blocks that empty out;
+//   removing a block's earliest ride (as bounded histories do) just
+//   advances the block's head, so nothing is shifted
+// The index holds pointers only; the history owns the rides.
+class RideTimeIndex {
+public:
+    static constexpr std::size_t BLOCK_ROWS = 128;
+
+private:
+    struct Entry {
+        TimestampMs at;
+        const Ride* ride;
+    };
+
+    struct Block {
+        TimestampMs minTime;
+        TimestampMs maxTime;
+        std::vector<Entry> entries; // sorted by time; only [head, end) is live
+        std::size_t head = 0;       // entries erased from the front, skipped rather than shifted
+
+        std::vector<Entry>::iterator begin() { return entries.begin() + static_cast<std::ptrdiff_t>(head); }
+        std::vector<Entry>::const_iterator begin() const {
+            return entries.begin() + static_cast<std::ptrdiff_t>(head);
+        }
+        std::size_t size() const { return entries.size() - head; }
+    };
+
+    std::vector<Block> blocks;
+    std::size_t entryCount = 0;
+
+    static bool entryBefore(const Entry& e, TimestampMs at) {
+        return e.at < at;
+    }
+
+    static bool entryAfter(TimestampMs at, const Entry& e) {
+        return at < e.at;
+    }
+
+    // The first block whose latest time is at or after `at`.
+    std::size_t firstBlockFrom(TimestampMs at) const {
+        auto it = std::lower_bound(blocks.begin(), blocks.end(), at,
+                                   [](const Block& b, TimestampMs t) { return b.maxTime < t; });
+        return static_cast<std::size_t>(it - blocks.begin());
+    }
+
+    void split(std::size_t b) {
+        Block& full = blocks[b];
+        auto middle = full.begin() + static_cast<std::ptrdiff_t>(full.size() / 2);
+        Block upper;
+        upper.entries.assign(middle, full.entries.end());
+        upper.minTime = upper.entries.front().at;
+        upper.maxTime = upper.entries.back().at;
+        full.entries.erase(middle, full.entries.end());
+        full.maxTime = full.entries.back().at;
+        blocks.insert(blocks.begin() + static_cast<std::ptrdiff_t>(b + 1), std::move(upper));
+    }
+
+    void removeEntry(std::size_t b, std::vector<Entry>::iterator it) {
+        Block& block = blocks[b];
+        if (it == block.begin()) {
+            ++block.head; // the usual case: the oldest ride is folded
+        } else {
+            block.entries.erase(it);
+        }
+        --entryCount;
+        if (block.size() == 0) {
+            blocks.erase(blocks.begin() + static_cast<std::ptrdiff_t>(b));
+        } else {
+            block.minTime = block.begin()->at;
+            block.maxTime = block.entries.back().at;
+        }
+    }
+
+public:
+    void insert(const Ride& ride) {
+        TimestampMs at = ride.getRequestedAt();
+        ++entryCount;
+        if (blocks.empty() || at >= blocks.back().maxTime) {
+            if (blocks.empty() || blocks.back().entries.size() >= BLOCK_ROWS) { // full, counting skipped entries
+                blocks.push_back(Block{at, at, {}, 0});
+                if (blocks.size() > 1) {
+                    blocks.back().entries.reserve(BLOCK_ROWS); // the first stays small for short histories
+                }
+            }
+            blocks.back().entries.push_back(Entry{at, &ride});
+            blocks.back().maxTime = at;
+            return;
+        }
+        std::size_t b = firstBlockFrom(at); // exists: at < the last block's maxTime
+        Block& block = blocks[b];
+        auto pos = std::upper_bound(block.begin(), block.entries.end(), at, entryAfter);
+        if (pos == block.begin() && block.head != 0) {
+            block.entries[--block.head] = Entry{at, &ride};
+        } else {
+            block.entries.insert(pos, Entry{at, &ride});
+        }
+        block.minTime = std::min(block.minTime, at);
+        if (block.size() >= 2 * BLOCK_ROWS) {
+            split(b);
+        }
+    }
+
+    // Remove a ride, found by its request time in O(log n + block). If it is
+    // not where its time says (which would mean the key changed after
+    // insertion), every entry is searched, so the index never keeps a
+    // pointer to a ride the history has destroyed. Returns false if the
+    // ride was not indexed at all.
+    bool erase(const Ride& ride) {
+        TimestampMs at = ride.getRequestedAt();
+        for (std::size_t b = firstBlockFrom(at); b < blocks.size() && blocks[b].minTime <= at; ++b) {
+            Block& block = blocks[b];
+            auto it = std::lower_bound(block.begin(), block.entries.end(), at, entryBefore);
+            for (; it != block.entries.end() && it->at == at; ++it) {
+                if (it->ride == &ride) {
+                    removeEntry(b, it);
+                    return true;
+                }
+            }
+        }
+        for (std::size_t b = 0; b < blocks.size(); ++b) {
+            for (auto it = blocks[b].begin(); it != blocks[b].entries.end(); ++it) {
+                if (it->ride == &ride) {
+                    removeEntry(b, it);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Visit the rides requested in [from, to), earliest first.
+    template <typename Visitor>
+    void forEachBetween(TimestampMs from, TimestampMs to, Visitor&& visit) const {
+        for (std::size_t b = firstBlockFrom(from); b < blocks.size() && blocks[b].minTime < to; ++b) {
+            const Block& block = blocks[b];
+            const std::vector<Entry>& entries = block.entries;
+            auto it = block.begin();
+            if (block.minTime < from) {
+                it = std::lower_bound(it, entries.end(), from, entryBefore);
+            }
+            for (; it != entries.end() && it->at < to; ++it) {
+                visit(*it->ride);
+            }
+        }
+    }
+
+    std::size_t size() const {
+        return entryCount;
+    }
+};
+
+// A rider's or driver's rides, oldest first. By default every ride is kept.
+// With a RideHistoryPolicy limit, only the most recent rides stay as full
+// records and older ones are folded into a RideHistorySummary (and spilled to
+// the policy's archive, if any), so memory per entity is capped at the limit
+// plus the summary.
+//
+// The limit is a hard cap: the oldest ride goes first whether or not it has
+// finished, so a rider whose requests are never advanced still holds at
+// most the limit. Anything else pointing at an unfinished ride must let go
+// in the policy's onFold hook. The one exception is Scheduled rides, which
+// their ScheduledRideQueue still points at: they are skipped, and become
+// foldable once released.
+//
+// Trimming costs amortised O(1) per add. Folded rides leave a null slot
+// behind (the deque is compacted once they outnumber the rides), the oldest
+// ride is checked first, and scheduled rides are skipped by a cursor that
+// only moves forward. A ride released after the cursor passed it is folded
+// when it becomes the oldest, or on a rescan from the front, which runs at
+// most once per `recent.size()` adds.
+//
+// The rides held in full are also indexed by request time, so
+// forEachBetween() finds the k rides in a time range in O(log n + k).
+class RideHistory {
+private:
+    std::deque<std::unique_ptr<Ride>> recent; // oldest first; null = folded out of the middle
+    std::size_t live = 0;                     // non-null rides in `recent`
+    std::size_t scanFrom = 1;                 // rides in [1, scanFrom) could not be folded when last checked
+    std::size_t rescanCredit = 0;             // adds since the last rescan from the front
+    RideTimeIndex byRequestTime;              // the rides in `recent`
+    RideHistoryPolicy policy;
+    RideHistorySummary folded;
+
+    static bool isFinished(const Ride& ride) {
+        RideStatus status = ride.getStatus();
+        return status == RideStatus::Completed || status == RideStatus::Cancelled;
+    }
+
+    static bool canFold(const Ride& ride) {
+        return ride.getStatus() != RideStatus::Scheduled;
+    }
+
+    void fold(std::size_t index) {
+        Ride& ride = *recent[index];
+        if (policy.onFold && !isFinished(ride)) {
+            policy.onFold(ride);
+        }
+        if (policy.archive != nullptr) {
+            policy.archive->append(ride);
+        }
+        folded.add(ride);
+        byRequestTime.erase(ride);
+        recent[index].reset();
+        --live;
+        while (!recent.empty() && !recent.front()) {
+            recent.pop_front();
+            if (scanFrom > 1) {
+                --scanFrom;
+            }
+        }
+        if (recent.size() - live > live + 64) {
+            compact();
+        }
+    }
+
+    void compact() {
+        recent.erase(std::remove(recent.begin(), recent.end(), nullptr), recent.end());
+        scanFrom = 1; // indices moved; paid for by the folds that made the holes
+    }
+
+    void trim() {
+        while (policy.recentRides != 0 && live > policy.recentRides) {
+            if (canFold(*recent.front())) {
+                fold(0); // rides skipped earlier may have been released since
+                continue;
+            }
+            while (scanFrom < recent.size() && (!recent[scanFrom] || !canFold(*recent[scanFrom]))) {
+                ++scanFrom;
+            }
+            if (scanFrom == recent.size()) {
+                if (rescanCredit < recent.size() || recent.size() <= 1) {
+                    return; // every ride left is scheduled
+                }
+                rescanCredit = 0;
+                scanFrom = 1;
+                continue;
+            }
+            fold(scanFrom);
+        }
+    }
+
+public:
+    RideHistory() = default;
+    RideHistory(const RideHistory&) = delete;
+    RideHistory& operator=(const RideHistory&) = delete;
+    // noexcept so vectors of riders and drivers move them when they grow.
+    RideHistory(RideHistory&&) noexcept = default;
+    RideHistory& operator=(RideHistory&&) noexcept = default;
+
+    void add(std::unique_ptr<Ride> ride) {
+        AllocScope scope(AllocTag::History);
+        byRequestTime.insert(*ride);
+        recent.push_back(std::move(ride));
+        ++live;
+        ++rescanCredit;
+        trim();
+    }
+
+    // Change the policy; the history is trimmed to the new limit right away.
+    void setPolicy(const RideHistoryPolicy& newPolicy) {
+        policy = newPolicy;
+        AllocScope scope(AllocTag::History);
+        trim();
+    }
+
+    const RideHistoryPolicy& getPolicy() const {
+        return policy;
+    }
+
+    // Visit the rides still held in full, oldest first.
+    template <typename Visitor>
+    void forEach(Visitor&& visit) const {
+        for (const auto& ride : recent) {
+            if (ride) {
+                visit(*ride);
+            }
+        }
+    }
+
+    // Visit the rides held in full that were first requested in [from, to),
+    // earliest first. Folded rides are not included; see summary().
+    template <typename Visitor>
+    void forEachBetween(TimestampMs from, TimestampMs to, Visitor&& visit) const {
+        byRequestTime.forEachBetween(from, to, visit);
+    }
+
+    // Rides held in full.
+    std::size_t recentCount() const {
+        return live;
+    }
+
+    // Every ride ever added, folded or not.
+    std::uint64_t totalCount() const {
+        return folded.rides + live;
+    }
+
+    bool empty() const {
+        return live == 0 && folded.rides == 0;
+    }
+
+    const RideHistorySummary& summary() const {
+        return folded;
+    }
+};
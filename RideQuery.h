@@ -0,0 +1,400 @@
+// RideQuery.h - Columnar ride store and a morsel-parallel filter/group/aggregate engine
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+
+#include "Ride.h"
+#include "AllocTracker.h"
+
+// What a query groups rides by.
+enum class RideGroupBy : std::uint8_t {
+    None,      // one row over every matching ride
+    Pickup,
+    Dropoff,
+    Type,
+    Status,
+    Day,       // UTC day the ride was requested
+    HourOfDay  // UTC hour the ride was requested, 0-23
+};
+
+// A filter/group-by/aggregate query. Every filter defaults to matching all
+// rides; they combine with AND.
+struct RideQuery {
+    bool filterType = false;
+    RideType type = RideType::Standard;
+    bool filterStatus = false;
+    RideStatus status = RideStatus::Completed;
+    TimestampMs requestedFrom = std::numeric_limits<TimestampMs>::min(); // requested in [from, to)
+    TimestampMs requestedTo = std::numeric_limits<TimestampMs>::max();
+    std::string pickup;  // empty = any
+    std::string dropoff; // empty = any
+    double minDistance = 0.0;
+    double maxDistance = std::numeric_limits<double>::infinity();
+    RideGroupBy groupBy = RideGroupBy::None;
+};
+
+// One output group.
+struct RideQueryRow {
+    std::string group; // location, tier, status, YYYY-MM-DD or HH:00; "all" without grouping
+    std::uint64_t rides = 0;
+    double fare = 0.0;     // summed
+    double distance = 0.0; // summed
+
+    double averageFare() const {
+        return rides == 0 ? 0.0 : fare / static_cast<double>(rides);
+    }
+
+    double averageDistance() const {
+        return rides == 0 ? 0.0 : distance / static_cast<double>(rides);
+    }
+};
+
+// Rides stored column by column for analytics: one array per field, with
+// tier and status packed into a byte and locations and request days
+// dictionary-encoded, so a scan touches only the columns a query uses (29
+// bytes per ride in all). Day groups are as many as the distinct days, so
+// one stray timestamp years away adds one group, not a group per day between.
+// Distances and fares are stored as float; sums accumulate in double.
+//
+// query() splits the table into morsels of MORSEL_ROWS rows that worker
+// threads claim from a shared counter, so fast threads take more of them.
+// Each morsel is filtered in one branch-free pass that writes the indices
+// of matching rows to a selection vector, then aggregated into the
+// thread's own dense per-group arrays; the threads' partial results are
+// merged at the end. Counts are exact; fare and distance sums are added
+// in the order morsels were claimed, so their last digits can vary
+// between runs.
+//
+// Appending is single-threaded and must not overlap a query.
+class RideColumns {
+public:
+    static constexpr std::size_t MORSEL_ROWS = 16384;
+
+private:
+    static constexpr std::uint8_t STATUS_MASK = 0x07;
+    static constexpr std::uint8_t TYPE_SHIFT = 3;
+
+    std::vector<std::uint8_t> flags;    // status in bits 0-2, tier in bit 3
+    std::vector<std::uint32_t> pickups; // location ids
+    std::vector<std::uint32_t> dropoffs;
+    std::vector<float> distances;
+    std::vector<float> fares;
+    std::vector<TimestampMs> requestedTimes;
+    std::vector<std::uint32_t> requestedDays; // day ids
+    std::vector<std::string> locationNames;
+    std::unordered_map<std::string, std::uint32_t> locationIds;
+    std::vector<std::int64_t> dayNumbers; // by day id: days since the epoch
+    std::unordered_map<std::int64_t, std::uint32_t> dayIds;
+
+    struct Partial {
+        std::vector<std::uint64_t> rides;
+        std::vector<double> fare;
+        std::vector<double> distance;
+
+        explicit Partial(std::size_t groups) : rides(groups, 0), fare(groups, 0.0), distance(groups, 0.0) {}
+    };
+
+    // The compiled form of a query's filters.
+    struct Predicate {
+        std::uint8_t flagMask = 0;
+        std::uint8_t flagValue = 0;
+        TimestampMs from = 0;
+        TimestampMs to = 0;
+        float minDistance = 0.0f;
+        float maxDistance = 0.0f;
+        std::uint32_t pickupMask = 0; // 0 = any pickup
+        std::uint32_t pickup = 0;
+        std::uint32_t dropoffMask = 0;
+        std::uint32_t dropoff = 0;
+    };
+
+    // YYYY-MM-DD for days since the epoch (proleptic Gregorian calendar).
+    static std::string dateOf(std::int64_t day) {
+        std::int64_t z = day + 719468;
+        std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+        std::int64_t dayOfEra = z - era * 146097;
+        std::int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        std::int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        std::int64_t mp = (5 * dayOfYear + 2) / 153;
+        std::int64_t d = dayOfYear - (153 * mp + 2) / 5 + 1;
+        std::int64_t m = mp < 10 ? mp + 3 : mp - 9;
+        std::int64_t y = yearOfEra + era * 400 + (m <= 2 ? 1 : 0);
+        char text[64]; // room for any three 64-bit fields
+        std::snprintf(text, sizeof(text), "%04lld-%02lld-%02lld", static_cast<long long>(y),
+                      static_cast<long long>(m), static_cast<long long>(d));
+        return text;
+    }
+
+    // Indices of the rows in [begin, end) that pass, written to `selection`.
+    std::size_t select(const Predicate& p, std::size_t begin, std::size_t end, std::uint32_t* selection) const {
+        std::size_t count = 0;
+        for (std::size_t i = begin; i < end; ++i) {
+            bool pass = (flags[i] & p.flagMask) == p.flagValue;
+            pass &= requestedTimes[i] >= p.from;
+            pass &= requestedTimes[i] < p.to;
+            pass &= distances[i] >= p.minDistance;
+            pass &= distances[i] <= p.maxDistance;
+            pass &= ((pickups[i] ^ p.pickup) & p.pickupMask) == 0;
+            pass &= ((dropoffs[i] ^ p.dropoff) & p.dropoffMask) == 0;
+            selection[count] = static_cast<std::uint32_t>(i);
+            count += pass;
+        }
+        return count;
+    }
+
+    template <typename GroupOf>
+    void accumulate(const std::uint32_t* selection, std::size_t count, GroupOf groupOf, Partial& out) const {
+        for (std::size_t s = 0; s < count; ++s) {
+            std::uint32_t i = selection[s];
+            std::size_t group = groupOf(i);
+            ++out.rides[group];
+            out.fare[group] += fares[i];
+            out.distance[group] += distances[i];
+        }
+    }
+
+    void aggregate(RideGroupBy groupBy, const std::uint32_t* selection, std::size_t count, Partial& out) const {
+        switch (groupBy) {
+            case RideGroupBy::None:
+                accumulate(selection, count, [](std::uint32_t) { return std::size_t(0); }, out);
+                break;
+            case RideGroupBy::Pickup:
+                accumulate(selection, count, [this](std::uint32_t i) { return std::size_t(pickups[i]); }, out);
+                break;
+            case RideGroupBy::Dropoff:
+                accumulate(selection, count, [this](std::uint32_t i) { return std::size_t(dropoffs[i]); }, out);
+                break;
+            case RideGroupBy::Type:
+                accumulate(selection, count, [this](std::uint32_t i) { return std::size_t(flags[i] >> TYPE_SHIFT); },
+                           out);
+                break;
+            case RideGroupBy::Status:
+                accumulate(selection, count, [this](std::uint32_t i) { return std::size_t(flags[i] & STATUS_MASK); },
+                           out);
+                break;
+            case RideGroupBy::Day:
+                accumulate(selection, count, [this](std::uint32_t i) { return std::size_t(requestedDays[i]); }, out);
+                break;
+            case RideGroupBy::HourOfDay:
+                accumulate(selection, count,
+                           [this](std::uint32_t i) {
+                               TimestampMs ms = requestedTimes[i] % MS_PER_DAY;
+                               return static_cast<std::size_t>((ms < 0 ? ms + MS_PER_DAY : ms) / (60 * 60 * 1000));
+                           },
+                           out);
+                break;
+        }
+    }
+
+    std::size_t groupCount(RideGroupBy groupBy) const {
+        switch (groupBy) {
+            case RideGroupBy::None: return 1;
+            case RideGroupBy::Pickup:
+            case RideGroupBy::Dropoff: return locationNames.size();
+            case RideGroupBy::Type: return RIDE_TYPE_COUNT;
+            case RideGroupBy::Status: return RIDE_STATUS_COUNT;
+            case RideGroupBy::Day: return dayNumbers.size();
+            case RideGroupBy::HourOfDay: return 24;
+        }
+        return 1;
+    }
+
+    std::string groupName(RideGroupBy groupBy, std::size_t group) const {
+        switch (groupBy) {
+            case RideGroupBy::None: return "all";
+            case RideGroupBy::Pickup:
+            case RideGroupBy::Dropoff: return locationNames[group];
+            case RideGroupBy::Type: return rideTypeName(static_cast<RideType>(group));
+            case RideGroupBy::Status: return rideStatusName(static_cast<RideStatus>(group));
+            case RideGroupBy::Day: return dateOf(dayNumbers[group]);
+            case RideGroupBy::HourOfDay: {
+                char text[8];
+                std::snprintf(text, sizeof(text), "%02zu:00", group);
+                return text;
+            }
+        }
+        return "";
+    }
+
+    // Dictionary id for a day, adding it on first use. Rides mostly arrive
+    // in time order, so the previous row's day is checked first.
+    std::uint32_t dayId(std::int64_t day) {
+        if (!requestedDays.empty() && dayNumbers[requestedDays.back()] == day) {
+            return requestedDays.back();
+        }
+        auto it = dayIds.find(day);
+        if (it != dayIds.end()) {
+            return it->second;
+        }
+        std::uint32_t id = static_cast<std::uint32_t>(dayNumbers.size());
+        dayNumbers.push_back(day);
+        dayIds.emplace(day, id);
+        return id;
+    }
+
+    // Compile the filters. Returns false if no ride can match (an unknown location).
+    bool compile(const RideQuery& query, Predicate& p) const {
+        if (query.filterStatus) {
+            p.flagMask |= STATUS_MASK;
+            p.flagValue |= static_cast<std::uint8_t>(query.status);
+        }
+        if (query.filterType) {
+            p.flagMask |= std::uint8_t(1) << TYPE_SHIFT;
+            p.flagValue |= static_cast<std::uint8_t>(static_cast<std::uint8_t>(query.type) << TYPE_SHIFT);
+        }
+        p.from = query.requestedFrom;
+        p.to = query.requestedTo;
+        p.minDistance = static_cast<float>(query.minDistance);
+        p.maxDistance = static_cast<float>(query.maxDistance);
+        if (!query.pickup.empty()) {
+            auto it = locationIds.find(query.pickup);
+            if (it == locationIds.end()) {
+                return false;
+            }
+            p.pickup = it->second;
+            p.pickupMask = 0xFFFFFFFFu;
+        }
+        if (!query.dropoff.empty()) {
+            auto it = locationIds.find(query.dropoff);
+            if (it == locationIds.end()) {
+                return false;
+            }
+            p.dropoff = it->second;
+            p.dropoffMask = 0xFFFFFFFFu;
+        }
+        return true;
+    }
+
+public:
+    // Dictionary id for a location name, adding it on first use.
+    std::uint32_t locationId(const std::string& name) {
+        auto it = locationIds.find(name);
+        if (it != locationIds.end()) {
+            return it->second;
+        }
+        AllocScope scope(AllocTag::History);
+        std::uint32_t id = static_cast<std::uint32_t>(locationNames.size());
+        locationNames.push_back(name);
+        locationIds.emplace(name, id);
+        return id;
+    }
+
+    const std::string& locationName(std::uint32_t id) const {
+        return locationNames[id];
+    }
+
+    void reserve(std::size_t rides) {
+        AllocScope scope(AllocTag::History);
+        flags.reserve(rides);
+        pickups.reserve(rides);
+        dropoffs.reserve(rides);
+        distances.reserve(rides);
+        fares.reserve(rides);
+        requestedTimes.reserve(rides);
+        requestedDays.reserve(rides);
+    }
+
+    void appendRow(RideType type, RideStatus status, std::uint32_t pickupId, std::uint32_t dropoffId, double distance,
+                   double fare, TimestampMs requestedAt) {
+        AllocScope scope(AllocTag::History);
+        flags.push_back(static_cast<std::uint8_t>(static_cast<std::uint8_t>(status) |
+                                                  (static_cast<std::uint8_t>(type) << TYPE_SHIFT)));
+        pickups.push_back(pickupId);
+        dropoffs.push_back(dropoffId);
+        distances.push_back(static_cast<float>(distance));
+        fares.push_back(static_cast<float>(fare));
+        requestedTimes.push_back(requestedAt);
+        requestedDays.push_back(dayId(dayOf(requestedAt)));
+    }
+
+    void append(const Ride& ride) {
+        appendRow(ride.getType(), ride.getStatus(), locationId(ride.getPickupLocation()),
+                  locationId(ride.getDropoffLocation()), ride.getDistance(), ride.getFare(),
+                  ride.getRequestedAt());
+    }
+
+    // Append every ride a Rider or Driver still holds in full.
+    template <typename Entity>
+    void appendHistory(const Entity& entity) {
+        entity.forEachRide([this](const Ride& ride) { append(ride); });
+    }
+
+    std::size_t size() const {
+        return flags.size();
+    }
+
+    // Run a query on up to `threads` threads (0 = one per hardware thread).
+    // Rows come out in group order (location id, tier, status, day or
+    // hour); groups with no matching rides are left out.
+    void query(const RideQuery& q, std::vector<RideQueryRow>& out, unsigned threads = 0) const {
+        AllocScope scope(AllocTag::Reporting);
+        out.clear();
+        Predicate predicate;
+        std::size_t groups = groupCount(q.groupBy);
+        if (!compile(q, predicate) || groups == 0) {
+            return;
+        }
+
+        std::size_t rows = size();
+        std::size_t morsels = (rows + MORSEL_ROWS - 1) / MORSEL_ROWS;
+        if (threads == 0) {
+            threads = std::thread::hardware_concurrency();
+        }
+        std::size_t workers = threads == 0 ? 1 : threads;
+        workers = morsels < workers ? (morsels == 0 ? 1 : morsels) : workers;
+
+        std::vector<Partial> partials(workers, Partial(groups));
+        std::atomic<std::size_t> nextMorsel{0};
+        auto work = [&](std::size_t w) {
+            std::vector<std::uint32_t> selection(MORSEL_ROWS);
+            for (std::size_t m = nextMorsel.fetch_add(1, std::memory_order_relaxed); m < morsels;
+                 m = nextMorsel.fetch_add(1, std::memory_order_relaxed)) {
+                std::size_t begin = m * MORSEL_ROWS;
+                std::size_t end = begin + MORSEL_ROWS < rows ? begin + MORSEL_ROWS : rows;
+                std::size_t count = select(predicate, begin, end, selection.data());
+                aggregate(q.groupBy, selection.data(), count, partials[w]);
+            }
+        };
+        std::vector<std::thread> pool;
+        pool.reserve(workers - 1);
+        for (std::size_t w = 1; w < workers; ++w) {
+            pool.emplace_back(work, w);
+        }
+        work(0);
+        for (std::thread& t : pool) {
+            t.join();
+        }
+
+        Partial& total = partials[0];
+        for (std::size_t w = 1; w < workers; ++w) {
+            for (std::size_t g = 0; g < groups; ++g) {
+                total.rides[g] += partials[w].rides[g];
+                total.fare[g] += partials[w].fare[g];
+                total.distance[g] += partials[w].distance[g];
+            }
+        }
+        std::vector<std::size_t> order(groups);
+        for (std::size_t g = 0; g < groups; ++g) {
+            order[g] = g;
+        }
+        if (q.groupBy == RideGroupBy::Day) { // day ids are in first-seen order
+            std::sort(order.begin(), order.end(),
+                      [this](std::size_t a, std::size_t b) { return dayNumbers[a] < dayNumbers[b]; });
+        }
+        for (std::size_t g : order) {
+            if (total.rides[g] != 0) {
+                out.push_back(RideQueryRow{groupName(q.groupBy, g), total.rides[g], total.fare[g], total.distance[g]});
+            }
+        }
+    }
+};
@@ -0,0 +1,153 @@
+// RideTimeouts.h - Per-ride timeouts driven by the ride lifecycle
+
+#pragma once
+
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+
+#include "Ride.h"
+#include "TimerWheel.h"
+#include "AllocTracker.h"
+
+// How long a ride may sit in each waiting state before it is cancelled.
+struct TimeoutPolicy {
+    TimestampMs matchTimeoutMs = 2 * 60 * 1000;    // Requested: no driver found
+    TimestampMs acceptTimeoutMs = 15 * 1000;       // Matched: driver did not accept
+    TimestampMs noShowTimeoutMs = 5 * 60 * 1000;   // En Route: rider did not show up
+};
+
+enum class TimeoutKind : std::uint8_t {
+    Match,
+    DriverAcceptance,
+    NoShow
+};
+
+inline const char* timeoutKindName(TimeoutKind kind) {
+    switch (kind) {
+        case TimeoutKind::Match: return "match";
+        case TimeoutKind::DriverAcceptance: return "driver acceptance";
+        case TimeoutKind::NoShow: return "no-show";
+    }
+    return "unknown";
+}
+
+// The state a ride waits in while a timeout of this kind is armed.
+inline RideStatus timeoutWaitingState(TimeoutKind kind) {
+    switch (kind) {
+        case TimeoutKind::Match: return RideStatus::Requested;
+        case TimeoutKind::DriverAcceptance: return RideStatus::Matched;
+        case TimeoutKind::NoShow: return RideStatus::EnRoute;
+    }
+    return RideStatus::Requested;
+}
+
+// Tracks the set of pending rides (requested but not yet picked up) and keeps
+// exactly one armed timer per ride for the state it is waiting in. Transitions
+// made through advanceRide() re-arm or disarm the timer in O(1); when a timer
+// fires, the ride is cancelled and dropped from the pending set.
+//
+// The tracker does not own rides. A tracked ride must outlive its tracking
+// (call forget() before destroying a ride that is still pending).
+class RideTimeouts {
+private:
+    struct Entry {
+        TimerWheel::TimerId timer;
+        TimeoutKind kind;
+    };
+
+    TimeoutPolicy policy;
+    TimerWheel wheel; // one tick per millisecond
+    std::unordered_map<Ride*, Entry> pendingRides;
+    std::function<void(Ride&, TimeoutKind)> onExpired;
+
+    void arm(Ride& ride, TimeoutKind kind, TimestampMs now) {
+        AllocScope scope(AllocTag::Dispatch);
+        TimestampMs delay = policy.matchTimeoutMs;
+        if (kind == TimeoutKind::DriverAcceptance) {
+            delay = policy.acceptTimeoutMs;
+        } else if (kind == TimeoutKind::NoShow) {
+            delay = policy.noShowTimeoutMs;
+        }
+        // Timers are relative to the wheel's clock; account for a caller whose
+        // timestamp is ahead of the last tick() so deadlines stay absolute.
+        TimestampMs lag = now - static_cast<TimestampMs>(wheel.now());
+        TimestampMs ticks = delay + (lag > 0 ? lag : 0);
+        Entry& entry = pendingRides[&ride];
+        if (entry.timer != TimerWheel::INVALID_TIMER) {
+            wheel.cancel(entry.timer);
+        }
+        entry.timer = wheel.schedule(static_cast<std::uint64_t>(ticks), reinterpret_cast<std::uintptr_t>(&ride));
+        entry.kind = kind;
+    }
+
+public:
+    explicit RideTimeouts(TimestampMs now, TimeoutPolicy p = TimeoutPolicy())
+        : policy(p), wheel(static_cast<std::uint64_t>(now)) {}
+
+    // Called for each ride that times out, after it has been cancelled.
+    void setExpiryHandler(std::function<void(Ride&, TimeoutKind)> handler) {
+        onExpired = std::move(handler);
+    }
+
+    // Start tracking a freshly requested ride with a match timeout.
+    void track(Ride& ride, TimestampMs now) {
+        if (ride.getStatus() == RideStatus::Requested) {
+            arm(ride, TimeoutKind::Match, now);
+        }
+    }
+
+    // Transition a tracked ride and re-arm its timer for the new state.
+    // Returns false if the lifecycle rejects the transition.
+    bool advanceRide(Ride& ride, RideStatus next, TimestampMs now) {
+        if (!ride.transitionTo(next, now)) {
+            return false;
+        }
+        switch (next) {
+            case RideStatus::Requested: arm(ride, TimeoutKind::Match, now); break;
+            case RideStatus::Matched: arm(ride, TimeoutKind::DriverAcceptance, now); break;
+            case RideStatus::EnRoute: arm(ride, TimeoutKind::NoShow, now); break;
+            default: forget(ride); break; // In Progress / Completed / Cancelled: no longer pending
+        }
+        return true;
+    }
+
+    // Stop tracking a ride without changing its status.
+    void forget(Ride& ride) {
+        auto it = pendingRides.find(&ride);
+        if (it != pendingRides.end()) {
+            wheel.cancel(it->second.timer);
+            pendingRides.erase(it);
+        }
+    }
+
+    // Advance the clock, cancelling every ride whose deadline has passed.
+    // A timer whose ride is no longer tracked is dropped without touching the
+    // ride, and a ride that has left the state its timer was armed for (moved
+    // on without advanceRide()) is dropped from the pending set, not cancelled.
+    void tick(TimestampMs now) {
+        wheel.advance(static_cast<std::uint64_t>(now), [this, now](std::uint64_t payload) {
+            Ride* ride = reinterpret_cast<Ride*>(static_cast<std::uintptr_t>(payload));
+            auto it = pendingRides.find(ride);
+            if (it == pendingRides.end()) {
+                return;
+            }
+            TimeoutKind kind = it->second.kind;
+            pendingRides.erase(it);
+            if (ride->getStatus() != timeoutWaitingState(kind) || !ride->transitionTo(RideStatus::Cancelled, now)) {
+                return;
+            }
+            if (onExpired) {
+                onExpired(*ride, kind);
+            }
+        });
+    }
+
+    bool isPending(const Ride& ride) const {
+        return pendingRides.count(const_cast<Ride*>(&ride)) != 0;
+    }
+
+    std::size_t pendingCount() const {
+        return pendingRides.size();
+    }
+};
@@ -0,0 +1,112 @@
+// Rider.h - Rider class
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory> // For std::unique_ptr
+#include <iomanip> // For std::fixed and std::setprecision
+
+#include "Ride.h"
+#include "LatencyHistogram.h"
+#include "AllocTracker.h"
+#include "Metrics.h"
+#include "RideTimeouts.h"
+#include "ScheduledRideQueue.h"
+#include "RideHistory.h"
+
+// 5. Rider Class
+class Rider {
+private:
+    std::string riderID;
+    std::string name;
+    RideHistory requestedRides; // owns the rides; see RideHistoryPolicy for the memory cap
+
+public:
+    Rider(const std::string& id, const std::string& n)
+        : riderID(id), name(n) {}
+
+    const std::string& getRiderID() const {
+        return riderID;
+    }
+
+    // Method to request a ride
+    // Takes ownership of the unique_ptr
+    void requestRide(std::unique_ptr<Ride> ride) {
+        TRACE_SPAN("Rider::requestRide");
+        RideMetrics::requested(ride->getType()).increment();
+        std::cout << "\n" << name << " requested a ride." << std::endl;
+        ride->rideDetails(); // Show requested ride details
+        // Timed after the printout so the histogram measures the request
+        // path itself, not stream formatting.
+        ScopedLatency timer(HotPathLatency::requestRide);
+        TRACE_SPAN("Rider history insert");
+        requestedRides.add(std::move(ride)); // Ownership transferred
+    }
+
+    // Request a ride and arm its match timeout. If no driver is found in time
+    // the ride is cancelled and leaves the tracker's pending set.
+    void requestRide(std::unique_ptr<Ride> ride, RideTimeouts& timeouts, TimestampMs now) {
+        timeouts.track(*ride, now);
+        requestRide(std::move(ride));
+    }
+
+    // Book a ride for a future pickup. The rider keeps ownership; the queue
+    // releases the ride into the dispatch pipeline when its pickup approaches.
+    void scheduleRide(std::unique_ptr<Ride> ride, TimestampMs pickupAt, ScheduledRideQueue& queue, TimestampMs now) {
+        std::cout << "\n" << name << " booked a ride " << (pickupAt - now) / (60 * 1000)
+                  << " minutes ahead." << std::endl;
+        queue.schedule(*ride, pickupAt, now);
+        ride->rideDetails();
+        requestedRides.add(std::move(ride));
+    }
+
+    // Cap how many rides are kept in full; older ones are summarised.
+    void setHistoryPolicy(const RideHistoryPolicy& policy) {
+        requestedRides.setPolicy(policy);
+    }
+
+    // Visit every ride still held in full without printing (for reports and analytics)
+    template <typename Visitor>
+    void forEachRide(Visitor&& visit) const {
+        requestedRides.forEach(visit);
+    }
+
+    // Visit the rides still held in full that were first requested in
+    // [from, to) (Ride::getRequestedAt()), earliest first: O(log n + k)
+    // through the history's time index.
+    template <typename Visitor>
+    void forEachRideBetween(TimestampMs from, TimestampMs to, Visitor&& visit) const {
+        requestedRides.forEachBetween(from, to, visit);
+    }
+
+    // Every ride requested, including those folded out of the history.
+    std::size_t getRideCount() const {
+        return static_cast<std::size_t>(requestedRides.totalCount());
+    }
+
+    const RideHistorySummary& getOlderRides() const {
+        return requestedRides.summary();
+    }
+
+    // Method to display ride history
+    void viewRides() const {
+        AllocScope scope(AllocTag::Reporting);
+        std::cout << "\n--- " << name << "'s Ride History ---" << std::endl;
+        if (requestedRides.empty()) {
+            std::cout << "  No rides requested yet." << std::endl;
+        } else {
+            const RideHistorySummary& older = requestedRides.summary();
+            if (older.rides != 0) {
+                std::cout << "  (" << older.rides << " older rides, $" << std::fixed << std::setprecision(2)
+                          << older.fare << " in fares)" << std::endl;
+            }
+            requestedRides.forEach([](const Ride& ride) {
+                // Polymorphic call: correct rideDetails is invoked
+                ride.rideDetails();
+                std::cout << "--------------------" << std::endl;
+            });
+        }
+    }
+};
@@ -0,0 +1,121 @@
+// ScheduledRideQueue.h - Calendar queue for rides booked ahead of time
+
+#pragma once
+
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+#include "Ride.h"
+#include "AllocTracker.h"
+
+// A calendar queue: time is cut into fixed-width buckets and a ring of
+// `bucketCount` buckets covers the near future (the "horizon"). Bookings
+// further out than the horizon wait in an overflow map keyed by ring
+// revolution and are moved into the ring once, when their revolution starts.
+//
+// Each booking is therefore touched a constant number of times: once on
+// schedule(), at most once when migrating from overflow, and once on release.
+// Releasing is bucket-granular: a ride enters the dispatch pipeline as soon
+// as its bucket starts, i.e. up to one bucket width before pickup, which
+// doubles as the dispatch lead time.
+//
+// Cancellation is lazy: cancel the ride through its lifecycle and the queue
+// skips it on release. The queue does not own rides.
+class ScheduledRideQueue {
+public:
+    struct Booking {
+        Ride* ride;
+        TimestampMs pickupAt;
+    };
+
+private:
+    TimestampMs origin;
+    TimestampMs bucketWidthMs;
+    std::uint64_t cursor = 0; // bucket number being filled/released next
+    std::vector<std::vector<Booking>> ring;
+    std::map<std::uint64_t, std::vector<Booking>> overflow; // revolution -> bookings
+    std::size_t bookingCount = 0;
+    std::vector<Booking> releasing; // reused buffer so release never allocates in steady state
+
+    std::uint64_t bucketOf(TimestampMs t) const {
+        return t <= origin ? 0 : static_cast<std::uint64_t>((t - origin) / bucketWidthMs);
+    }
+
+    std::uint64_t targetBucket(const Booking& booking) const {
+        std::uint64_t bucket = bucketOf(booking.pickupAt);
+        return bucket < cursor ? cursor : bucket; // already due: release with the next bucket
+    }
+
+    void place(const Booking& booking) {
+        AllocScope scope(AllocTag::Dispatch);
+        std::uint64_t bucket = targetBucket(booking);
+        if (bucket - cursor < ring.size()) {
+            ring[bucket % ring.size()].push_back(booking);
+        } else {
+            overflow[bucket / ring.size()].push_back(booking);
+        }
+    }
+
+public:
+    explicit ScheduledRideQueue(TimestampMs now, TimestampMs bucketWidth = 60 * 1000, std::size_t bucketCount = 4096)
+        : origin(now), bucketWidthMs(bucketWidth), ring(bucketCount) {}
+
+    // Book a requested ride for a future pickup. The ride moves to Scheduled;
+    // returns false if its lifecycle does not allow that.
+    bool schedule(Ride& ride, TimestampMs pickupAt, TimestampMs now) {
+        if (!ride.transitionTo(RideStatus::Scheduled, now)) {
+            return false;
+        }
+        place(Booking{&ride, pickupAt});
+        ++bookingCount;
+        return true;
+    }
+
+    // Release every booking whose bucket has started by `now`. Each released
+    // ride goes back to Requested and is handed to onRelease(ride, pickupAt).
+    // Returns the number of rides released.
+    template <typename OnRelease>
+    std::size_t releaseDue(TimestampMs now, OnRelease&& onRelease) {
+        std::size_t released = 0;
+        std::uint64_t last = bucketOf(now);
+        while (cursor <= last) {
+            if (bookingCount == 0) {
+                cursor = last + 1; // nothing outstanding: skip the empty buckets
+                break;
+            }
+            if (cursor % ring.size() == 0) {
+                auto it = overflow.find(cursor / ring.size());
+                if (it != overflow.end()) {
+                    for (const Booking& booking : it->second) {
+                        ring[targetBucket(booking) % ring.size()].push_back(booking);
+                    }
+                    overflow.erase(it);
+                }
+            }
+            std::vector<Booking>& bucket = ring[cursor % ring.size()];
+            ++cursor; // advance first so bookings made from the callback land in later buckets
+            releasing.clear();
+            releasing.swap(bucket);
+            for (const Booking& booking : releasing) {
+                --bookingCount;
+                if (booking.ride->transitionTo(RideStatus::Requested, now)) {
+                    onRelease(*booking.ride, booking.pickupAt);
+                    ++released;
+                }
+                // Rides cancelled while scheduled are dropped here.
+            }
+        }
+        return released;
+    }
+
+    // Number of outstanding bookings (including lazily cancelled ones).
+    std::size_t size() const {
+        return bookingCount;
+    }
+
+    TimestampMs bucketWidth() const {
+        return bucketWidthMs;
+    }
+};
@@ -0,0 +1,168 @@
+// SimEventQueue.h - Calendar event queue for discrete-event simulation
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#include "Ride.h"
+
+// One simulation event. `kind`, `subject` and `data` are opaque to the
+// queue; the simulator uses them for the event type, an object slot and a
+// generation tag.
+struct SimEvent {
+    TimestampMs time;
+    std::uint64_t sequence; // assigned by the queue: FIFO among equal times
+    std::uint32_t kind;
+    std::uint32_t subject;
+    std::uint64_t data;
+};
+
+// A calendar queue tuned for the hold pattern of a simulation (pop the
+// earliest event, push a few slightly later ones):
+// - a ring of `bucketCount` fixed-width buckets covers the near future; an
+//   event is appended to its bucket in O(1)
+// - only the bucket being drained is kept as a binary heap, built once when
+//   the cursor reaches it, so pops cost O(log k) for a bucket of k events
+// - an occupancy bitmap (one bit per bucket) lets the cursor skip runs of
+//   empty buckets a 64-bit word at a time
+// - events beyond the ring's horizon wait in an overflow heap and migrate
+//   into the ring as the cursor advances; when the ring is empty the cursor
+//   jumps straight to the earliest overflow event
+//
+// Size the ring so its horizon (width x count) covers the common scheduling
+// delays while the ring itself stays cache-resident; a ring much larger than
+// the live event set is swept cold and gets slower, not faster.
+//
+// Events pop in (time, push order) order, so a simulation driven by this
+// queue is deterministic. Events pushed with a time before the current
+// bucket are delivered next, in time order.
+class SimEventQueue {
+private:
+    struct Later {
+        bool operator()(const SimEvent& a, const SimEvent& b) const {
+            return a.time != b.time ? a.time > b.time : a.sequence > b.sequence;
+        }
+    };
+
+    TimestampMs origin;
+    TimestampMs bucketWidthMs;
+    std::vector<std::vector<SimEvent>> ring;
+    std::vector<std::uint64_t> occupied; // one bit per ring slot
+    std::uint64_t ringMask;
+    std::uint64_t cursor = 0; // bucket being drained (kept in heap order)
+    std::size_t ringCount = 0;
+    std::vector<SimEvent> overflow; // heap of events beyond the horizon
+    std::uint64_t nextSequence = 0;
+
+    std::uint64_t bucketOf(TimestampMs t) const {
+        return t <= origin ? 0 : static_cast<std::uint64_t>((t - origin) / bucketWidthMs);
+    }
+
+    void append(std::uint64_t bucket, const SimEvent& event) {
+        std::uint64_t slot = bucket & ringMask;
+        ring[slot].push_back(event);
+        occupied[slot / 64] |= std::uint64_t(1) << (slot % 64);
+        ++ringCount;
+    }
+
+    // Number of buckets from the cursor to the next non-empty one. The
+    // cursor's own slot must be empty and the ring must hold an event.
+    std::uint64_t distanceToNextOccupied() const {
+        std::uint64_t start = (cursor + 1) & ringMask;
+        std::size_t w = start / 64;
+        std::uint64_t word = occupied[w] & (~std::uint64_t(0) << (start % 64));
+        while (word == 0) {
+            w = (w + 1) & (occupied.size() - 1);
+            word = occupied[w];
+        }
+        std::uint64_t slot = w * 64 + static_cast<std::uint64_t>(__builtin_ctzll(word));
+        return (slot - cursor) & ringMask;
+    }
+
+    // Move overflow events that now fall inside the ring's horizon.
+    void migrateOverflow() {
+        while (!overflow.empty()) {
+            std::uint64_t bucket = bucketOf(overflow.front().time);
+            if (bucket - cursor >= ring.size()) {
+                break;
+            }
+            std::pop_heap(overflow.begin(), overflow.end(), Later());
+            append(bucket, overflow.back());
+            overflow.pop_back();
+        }
+    }
+
+public:
+    // bucketCount is rounded up to a power of two, and to at least 64.
+    explicit SimEventQueue(TimestampMs now, TimestampMs bucketWidth = 50, std::size_t bucketCount = 4096)
+        : origin(now), bucketWidthMs(bucketWidth < 1 ? 1 : bucketWidth) {
+        std::size_t size = 64;
+        while (size < bucketCount) {
+            size <<= 1;
+        }
+        ring.resize(size);
+        occupied.assign(size / 64, 0);
+        ringMask = size - 1;
+    }
+
+    void push(TimestampMs time, std::uint32_t kind, std::uint32_t subject, std::uint64_t data = 0) {
+        SimEvent event{time, nextSequence++, kind, subject, data};
+        std::uint64_t bucket = bucketOf(time);
+        if (bucket < cursor) {
+            bucket = cursor; // already due
+        }
+        if (bucket - cursor >= ring.size()) {
+            overflow.push_back(event);
+            std::push_heap(overflow.begin(), overflow.end(), Later());
+            return;
+        }
+        append(bucket, event);
+        if (bucket == cursor) {
+            std::vector<SimEvent>& slot = ring[cursor & ringMask];
+            std::push_heap(slot.begin(), slot.end(), Later());
+        }
+    }
+
+    // Remove the earliest event into `out`. Returns false when empty.
+    bool pop(SimEvent& out) {
+        while (true) {
+            std::uint64_t slotIndex = cursor & ringMask;
+            std::vector<SimEvent>& slot = ring[slotIndex];
+            if (!slot.empty()) {
+                std::pop_heap(slot.begin(), slot.end(), Later());
+                out = slot.back();
+                slot.pop_back();
+                --ringCount;
+                if (slot.empty()) {
+                    occupied[slotIndex / 64] &= ~(std::uint64_t(1) << (slotIndex % 64));
+                }
+                return true;
+            }
+            if (ringCount != 0) {
+                cursor += distanceToNextOccupied();
+            } else if (!overflow.empty()) {
+                cursor = bucketOf(overflow.front().time); // skip the empty stretch
+            } else {
+                return false;
+            }
+            migrateOverflow();
+            std::vector<SimEvent>& next = ring[cursor & ringMask];
+            std::make_heap(next.begin(), next.end(), Later());
+        }
+    }
+
+    std::size_t size() const {
+        return ringCount + overflow.size();
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    TimestampMs bucketWidth() const {
+        return bucketWidthMs;
+    }
+};
@@ -0,0 +1,411 @@
+// Sketches.h - Fixed-memory, mergeable sketches for ride dashboards
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+#include "Ride.h"
+
+// 64-bit finaliser (splitmix64), so sequential ids and std::hash of
+// integers (the identity on common platforms) spread over every bit.
+inline std::uint64_t sketchHash(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+inline std::uint64_t sketchHash(const std::string& s) {
+    return sketchHash(std::hash<std::string>()(s));
+}
+
+// Distinct-count estimate (HyperLogLog) in 2^PRECISION one-byte registers
+// (16 KiB): a standard error of about 1.04 / sqrt(2^PRECISION), 0.8%, at
+// any cardinality. Merging takes the register-wise maximum, so a merged
+// sketch equals one fed every item.
+class HyperLogLog {
+public:
+    static constexpr unsigned PRECISION = 14;
+    static constexpr std::size_t REGISTERS = std::size_t(1) << PRECISION;
+
+private:
+    std::vector<std::uint8_t> registers = std::vector<std::uint8_t>(REGISTERS, 0);
+
+public:
+    // Add an item by its 64-bit hash (see sketchHash).
+    void add(std::uint64_t hash) {
+        std::size_t index = static_cast<std::size_t>(hash >> (64 - PRECISION));
+        std::uint64_t rest = (hash << PRECISION) | (std::uint64_t(1) << (PRECISION - 1)); // guard bit: rank <= 51
+        std::uint8_t rank = static_cast<std::uint8_t>(__builtin_clzll(rest) + 1);
+        if (rank > registers[index]) {
+            registers[index] = rank;
+        }
+    }
+
+    void merge(const HyperLogLog& other) {
+        for (std::size_t i = 0; i < REGISTERS; ++i) {
+            registers[i] = other.registers[i] > registers[i] ? other.registers[i] : registers[i];
+        }
+    }
+
+    double estimate() const {
+        const double m = static_cast<double>(REGISTERS);
+        double sum = 0.0;
+        std::size_t zeros = 0;
+        for (std::uint8_t r : registers) {
+            sum += std::ldexp(1.0, -static_cast<int>(r));
+            zeros += r == 0 ? 1 : 0;
+        }
+        double estimate = 0.7213 / (1.0 + 1.079 / m) * m * m / sum;
+        if (estimate <= 2.5 * m && zeros != 0) {
+            estimate = m * std::log(m / static_cast<double>(zeros)); // linear counting for small sets
+        }
+        return estimate;
+    }
+};
+
+// One candidate in a HeavyHitters summary.
+struct HeavyHitter {
+    std::uint64_t key = 0;
+    std::string label;
+    std::uint64_t count = 0; // Count-Min estimate: never below the true count
+};
+
+// The most frequent keys of a stream: a Count-Min sketch (DEPTH rows of
+// WIDTH 64-bit counters, 128 KiB; 64 bits so a hot key cannot wrap)
+// estimates every key's count, and the `capacity` keys with the highest
+// estimates are kept as candidates in a min-heap.
+// Estimates overshoot by at most about e / WIDTH (0.07%) of the stream,
+// with high probability. An offer is DEPTH counter increments and a scan
+// of the candidate keys; the heap changes only when a key's estimate
+// beats the smallest candidate, so tail keys never touch it. Labels (for
+// display) are written only when a key becomes a candidate, into the
+// evicted candidate's string so its buffer is reused. Summaries with the
+// same dimensions merge by adding their sketches.
+class HeavyHitters {
+public:
+    static constexpr std::size_t DEPTH = 4;
+    static constexpr std::size_t WIDTH = 4096;
+
+private:
+    std::size_t capacity;
+    std::vector<std::uint64_t> counters = std::vector<std::uint64_t>(DEPTH * WIDTH, 0);
+    std::vector<HeavyHitter> heap; // min-heap on count
+    std::vector<std::uint64_t> keys; // heap[i].key, scanned on every offer
+    std::uint64_t total = 0;
+
+    // Row r's counter for a key: h1 + r * h2 over the two halves of the
+    // 64-bit hash (Kirsch-Mitzenmacher double hashing).
+    static std::size_t cell(std::uint64_t key, std::size_t row) {
+        std::uint32_t h1 = static_cast<std::uint32_t>(key);
+        std::uint32_t h2 = static_cast<std::uint32_t>(key >> 32) | 1u;
+        return row * WIDTH + ((h1 + static_cast<std::uint32_t>(row) * h2) & (WIDTH - 1));
+    }
+
+    std::uint64_t estimate(std::uint64_t key) const {
+        std::uint64_t smallest = counters[cell(key, 0)];
+        for (std::size_t row = 1; row < DEPTH; ++row) {
+            std::uint64_t c = counters[cell(key, row)];
+            smallest = c < smallest ? c : smallest;
+        }
+        return smallest;
+    }
+
+    void swapEntries(std::size_t a, std::size_t b) {
+        std::swap(heap[a], heap[b]);
+        std::swap(keys[a], keys[b]);
+    }
+
+    void siftDown(std::size_t i) {
+        while (true) {
+            std::size_t smallest = i;
+            std::size_t left = 2 * i + 1;
+            std::size_t right = left + 1;
+            if (left < heap.size() && heap[left].count < heap[smallest].count) {
+                smallest = left;
+            }
+            if (right < heap.size() && heap[right].count < heap[smallest].count) {
+                smallest = right;
+            }
+            if (smallest == i) {
+                return;
+            }
+            swapEntries(i, smallest);
+            i = smallest;
+        }
+    }
+
+    void siftUp(std::size_t i) {
+        while (i > 0 && heap[i].count < heap[(i - 1) / 2].count) {
+            swapEntries(i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+    }
+
+    void insertCandidate(HeavyHitter entry) {
+        keys.push_back(entry.key);
+        heap.push_back(std::move(entry));
+        siftUp(heap.size() - 1);
+    }
+
+    static bool moreFrequent(const HeavyHitter& a, const HeavyHitter& b) {
+        return a.count != b.count ? a.count > b.count : a.key < b.key;
+    }
+
+public:
+    explicit HeavyHitters(std::size_t candidates = 32) : capacity(candidates) {
+        heap.reserve(capacity);
+        keys.reserve(capacity);
+    }
+
+    // Count one occurrence of `key` (a 64-bit hash; see sketchHash).
+    // `writeLabel(std::string&)` fills in its display label and is called
+    // only when the key becomes a candidate.
+    template <typename WriteLabel>
+    void offer(std::uint64_t key, WriteLabel&& writeLabel) {
+        ++total;
+        std::uint64_t smallest = ~std::uint64_t(0);
+        for (std::size_t row = 0; row < DEPTH; ++row) {
+            std::uint64_t c = ++counters[cell(key, row)];
+            smallest = c < smallest ? c : smallest;
+        }
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            if (keys[i] == key) {
+                heap[i].count = smallest;
+                siftDown(i);
+                return;
+            }
+        }
+        if (heap.size() < capacity) {
+            HeavyHitter entry{key, std::string(), smallest};
+            writeLabel(entry.label);
+            insertCandidate(std::move(entry));
+        } else if (!heap.empty() && smallest > heap[0].count) {
+            heap[0].key = key;
+            keys[0] = key;
+            heap[0].count = smallest;
+            writeLabel(heap[0].label);
+            siftDown(0);
+        }
+    }
+
+    // Combine with a summary of another stream: the sketches add up, and
+    // the candidates of both are re-estimated against the sum.
+    void merge(const HeavyHitters& other) {
+        for (std::size_t i = 0; i < counters.size(); ++i) {
+            counters[i] += other.counters[i];
+        }
+        total += other.total;
+        std::vector<HeavyHitter> combined = heap;
+        for (const HeavyHitter& entry : other.heap) {
+            if (std::find(keys.begin(), keys.end(), entry.key) == keys.end()) {
+                combined.push_back(entry);
+            }
+        }
+        for (HeavyHitter& entry : combined) {
+            entry.count = estimate(entry.key);
+        }
+        std::sort(combined.begin(), combined.end(), moreFrequent);
+        if (combined.size() > capacity) {
+            combined.resize(capacity);
+        }
+        heap.clear();
+        keys.clear();
+        for (HeavyHitter& entry : combined) {
+            insertCandidate(std::move(entry));
+        }
+    }
+
+    // The k most frequent candidates, most frequent first.
+    std::vector<HeavyHitter> top(std::size_t k) const {
+        std::vector<HeavyHitter> sorted = heap;
+        std::sort(sorted.begin(), sorted.end(), moreFrequent);
+        if (sorted.size() > k) {
+            sorted.resize(k);
+        }
+        return sorted;
+    }
+
+    std::uint64_t totalCount() const {
+        return total;
+    }
+};
+
+// Quantiles of a stream of doubles (KLL) in O(K) memory: items go into a
+// stack of compactors, level h holding items of weight 2^h. A full level
+// is sorted and every other item (from a random offset) moves up a level,
+// halving its size. Upper levels get the most space, so rank error is
+// about 1.7 / K of the stream (1% at K = 200) however long it runs.
+// Merging concatenates levels and compacts. The offset coin comes from an
+// internal generator with a fixed seed, so equal inputs give equal sketches.
+class KllSketch {
+private:
+    static constexpr std::size_t MIN_LEVEL_WIDTH = 8; // keeps the low levels from compacting on every add
+
+    std::size_t k;
+    std::vector<std::vector<double>> levels;
+    std::size_t itemCount = 0;   // items held across all levels
+    std::uint64_t streamCount = 0;
+    std::size_t capacityTotal = 0; // sum of levelCapacity over the levels
+    std::uint64_t coinState = 0x2545F4914F6CDD1Dull;
+    double minimum = 0.0;
+    double maximum = 0.0;
+
+    std::size_t levelCapacity(std::size_t level) const {
+        std::size_t depth = levels.size() - level - 1;
+        std::size_t capacity = static_cast<std::size_t>(std::ceil(k * std::pow(2.0 / 3.0, static_cast<double>(depth))));
+        return capacity < MIN_LEVEL_WIDTH ? MIN_LEVEL_WIDTH : capacity;
+    }
+
+    void addLevel() {
+        levels.emplace_back();
+        capacityTotal = 0;
+        for (std::size_t h = 0; h < levels.size(); ++h) {
+            capacityTotal += levelCapacity(h);
+        }
+    }
+
+    bool coin() {
+        coinState ^= coinState << 13;
+        coinState ^= coinState >> 7;
+        coinState ^= coinState << 17;
+        return coinState & 1;
+    }
+
+    void compress() {
+        while (itemCount >= capacityTotal) {
+            for (std::size_t h = 0; h < levels.size(); ++h) {
+                if (levels[h].size() < levelCapacity(h)) {
+                    continue;
+                }
+                if (h + 1 == levels.size()) {
+                    addLevel();
+                }
+                std::vector<double>& level = levels[h];
+                std::sort(level.begin(), level.end());
+                std::size_t keepOdd = level.size() % 2; // an odd item out stays behind
+                double leftover = level.back();
+                std::size_t paired = level.size() - keepOdd;
+                std::vector<double>& up = levels[h + 1];
+                for (std::size_t i = coin() ? 1 : 0; i < paired; i += 2) {
+                    up.push_back(level[i]);
+                }
+                itemCount -= paired / 2;
+                level.clear();
+                if (keepOdd) {
+                    level.push_back(leftover);
+                }
+                break;
+            }
+        }
+    }
+
+public:
+    explicit KllSketch(std::size_t accuracy = 200) : k(accuracy) {
+        addLevel();
+        levels[0].reserve(k);
+    }
+
+    void add(double value) {
+        if (streamCount == 0 || value < minimum) {
+            minimum = value;
+        }
+        if (streamCount == 0 || value > maximum) {
+            maximum = value;
+        }
+        ++streamCount;
+        levels[0].push_back(value);
+        ++itemCount;
+        if (itemCount >= capacityTotal) {
+            compress();
+        }
+    }
+
+    void merge(const KllSketch& other) {
+        if (other.streamCount == 0) {
+            return;
+        }
+        while (levels.size() < other.levels.size()) {
+            addLevel();
+        }
+        for (std::size_t h = 0; h < other.levels.size(); ++h) {
+            levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+        }
+        itemCount += other.itemCount;
+        minimum = streamCount == 0 || other.minimum < minimum ? other.minimum : minimum;
+        maximum = streamCount == 0 || other.maximum > maximum ? other.maximum : maximum;
+        streamCount += other.streamCount;
+        compress();
+    }
+
+    // Value at quantile q in [0, 1]; 0 for an empty sketch.
+    double quantile(double q) const {
+        if (streamCount == 0) {
+            return 0.0;
+        }
+        if (q <= 0.0) {
+            return minimum;
+        }
+        if (q >= 1.0) {
+            return maximum;
+        }
+        std::vector<std::pair<double, std::uint64_t>> weighted;
+        weighted.reserve(itemCount);
+        std::uint64_t totalWeight = 0;
+        for (std::size_t h = 0; h < levels.size(); ++h) {
+            for (double value : levels[h]) {
+                weighted.emplace_back(value, std::uint64_t(1) << h);
+                totalWeight += std::uint64_t(1) << h;
+            }
+        }
+        std::sort(weighted.begin(), weighted.end());
+        double target = q * static_cast<double>(totalWeight);
+        std::uint64_t cumulative = 0;
+        for (const auto& item : weighted) {
+            cumulative += item.second;
+            if (static_cast<double>(cumulative) >= target) {
+                return item.first;
+            }
+        }
+        return maximum;
+    }
+
+    std::uint64_t count() const {
+        return streamCount;
+    }
+
+    // Items held, for memory accounting.
+    std::size_t retained() const {
+        return itemCount;
+    }
+};
+
+// The dashboard sketches for a stream of ride requests: distinct riders,
+// the busiest pickup -> dropoff routes and the fare distribution. Keep
+// one per thread or shard and merge them for the global view.
+struct RideSketches {
+    HyperLogLog riders;
+    HeavyHitters routes{32};
+    KllSketch fares{200};
+
+    void record(std::uint64_t riderHash, const std::string& pickup, const std::string& dropoff, double fare) {
+        riders.add(riderHash);
+        std::uint64_t route = sketchHash(sketchHash(pickup) ^ (sketchHash(dropoff) * 0x9E3779B97F4A7C15ull));
+        routes.offer(route, [&pickup, &dropoff](std::string& label) {
+            label.assign(pickup).append(" -> ").append(dropoff);
+        });
+        fares.add(fare);
+    }
+
+    void merge(const RideSketches& other) {
+        riders.merge(other.riders);
+        routes.merge(other.routes);
+        fares.merge(other.fares);
+    }
+};
@@ -0,0 +1,111 @@
+// SurgeEngine.h - Per-zone demand/supply counters and surge multipliers
+
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+struct SurgeConfig {
+    double smoothing = 0.3;      // weight of the latest window in the demand average
+    double threshold = 0.5;      // demand per free driver at which surge starts
+    double sensitivity = 0.5;    // multiplier gained per unit of demand/supply above threshold
+    double maxMultiplier = 3.0;
+    double step = 0.05;          // multipliers are rounded down to this step so fares don't jitter
+};
+
+// One zone's live state, on its own cache line so updates to neighbouring
+// zones never contend. `requests` and `freeDrivers` are written by any
+// thread with relaxed atomic adds; `multiplier` is written only by update().
+struct alignas(64) SurgeZoneCells {
+    std::atomic<std::uint32_t> requests{0};   // ride requests since the last update
+    std::atomic<std::int32_t> freeDrivers{0}; // drivers online and idle in the zone
+    std::atomic<double> multiplier{1.0};
+};
+
+// Surge pricing by zone:
+// - recordRequest() and driverFreed()/driverTaken() are single relaxed
+//   atomic adds, safe from any thread, so demand and supply can be fed
+//   straight from requestRide and driver availability changes
+// - update(), called every few seconds by one thread (a timer, or the
+//   simulator's clock), folds each zone's requests for the window into an
+//   exponential moving average, compares it with the zone's free drivers
+//   and publishes a new multiplier
+// - multiplier() is one relaxed atomic load, cheap enough for every fare
+//
+// epoch() counts the updates that changed any zone's multiplier, so callers
+// caching fares (see the quote cache) can tell when surge has moved.
+class SurgeEngine {
+private:
+    SurgeConfig config;
+    std::vector<SurgeZoneCells> zones;
+    std::vector<double> demand; // smoothed requests per window; update() only
+    std::atomic<std::uint64_t> epochCounter{0};
+
+public:
+    explicit SurgeEngine(std::size_t zoneCount, const SurgeConfig& cfg = SurgeConfig())
+        : config(cfg), zones(zoneCount), demand(zoneCount, 0.0) {}
+
+    SurgeEngine(const SurgeEngine&) = delete;
+    SurgeEngine& operator=(const SurgeEngine&) = delete;
+
+    void recordRequest(std::size_t zone) {
+        zones[zone].requests.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // A driver became available in the zone (came online, finished a trip).
+    void driverFreed(std::size_t zone) {
+        zones[zone].freeDrivers.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // A free driver left the zone's supply (matched, went offline).
+    void driverTaken(std::size_t zone) {
+        zones[zone].freeDrivers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    double multiplier(std::size_t zone) const {
+        return zones[zone].multiplier.load(std::memory_order_relaxed);
+    }
+
+    // Close the current window and recompute every zone's multiplier. Only
+    // one thread may call this at a time. Returns the highest multiplier.
+    double update() {
+        double peak = 1.0;
+        bool changed = false;
+        for (std::size_t z = 0; z < zones.size(); ++z) {
+            SurgeZoneCells& zone = zones[z];
+            double requests = zone.requests.exchange(0, std::memory_order_relaxed);
+            demand[z] += config.smoothing * (requests - demand[z]);
+            std::int32_t free = zone.freeDrivers.load(std::memory_order_relaxed);
+            double pressure = demand[z] / std::max(static_cast<double>(free), 1.0); // demand per free driver
+            double target = 1.0 + config.sensitivity * (pressure - config.threshold);
+            target = target < 1.0 ? 1.0 : (target > config.maxMultiplier ? config.maxMultiplier : target);
+            if (config.step > 0.0) {
+                target = 1.0 + static_cast<std::int64_t>((target - 1.0) / config.step) * config.step;
+            }
+            if (target != zone.multiplier.load(std::memory_order_relaxed)) {
+                zone.multiplier.store(target, std::memory_order_relaxed);
+                changed = true;
+            }
+            peak = target > peak ? target : peak;
+        }
+        if (changed) {
+            epochCounter.fetch_add(1, std::memory_order_release);
+        }
+        return peak;
+    }
+
+    std::uint64_t epoch() const {
+        return epochCounter.load(std::memory_order_acquire);
+    }
+
+    std::size_t zoneCount() const {
+        return zones.size();
+    }
+
+    std::int32_t freeDrivers(std::size_t zone) const {
+        return zones[zone].freeDrivers.load(std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,190 @@
+// TimerWheel.h - Hierarchical timing wheel with O(1) schedule and cancel
+
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+// A four-level hashed timing wheel (256 slots per level), in the style of the
+// classic Linux kernel timer wheel. Time is measured in abstract ticks; the
+// owner decides what a tick is (RideTimeouts uses one millisecond).
+//
+// - schedule() and cancel() are O(1): a timer is a node in an intrusive doubly
+//   linked list hanging off one slot.
+// - advance() walks tick by tick. Timers far in the future sit in the upper
+//   levels and are cascaded down as the lower level wraps around.
+//
+// Timers carry a 64-bit payload instead of a std::function, so scheduling
+// never allocates once the node pool has grown to its working size.
+class TimerWheel {
+public:
+    // Opaque handle: low 32 bits are the node index, high 32 bits a generation
+    // counter so a stale handle can never cancel a recycled node.
+    using TimerId = std::uint64_t;
+    static constexpr TimerId INVALID_TIMER = 0;
+
+private:
+    static constexpr unsigned SLOT_BITS = 8;
+    static constexpr std::size_t SLOTS_PER_LEVEL = std::size_t(1) << SLOT_BITS;
+    static constexpr std::size_t SLOT_MASK = SLOTS_PER_LEVEL - 1;
+    static constexpr std::size_t LEVELS = 4;
+    static constexpr std::uint32_t NIL = 0xFFFFFFFFu;
+
+    struct Node {
+        std::uint64_t expiry;
+        std::uint64_t payload;
+        std::uint32_t prev;
+        std::uint32_t next;
+        std::uint32_t generation;
+        std::uint16_t slot; // level * SLOTS_PER_LEVEL + index, valid while linked
+        bool active;
+    };
+
+    std::vector<Node> nodes;
+    std::uint32_t freeHead = NIL; // free list threaded through Node::next
+    std::array<std::uint32_t, LEVELS * SLOTS_PER_LEVEL> heads;
+    std::uint64_t currentTick; // last tick that has been fully processed
+    std::size_t activeCount = 0;
+
+    std::uint32_t allocateNode() {
+        if (freeHead != NIL) {
+            std::uint32_t index = freeHead;
+            freeHead = nodes[index].next;
+            return index;
+        }
+        nodes.push_back(Node{0, 0, NIL, NIL, 1, 0, false});
+        return static_cast<std::uint32_t>(nodes.size() - 1);
+    }
+
+    void releaseNode(std::uint32_t index) {
+        Node& node = nodes[index];
+        node.active = false;
+        ++node.generation;
+        if (node.generation == 0) {
+            node.generation = 1; // keep handles non-zero so INVALID_TIMER stays unique
+        }
+        node.next = freeHead;
+        freeHead = index;
+    }
+
+    // Pick the level/slot for an expiry relative to the current tick.
+    std::uint16_t slotFor(std::uint64_t expiry) const {
+        std::uint64_t delta = expiry - currentTick;
+        for (std::size_t level = 0; level < LEVELS; ++level) {
+            if (delta < (std::uint64_t(1) << (SLOT_BITS * (level + 1))) || level == LEVELS - 1) {
+                std::uint64_t index = (expiry >> (SLOT_BITS * level)) & SLOT_MASK;
+                if (level == LEVELS - 1 && delta >= (std::uint64_t(1) << (SLOT_BITS * LEVELS))) {
+                    // Beyond the wheel's range: park in the slot that cascades last
+                    // and let re-insertion bring it closer each revolution.
+                    index = ((currentTick >> (SLOT_BITS * level)) - 1) & SLOT_MASK;
+                }
+                return static_cast<std::uint16_t>(level * SLOTS_PER_LEVEL + index);
+            }
+        }
+        return 0; // unreachable
+    }
+
+    void link(std::uint32_t index) {
+        Node& node = nodes[index];
+        node.slot = slotFor(node.expiry);
+        node.prev = NIL;
+        node.next = heads[node.slot];
+        if (node.next != NIL) {
+            nodes[node.next].prev = index;
+        }
+        heads[node.slot] = index;
+    }
+
+    void unlink(std::uint32_t index) {
+        Node& node = nodes[index];
+        if (node.prev != NIL) {
+            nodes[node.prev].next = node.next;
+        } else {
+            heads[node.slot] = node.next;
+        }
+        if (node.next != NIL) {
+            nodes[node.next].prev = node.prev;
+        }
+    }
+
+    // Re-insert every timer from an upper-level slot; they land in lower levels.
+    void cascade(std::size_t level) {
+        std::size_t slot = level * SLOTS_PER_LEVEL + ((currentTick >> (SLOT_BITS * level)) & SLOT_MASK);
+        std::uint32_t index = heads[slot];
+        heads[slot] = NIL;
+        while (index != NIL) {
+            std::uint32_t next = nodes[index].next;
+            link(index);
+            index = next;
+        }
+    }
+
+public:
+    explicit TimerWheel(std::uint64_t startTick = 0) : currentTick(startTick) {
+        heads.fill(NIL);
+    }
+
+    // Arm a timer that fires `delayTicks` from now (at least one tick).
+    TimerId schedule(std::uint64_t delayTicks, std::uint64_t payload) {
+        std::uint32_t index = allocateNode();
+        Node& node = nodes[index];
+        node.expiry = currentTick + (delayTicks == 0 ? 1 : delayTicks);
+        node.payload = payload;
+        node.active = true;
+        link(index);
+        ++activeCount;
+        return (TimerId(node.generation) << 32) | index;
+    }
+
+    // Disarm a timer. Returns false if it already fired or was cancelled.
+    bool cancel(TimerId id) {
+        std::uint32_t index = static_cast<std::uint32_t>(id);
+        std::uint32_t generation = static_cast<std::uint32_t>(id >> 32);
+        if (index >= nodes.size() || !nodes[index].active || nodes[index].generation != generation) {
+            return false;
+        }
+        unlink(index);
+        releaseNode(index);
+        --activeCount;
+        return true;
+    }
+
+    // Process every tick up to and including `nowTick`, calling
+    // onExpire(payload) for each timer that comes due. Callbacks may schedule
+    // or cancel other timers.
+    template <typename OnExpire>
+    void advance(std::uint64_t nowTick, OnExpire&& onExpire) {
+        while (currentTick < nowTick) {
+            if (activeCount == 0) {
+                currentTick = nowTick; // nothing armed: jump straight to now
+                return;
+            }
+            ++currentTick;
+            for (std::size_t level = 1; level < LEVELS; ++level) {
+                if (((currentTick >> (SLOT_BITS * (level - 1))) & SLOT_MASK) != 0) {
+                    break;
+                }
+                cascade(level);
+            }
+            std::uint32_t& head = heads[currentTick & SLOT_MASK];
+            while (head != NIL) {
+                std::uint32_t index = head;
+                std::uint64_t payload = nodes[index].payload;
+                unlink(index);
+                releaseNode(index);
+                --activeCount;
+                onExpire(payload);
+            }
+        }
+    }
+
+    std::uint64_t now() const {
+        return currentTick;
+    }
+
+    std::size_t size() const {
+        return activeCount;
+    }
+};
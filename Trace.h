@@ -0,0 +1,150 @@
+// Trace.h - Scoped trace spans exported as Chrome trace-event JSON
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <cstdint>
+#include <cstdio>
+
+// One completed span. `name` must point at a string literal (or other
+// storage that outlives the trace); spans never copy or allocate strings.
+struct TraceEvent {
+    const char* name;
+    std::uint64_t startNs; // relative to Trace::start()
+    std::uint64_t durationNs;
+};
+
+// Process-wide span tracer.
+//
+// Every thread writes into its own fixed-size ring buffer, so recording a
+// span takes no locks: two clock reads and one slot write. When a ring is
+// full the oldest spans are overwritten, so a long run keeps its most recent
+// activity (e.g. the last busy second). The registry lock is only taken the
+// first time a thread records and when exporting.
+//
+// start(), stop() and writeChromeJson() are control operations: call them
+// while no spans are being recorded (typically before and after a run).
+class Trace {
+private:
+    struct ThreadBuffer {
+        std::vector<TraceEvent> ring;
+        std::atomic<std::uint64_t> written{0};
+        std::uint32_t threadId = 0;
+    };
+
+    inline static std::atomic<bool> enabled{false};
+    inline static std::mutex registryMutex;
+    inline static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    inline static std::size_t capacityPerThread = std::size_t(1) << 20;
+    inline static std::chrono::steady_clock::time_point origin;
+
+    static ThreadBuffer& localBuffer() {
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (buffer == nullptr) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            buffers.push_back(std::make_unique<ThreadBuffer>());
+            buffer = buffers.back().get();
+            buffer->ring.resize(capacityPerThread);
+            buffer->threadId = static_cast<std::uint32_t>(buffers.size());
+        }
+        return *buffer;
+    }
+
+public:
+    // Clear all buffers and begin recording spans.
+    static void start(std::size_t spansPerThread = std::size_t(1) << 20) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        capacityPerThread = spansPerThread == 0 ? 1 : spansPerThread;
+        for (auto& buffer : buffers) {
+            buffer->ring.assign(capacityPerThread, TraceEvent{nullptr, 0, 0});
+            buffer->written.store(0, std::memory_order_relaxed);
+        }
+        origin = std::chrono::steady_clock::now();
+        enabled.store(true, std::memory_order_release);
+    }
+
+    static void stop() {
+        enabled.store(false, std::memory_order_release);
+    }
+
+    static bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    static std::uint64_t nowNs() {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - origin).count());
+    }
+
+    static void record(const char* name, std::uint64_t startNs, std::uint64_t endNs) {
+        ThreadBuffer& buffer = localBuffer();
+        std::uint64_t n = buffer.written.load(std::memory_order_relaxed);
+        buffer.ring[n % buffer.ring.size()] = TraceEvent{name, startNs, endNs - startNs};
+        buffer.written.store(n + 1, std::memory_order_release);
+    }
+
+    // Write the retained spans of every thread as Chrome trace-event JSON
+    // ("X" complete events, microsecond timestamps). Open the file in
+    // chrome://tracing or https://ui.perfetto.dev. Returns false on I/O error.
+    static bool writeChromeJson(const std::string& path) {
+        std::ofstream out(path);
+        if (!out) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(registryMutex);
+        out << "{\"traceEvents\":[\n";
+        bool first = true;
+        char line[256];
+        for (const auto& buffer : buffers) {
+            std::uint64_t written = buffer->written.load(std::memory_order_acquire);
+            std::uint64_t size = buffer->ring.size();
+            std::uint64_t begin = written > size ? written - size : 0;
+            for (std::uint64_t i = begin; i < written; ++i) {
+                const TraceEvent& event = buffer->ring[i % size];
+                std::snprintf(line, sizeof(line),
+                              "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                              first ? "" : ",\n", event.name, event.startNs / 1000.0,
+                              event.durationNs / 1000.0, buffer->threadId);
+                out << line;
+                first = false;
+            }
+        }
+        out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+        return static_cast<bool>(out);
+    }
+};
+
+// Records the enclosing scope as a span when tracing is on. When it is off
+// the cost is a single relaxed load.
+class TraceSpan {
+private:
+    const char* name;
+    std::uint64_t startNs;
+
+public:
+    explicit TraceSpan(const char* spanName)
+        : name(Trace::isEnabled() ? spanName : nullptr), startNs(0) {
+        if (name != nullptr) {
+            startNs = Trace::nowNs();
+        }
+    }
+
+    ~TraceSpan() {
+        if (name != nullptr) {
+            Trace::record(name, startNs, Trace::nowNs());
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(traceSpan_, __LINE__)(name)
@@ -0,0 +1,381 @@
+// TrafficLog.h - Compact binary log of inbound engine calls for record/replay
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "Ride.h"
+
+// The calls a RideEngine accepts, as recorded in a traffic log.
+enum class TrafficOp : std::uint8_t {
+    AddRider = 1,
+    AddDriver = 2,
+    RequestRide = 3,
+    AddRide = 4,
+    Quote = 5
+};
+
+// One decoded call. Only the fields used by `op` are meaningful; `pickup`
+// and `dropoff` point into the reader's string table and stay valid for the
+// reader's lifetime.
+struct TrafficCall {
+    TrafficOp op = TrafficOp::Quote;
+    TimestampMs timestamp = 0;
+    std::uint32_t handle = 0;  // rider (RequestRide) or driver (AddRide) handle
+    RideType type = RideType::Standard;
+    std::string id;            // rider/driver ID, or ride ID
+    std::string name;          // rider/driver name
+    double rating = 0.0;       // driver rating
+    const std::string* pickup = nullptr;
+    const std::string* dropoff = nullptr;
+    double distance = 0.0;
+};
+
+// File layout (all integers little-endian):
+//   header:  "RSTL" magic, u32 format version
+//   record:  u8 op, zigzag varint timestamp delta from the previous record, then
+//     AddRider     str id, str name
+//     AddDriver    str id, str name, f64 rating
+//     RequestRide  varint rider handle, u8 type, str ride id, loc pickup, loc dropoff, f64 distance
+//     AddRide      varint driver handle, then as RequestRide
+//     Quote        u8 type, loc pickup, loc dropoff, f64 distance
+//   str = varint length + bytes; f64 = the IEEE-754 bits as a u64, so values
+//   replay bit for bit; loc = varint index + 1 into the location table, or 0
+//   followed by a str that is appended to the table (first use of a name).
+constexpr char TRAFFIC_LOG_MAGIC[4] = {'R', 'S', 'T', 'L'};
+constexpr std::uint32_t TRAFFIC_LOG_VERSION = 1;
+
+// Appends calls to a traffic log through a 64 KiB buffer. Recording a call
+// is a few varint writes and one hash lookup per location name.
+class TrafficRecorder {
+private:
+    std::FILE* file = nullptr;
+    std::vector<std::uint8_t> buffer;
+    std::unordered_map<std::string, std::uint32_t> locations;
+    TimestampMs lastTimestamp = 0;
+    std::uint64_t callCount = 0;
+    bool failed = false;
+
+    static constexpr std::size_t BUFFER_BYTES = 64 * 1024;
+
+    void putByte(std::uint8_t byte) {
+        buffer.push_back(byte);
+    }
+
+    void putVarint(std::uint64_t value) {
+        while (value >= 0x80) {
+            buffer.push_back(static_cast<std::uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        buffer.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    void putFixed(std::uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) {
+            buffer.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void putDouble(double value) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        putFixed(bits, 8);
+    }
+
+    void putString(const std::string& s) {
+        putVarint(s.size());
+        buffer.insert(buffer.end(), s.begin(), s.end());
+    }
+
+    void putLocation(const std::string& name) {
+        auto it = locations.find(name);
+        if (it != locations.end()) {
+            putVarint(std::uint64_t(it->second) + 1);
+            return;
+        }
+        putVarint(0);
+        putString(name);
+        locations.emplace(name, static_cast<std::uint32_t>(locations.size()));
+    }
+
+    void begin(TrafficOp op, TimestampMs at) {
+        putByte(static_cast<std::uint8_t>(op));
+        std::int64_t delta = at - lastTimestamp;
+        putVarint((static_cast<std::uint64_t>(delta) << 1) ^ static_cast<std::uint64_t>(delta >> 63)); // zigzag
+        lastTimestamp = at;
+        ++callCount;
+    }
+
+    void end() {
+        if (buffer.size() >= BUFFER_BYTES) {
+            flush();
+        }
+    }
+
+public:
+    TrafficRecorder() {
+        buffer.reserve(BUFFER_BYTES + 1024);
+    }
+
+    ~TrafficRecorder() {
+        close();
+    }
+
+    TrafficRecorder(const TrafficRecorder&) = delete;
+    TrafficRecorder& operator=(const TrafficRecorder&) = delete;
+
+    // Start a new log at `path`. Returns false if it cannot be created.
+    bool open(const std::string& path) {
+        close();
+        file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+            return false;
+        }
+        failed = false;
+        locations.clear();
+        lastTimestamp = 0;
+        callCount = 0;
+        buffer.insert(buffer.end(), TRAFFIC_LOG_MAGIC, TRAFFIC_LOG_MAGIC + 4);
+        putFixed(TRAFFIC_LOG_VERSION, 4);
+        return true;
+    }
+
+    bool flush() {
+        if (file != nullptr && !buffer.empty()) {
+            failed |= std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size();
+        }
+        buffer.clear();
+        return !failed;
+    }
+
+    // Flush and close. Returns false if any write failed.
+    bool close() {
+        if (file == nullptr) {
+            return !failed;
+        }
+        flush();
+        failed |= std::fclose(file) != 0;
+        file = nullptr;
+        return !failed;
+    }
+
+    bool isOpen() const {
+        return file != nullptr;
+    }
+
+    std::uint64_t recordedCalls() const {
+        return callCount;
+    }
+
+    void addRider(TimestampMs at, const std::string& id, const std::string& name) {
+        begin(TrafficOp::AddRider, at);
+        putString(id);
+        putString(name);
+        end();
+    }
+
+    void addDriver(TimestampMs at, const std::string& id, const std::string& name, double rating) {
+        begin(TrafficOp::AddDriver, at);
+        putString(id);
+        putString(name);
+        putDouble(rating);
+        end();
+    }
+
+    void rideCall(TrafficOp op, TimestampMs at, std::uint32_t handle, RideType type, const std::string& rideID,
+                  const std::string& pickup, const std::string& dropoff, double distance) {
+        begin(op, at);
+        putVarint(handle);
+        putByte(static_cast<std::uint8_t>(type));
+        putString(rideID);
+        putLocation(pickup);
+        putLocation(dropoff);
+        putDouble(distance);
+        end();
+    }
+
+    void quote(TimestampMs at, RideType type, const std::string& pickup, const std::string& dropoff, double distance) {
+        begin(TrafficOp::Quote, at);
+        putByte(static_cast<std::uint8_t>(type));
+        putLocation(pickup);
+        putLocation(dropoff);
+        putDouble(distance);
+        end();
+    }
+};
+
+// Reads a traffic log back one call at a time. The whole file is loaded
+// into memory up front so replay speed is not bound by I/O.
+class TrafficReader {
+private:
+    std::vector<std::uint8_t> data;
+    std::size_t pos = 0;
+    std::deque<std::string> locations; // deque: stable addresses for TrafficCall
+    TimestampMs lastTimestamp = 0;
+    bool corrupt = false;
+
+    bool getByte(std::uint8_t& out) {
+        if (pos >= data.size()) {
+            return false;
+        }
+        out = data[pos++];
+        return true;
+    }
+
+    bool getVarint(std::uint64_t& out) {
+        out = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            std::uint8_t byte;
+            if (!getByte(byte)) {
+                return false;
+            }
+            out |= std::uint64_t(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool getDouble(double& out) {
+        if (data.size() - pos < 8) {
+            return false;
+        }
+        std::uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i) {
+            bits |= std::uint64_t(data[pos + i]) << (8 * i);
+        }
+        pos += 8;
+        std::memcpy(&out, &bits, sizeof(out));
+        return true;
+    }
+
+    bool getString(std::string& out) {
+        std::uint64_t size;
+        if (!getVarint(size) || data.size() - pos < size) {
+            return false;
+        }
+        out.assign(reinterpret_cast<const char*>(data.data() + pos), static_cast<std::size_t>(size));
+        pos += static_cast<std::size_t>(size);
+        return true;
+    }
+
+    bool getLocation(const std::string*& out) {
+        std::uint64_t ref;
+        if (!getVarint(ref)) {
+            return false;
+        }
+        if (ref == 0) {
+            locations.emplace_back();
+            if (!getString(locations.back())) {
+                return false;
+            }
+            out = &locations.back();
+            return true;
+        }
+        if (ref > locations.size()) {
+            return false;
+        }
+        out = &locations[static_cast<std::size_t>(ref - 1)];
+        return true;
+    }
+
+    bool getType(RideType& out) {
+        std::uint8_t byte;
+        if (!getByte(byte) || byte >= RIDE_TYPE_COUNT) {
+            return false;
+        }
+        out = static_cast<RideType>(byte);
+        return true;
+    }
+
+    bool decode(TrafficCall& call) {
+        std::uint8_t op;
+        std::uint64_t zigzag;
+        if (!getByte(op) || !getVarint(zigzag)) {
+            return false;
+        }
+        std::int64_t delta = static_cast<std::int64_t>(zigzag >> 1) ^ -static_cast<std::int64_t>(zigzag & 1);
+        lastTimestamp += delta;
+        call.op = static_cast<TrafficOp>(op);
+        call.timestamp = lastTimestamp;
+        std::uint64_t handle = 0;
+        switch (call.op) {
+            case TrafficOp::AddRider:
+                return getString(call.id) && getString(call.name);
+            case TrafficOp::AddDriver:
+                return getString(call.id) && getString(call.name) && getDouble(call.rating);
+            case TrafficOp::RequestRide:
+            case TrafficOp::AddRide:
+                if (!getVarint(handle) || handle > 0xFFFFFFFFu) {
+                    return false;
+                }
+                call.handle = static_cast<std::uint32_t>(handle);
+                return getType(call.type) && getString(call.id) && getLocation(call.pickup) &&
+                       getLocation(call.dropoff) && getDouble(call.distance);
+            case TrafficOp::Quote:
+                return getType(call.type) && getLocation(call.pickup) && getLocation(call.dropoff) &&
+                       getDouble(call.distance);
+        }
+        return false;
+    }
+
+public:
+    // Load a log. Returns false if the file cannot be read or is not a
+    // traffic log of a supported version.
+    bool open(const std::string& path) {
+        data.clear();
+        pos = 0;
+        locations.clear();
+        lastTimestamp = 0;
+        corrupt = false;
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            return false;
+        }
+        std::uint8_t chunk[64 * 1024];
+        std::size_t n;
+        while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            data.insert(data.end(), chunk, chunk + n);
+        }
+        bool readError = std::ferror(file) != 0;
+        std::fclose(file);
+        if (readError || data.size() < 8 || std::memcmp(data.data(), TRAFFIC_LOG_MAGIC, 4) != 0) {
+            return false;
+        }
+        std::uint32_t version = 0;
+        for (int i = 0; i < 4; ++i) {
+            version |= std::uint32_t(data[4 + i]) << (8 * i);
+        }
+        pos = 8;
+        return version == TRAFFIC_LOG_VERSION;
+    }
+
+    // Decode the next call. Returns false at the end of the log or on a
+    // truncated/corrupt record (see isCorrupt()).
+    bool next(TrafficCall& call) {
+        if (pos >= data.size()) {
+            return false;
+        }
+        if (!decode(call)) {
+            corrupt = true;
+            pos = data.size();
+            return false;
+        }
+        return true;
+    }
+
+    bool isCorrupt() const {
+        return corrupt;
+    }
+
+    std::size_t sizeBytes() const {
+        return data.size();
+    }
+};
@@ -0,0 +1,229 @@
+// Workload.h - Deterministic synthetic city workload
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+#include "Ride.h"
+
+// Small, fast, seedable PRNG (xoshiro256**, seeded through splitmix64).
+// The raw stream (next(), uniform(), below()) is integer arithmetic plus one
+// exact conversion, so a seed gives the same numbers on every platform.
+class WorkloadRng {
+private:
+    std::array<std::uint64_t, 4> state;
+
+    static std::uint64_t rotl(std::uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+public:
+    explicit WorkloadRng(std::uint64_t seed) {
+        for (std::uint64_t& word : state) {
+            seed += 0x9E3779B97F4A7C15ull;
+            std::uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    std::uint64_t next() {
+        std::uint64_t result = rotl(state[1] * 5, 7) * 9;
+        std::uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+    // Uniform double in [0, 1).
+    double uniform() {
+        return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // Uniform integer in [0, bound).
+    std::uint64_t below(std::uint64_t bound) {
+        return static_cast<std::uint64_t>(uniform() * static_cast<double>(bound));
+    }
+};
+
+// Samples ranks 0..n-1 with probability proportional to 1 / (rank + 1)^s,
+// using Vose's alias method: O(n) setup, O(1) per sample.
+class ZipfSampler {
+private:
+    std::vector<double> probability;
+    std::vector<std::uint32_t> alias;
+
+public:
+    ZipfSampler(std::size_t n, double exponent) : probability(n), alias(n) {
+        std::vector<double> scaled(n);
+        double total = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            scaled[i] = 1.0 / std::pow(static_cast<double>(i + 1), exponent);
+            total += scaled[i];
+        }
+        std::vector<std::uint32_t> small, large;
+        for (std::size_t i = 0; i < n; ++i) {
+            scaled[i] = scaled[i] * static_cast<double>(n) / total;
+            (scaled[i] < 1.0 ? small : large).push_back(static_cast<std::uint32_t>(i));
+        }
+        while (!small.empty() && !large.empty()) {
+            std::uint32_t s = small.back();
+            small.pop_back();
+            std::uint32_t l = large.back();
+            probability[s] = scaled[s];
+            alias[s] = l;
+            scaled[l] -= 1.0 - scaled[s];
+            if (scaled[l] < 1.0) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        for (std::uint32_t i : large) probability[i] = 1.0;
+        for (std::uint32_t i : small) probability[i] = 1.0; // rounding leftovers
+    }
+
+    std::uint32_t sample(WorkloadRng& rng) const {
+        std::uint32_t column = static_cast<std::uint32_t>(rng.below(probability.size()));
+        return rng.uniform() < probability[column] ? column : alias[column];
+    }
+
+    std::size_t size() const {
+        return probability.size();
+    }
+};
+
+// Relative request intensity over a day, with a morning and an evening peak
+// and a quiet night. Hourly weights are linearly interpolated; the mean
+// over 24 hours is 1.0, so it scales a base rate without changing its daily total.
+class DiurnalCurve {
+private:
+    std::array<double, 24> weights;
+
+public:
+    DiurnalCurve() {
+        static constexpr double HOURLY[24] = {
+            0.35, 0.25, 0.18, 0.15, 0.20, 0.45, 0.90, 1.60, 1.90, 1.40, 1.05, 1.00,
+            1.10, 1.00, 0.95, 1.05, 1.40, 1.85, 1.95, 1.55, 1.25, 1.05, 0.80, 0.55
+        };
+        double sum = 0.0;
+        for (double w : HOURLY) sum += w;
+        for (std::size_t h = 0; h < 24; ++h) weights[h] = HOURLY[h] * 24.0 / sum;
+    }
+
+    double multiplierAt(TimestampMs t) const {
+        static constexpr TimestampMs HOUR_MS = 60 * 60 * 1000;
+        TimestampMs inDay = ((t % (24 * HOUR_MS)) + 24 * HOUR_MS) % (24 * HOUR_MS);
+        std::size_t hour = static_cast<std::size_t>(inDay / HOUR_MS);
+        double frac = static_cast<double>(inDay % HOUR_MS) / HOUR_MS;
+        return weights[hour] * (1.0 - frac) + weights[(hour + 1) % 24] * frac;
+    }
+
+    double peak() const {
+        double best = 0.0;
+        for (double w : weights) best = w > best ? w : best;
+        return best;
+    }
+};
+
+struct WorkloadConfig {
+    std::uint64_t seed = 42;
+    std::size_t riderCount = 1000000;
+    std::size_t driverCount = 100000;
+    std::size_t locationCount = 5000;
+    double zipfExponent = 1.1;        // location popularity skew
+    double premiumShare = 0.2;        // fraction of PremiumRide requests
+    double requestsPerSecond = 50.0;  // daily mean, in virtual time
+    TimestampMs startTime = 0;        // virtual clock origin (midnight)
+};
+
+// One synthetic ride request.
+struct RideRequestEvent {
+    TimestampMs timestamp;
+    std::uint32_t riderIndex;
+    std::uint32_t pickup;   // location index
+    std::uint32_t dropoff;  // location index
+    double distance;        // miles
+    bool premium;
+};
+
+// Generates an endless, reproducible stream of ride requests for a city:
+// locations are ranked by Zipf popularity and placed on a 20 x 20 mile plane,
+// arrivals follow a Poisson process whose rate follows the diurnal curve.
+// Reproducible means same seed, same build: the Zipf weights and arrival
+// gaps go through std::pow and std::log, which C libraries may round
+// differently in the last bit, so another compiler or libm can shift
+// timestamps and location picks (and with them loadgen and replay digests).
+class WorkloadGenerator {
+private:
+    WorkloadConfig config;
+    WorkloadRng rng;
+    ZipfSampler locations;
+    DiurnalCurve curve;
+    std::vector<std::string> locationNames;
+    std::vector<std::pair<float, float>> coordinates;
+    TimestampMs clock;
+
+public:
+    explicit WorkloadGenerator(const WorkloadConfig& cfg)
+        : config(cfg), rng(cfg.seed), locations(cfg.locationCount, cfg.zipfExponent), clock(cfg.startTime) {
+        // The most popular ranks get the familiar demo names.
+        static const char* LANDMARKS[] = {
+            "Downtown", "Airport", "City Center", "Suburb A", "Park", "Museum",
+            "Library", "Cafe", "Mall", "Home", "Gym", "School"
+        };
+        locationNames.reserve(cfg.locationCount);
+        coordinates.reserve(cfg.locationCount);
+        for (std::size_t i = 0; i < cfg.locationCount; ++i) {
+            locationNames.push_back(i < 12 ? std::string(LANDMARKS[i]) : "Loc-" + std::to_string(i));
+            coordinates.emplace_back(static_cast<float>(rng.uniform() * 20.0), static_cast<float>(rng.uniform() * 20.0));
+        }
+    }
+
+    const WorkloadConfig& getConfig() const { return config; }
+    const std::string& locationName(std::uint32_t index) const { return locationNames[index]; }
+    std::size_t locationCount() const { return locationNames.size(); }
+    // Position on the 20 x 20 mile plane, in miles.
+    const std::pair<float, float>& locationCoordinates(std::uint32_t index) const { return coordinates[index]; }
+    TimestampMs now() const { return clock; }
+
+    // Road distance between two locations: straight line plus 30% detour,
+    // never shorter than half a mile.
+    double routeDistance(std::uint32_t from, std::uint32_t to) const {
+        double dx = coordinates[from].first - coordinates[to].first;
+        double dy = coordinates[from].second - coordinates[to].second;
+        double miles = std::sqrt(dx * dx + dy * dy) * 1.3;
+        return miles < 0.5 ? 0.5 : miles;
+    }
+
+    RideRequestEvent next() {
+        // Poisson arrivals with a time-varying rate (thinning against the peak rate).
+        double peakRate = config.requestsPerSecond * curve.peak();
+        while (true) {
+            double gapSeconds = -std::log(1.0 - rng.uniform()) / peakRate;
+            clock += static_cast<TimestampMs>(gapSeconds * 1000.0 + 0.5);
+            if (rng.uniform() * curve.peak() <= curve.multiplierAt(clock - config.startTime)) {
+                break;
+            }
+        }
+        RideRequestEvent event;
+        event.timestamp = clock;
+        event.riderIndex = static_cast<std::uint32_t>(rng.below(config.riderCount));
+        event.pickup = locations.sample(rng);
+        do {
+            event.dropoff = locations.sample(rng);
+        } while (event.dropoff == event.pickup && locations.size() > 1);
+        event.distance = routeDistance(event.pickup, event.dropoff);
+        event.premium = rng.uniform() < config.premiumShare;
+        return event;
+    }
+};
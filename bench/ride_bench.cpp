@@ -0,0 +1,551 @@
+// ride_bench.cpp - Microbenchmarks for the core ride classes
+//
+// Build:  g++ -O2 -std=c++17 -I. -DRIDESHARE_TRACK_ALLOCATIONS bench/ride_bench.cpp AllocTracker.cpp -o ride_bench
+// Run:    ./ride_bench [--max-n N] [--min-ops N] [--json FILE] [--perf]
+//
+// Every case is run at n = 1e3, 1e4, ... up to --max-n (default 1e6; pass
+// 10000000 for the full 1e7 sweep, which needs a few GB of RAM). Results are
+// printed as a table and, with --json, written as machine-readable JSON
+// ("-" writes JSON to stdout instead of the table). --perf also samples
+// hardware counters (cycles, instructions, cache and branch misses) per op
+// where the kernel allows it.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Ride.h"
+#include "Driver.h"
+#include "Rider.h"
+#include "QuietOutput.h"
+#include "LatencyHistogram.h"
+#include "DriverPool.h"
+#include "PerfCounters.h"
+#include "SimEventQueue.h"
+#include "Workload.h"
+#include "PricingRules.h"
+#include "SurgeEngine.h"
+#include "QuoteCache.h"
+#include "Leaderboard.h"
+#include "RideQuery.h"
+#include "Sketches.h"
+#include "AllocTracker.h"
+
+// Keeps the optimiser from discarding computed results.
+static volatile double g_sink = 0.0;
+
+struct BenchResult {
+    std::string name;
+    std::size_t n;
+    std::size_t ops;
+    double nsPerOp;
+    double allocsPerOp;
+    double bytesPerOp;
+    PerfReport perf; // empty unless --perf
+};
+
+struct BenchCase {
+    std::string name;
+    // Prepares state for a run of n operations and returns the timed body.
+    std::function<std::function<void()>(std::size_t n)> prepare;
+};
+
+static std::string rideIdFor(std::size_t i) {
+    return "R" + std::to_string(i);
+}
+
+static std::vector<std::unique_ptr<Ride>> makeRides(std::size_t n) {
+    std::vector<std::unique_ptr<Ride>> rides;
+    rides.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (i % 4 == 3) {
+            rides.push_back(std::make_unique<PremiumRide>(rideIdFor(i), "Airport", "City Center", 25.0, 0));
+        } else {
+            rides.push_back(std::make_unique<StandardRide>(rideIdFor(i), "Downtown", "Suburb A", 10.5, 0));
+        }
+    }
+    return rides;
+}
+
+static std::vector<BenchCase> buildCases() {
+    std::vector<BenchCase> cases;
+
+    cases.push_back({"StandardRide construction", [](std::size_t n) {
+        auto ids = std::make_shared<std::vector<std::string>>();
+        for (std::size_t i = 0; i < n; ++i) ids->push_back(rideIdFor(i));
+        auto rides = std::make_shared<std::vector<std::unique_ptr<Ride>>>();
+        rides->reserve(n);
+        return std::function<void()>([ids, rides, n]() {
+            rides->clear();
+            for (std::size_t i = 0; i < n; ++i) {
+                rides->push_back(std::make_unique<StandardRide>((*ids)[i], "Downtown", "Suburb A", 10.5, 0));
+            }
+        });
+    }});
+
+    cases.push_back({"PremiumRide construction", [](std::size_t n) {
+        auto ids = std::make_shared<std::vector<std::string>>();
+        for (std::size_t i = 0; i < n; ++i) ids->push_back(rideIdFor(i));
+        auto rides = std::make_shared<std::vector<std::unique_ptr<Ride>>>();
+        rides->reserve(n);
+        return std::function<void()>([ids, rides, n]() {
+            rides->clear();
+            for (std::size_t i = 0; i < n; ++i) {
+                rides->push_back(std::make_unique<PremiumRide>((*ids)[i], "Airport", "City Center", 25.0, 0));
+            }
+        });
+    }});
+
+    cases.push_back({"calculateFare", [](std::size_t n) {
+        auto rides = std::make_shared<std::vector<std::unique_ptr<Ride>>>(makeRides(n));
+        return std::function<void()>([rides]() {
+            double total = 0.0;
+            for (const auto& ride : *rides) {
+                ride->calculateFare();
+                total += ride->getFare();
+            }
+            g_sink = total;
+        });
+    }});
+
+    cases.push_back({"fareBatch (per-tier kernel)", [](std::size_t n) {
+        auto distances = std::make_shared<std::vector<double>>(n);
+        auto fares = std::make_shared<std::vector<double>>(n);
+        for (std::size_t i = 0; i < n; ++i) (*distances)[i] = 0.5 + (i % 40) * 0.75;
+        return std::function<void()>([distances, fares, n]() {
+            // Same 3:1 standard/premium mix as makeRides, priced a tier at a time.
+            std::size_t standard = n - n / 4;
+            fareBatch(RideType::Standard, distances->data(), fares->data(), standard);
+            fareBatch(RideType::Premium, distances->data() + standard, fares->data() + standard, n - standard);
+            g_sink = (*fares)[n - 1];
+        });
+    }});
+
+    cases.push_back({"PricingTable fareBatch", [](std::size_t n) {
+        PricingRuleSet rules;
+        std::string error;
+        rules.parse("tier standard rate 2.00 minimum 5.00\n"
+                    "tier premium rate 3.50 base 5.00 minimum 12.00\n"
+                    "time 07:00-10:00 multiplier 1.25\n"
+                    "time 23:00-04:00 multiplier 1.15 tier premium\n"
+                    "zone Downtown multiplier 1.10\n"
+                    "airport Airport fee 4.50\n", error);
+        auto table = std::make_shared<PricingTable>(rules);
+        const char* names[] = {"Downtown", "Airport", "Suburb A", "Park"};
+        auto trips = std::make_shared<std::vector<PricingInput>>(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            (*trips)[i] = PricingInput{0.5 + (i % 40) * 0.75, static_cast<TimestampMs>(i) * 37000,
+                                       table->zoneOf(names[i % 4]), table->zoneOf(names[(i / 4) % 4]),
+                                       i % 4 == 3 ? RideType::Premium : RideType::Standard};
+        }
+        auto fares = std::make_shared<std::vector<double>>(n);
+        return std::function<void()>([table, trips, fares, n]() {
+            table->fareBatch(trips->data(), fares->data(), n);
+            g_sink = (*fares)[n - 1];
+        });
+    }});
+
+    cases.push_back({"Driver::addRide", [](std::size_t n) {
+        auto pending = std::make_shared<std::vector<std::unique_ptr<Ride>>>(makeRides(n));
+        auto driver = std::make_shared<Driver>("D001", "Alice Smith", 4.8);
+        return std::function<void()>([pending, driver]() {
+            for (auto& ride : *pending) {
+                driver->addRide(std::move(ride));
+            }
+        });
+    }});
+
+    // Same, with the history capped at 64 rides: every add past the cap
+    // folds the oldest ride into the summary and frees it.
+    cases.push_back({"Driver::addRide (64 recent)", [](std::size_t n) {
+        auto pending = std::make_shared<std::vector<std::unique_ptr<Ride>>>(makeRides(n));
+        auto driver = std::make_shared<Driver>("D001", "Alice Smith", 4.8);
+        RideHistoryPolicy policy;
+        policy.recentRides = 64;
+        driver->setHistoryPolicy(policy);
+        return std::function<void()>([pending, driver]() {
+            for (auto& ride : *pending) {
+                driver->addRide(std::move(ride));
+            }
+        });
+    }});
+
+    cases.push_back({"Rider::requestRide", [](std::size_t n) {
+        auto pending = std::make_shared<std::vector<std::unique_ptr<Ride>>>(makeRides(n));
+        auto rider = std::make_shared<Rider>("R001", "Sandesh Shrestha");
+        return std::function<void()>([pending, rider]() {
+            for (auto& ride : *pending) {
+                rider->requestRide(std::move(ride));
+            }
+        });
+    }});
+
+    cases.push_back({"history iteration", [](std::size_t n) {
+        auto driver = std::make_shared<Driver>("D001", "Alice Smith", 4.8);
+        for (auto& ride : makeRides(n)) {
+            driver->addRide(std::move(ride));
+        }
+        return std::function<void()>([driver]() {
+            double total = 0.0;
+            driver->forEachRide([&total](const Ride& ride) { total += ride.getFare(); });
+            g_sink = total;
+        });
+    }});
+
+    // A one-hour window of a driver's history through the time index: rides
+    // a minute apart (every tenth arriving late), n windows at spread-out
+    // offsets, each O(log n + 60).
+    cases.push_back({"Driver rides in 1h window", [](std::size_t n) {
+        const TimestampMs MINUTE = 60 * 1000;
+        auto driver = std::make_shared<Driver>("D001", "Alice Smith", 4.8);
+        for (std::size_t i = 0; i < n; ++i) {
+            TimestampMs at = static_cast<TimestampMs>(i % 10 == 9 ? i - 5 : i) * MINUTE;
+            driver->addRide(std::make_unique<StandardRide>(rideIdFor(i), "Downtown", "Suburb A", 10.5, at));
+        }
+        return std::function<void()>([driver, n, MINUTE]() {
+            double total = 0.0;
+            for (std::size_t i = 0; i < n; ++i) {
+                TimestampMs from = static_cast<TimestampMs>((i * 7919) % n) * MINUTE;
+                driver->forEachRideBetween(from, from + 60 * MINUTE,
+                                           [&total](const Ride& ride) { total += ride.getFare(); });
+            }
+            g_sink = total;
+        });
+    }});
+
+    // The same total from the running aggregates: O(1) per query at any n.
+    cases.push_back({"Driver earnings query", [](std::size_t n) {
+        auto driver = std::make_shared<Driver>("D001", "Alice Smith", 4.8);
+        for (auto& ride : makeRides(n)) {
+            driver->addRide(std::move(ride));
+        }
+        return std::function<void()>([driver, n]() {
+            double total = 0.0;
+            for (std::size_t i = 0; i < n; ++i) {
+                total += driver->getEarnings().fare(i & 1 ? RideType::Premium : RideType::Standard);
+            }
+            g_sink = total;
+        });
+    }});
+
+    cases.push_back({"Driver rating submit", [](std::size_t n) {
+        auto driver = std::make_shared<Driver>("D001", "Alice Smith", 4.8);
+        return std::function<void()>([driver, n]() {
+            for (std::size_t i = 0; i < n; ++i) {
+                driver->rate(static_cast<int>(i % 5) + 1);
+            }
+            g_sink = driver->getRatings().lastRatingsAverage();
+        });
+    }});
+
+    // Re-rank every member of an n-driver board once with a new score.
+    cases.push_back({"Leaderboard update", [](std::size_t n) {
+        auto board = std::make_shared<Leaderboard<double>>();
+        auto scores = std::make_shared<std::vector<double>>(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            (*scores)[i] = static_cast<double>((i * 7919) % 1000);
+            board->insert(static_cast<std::uint32_t>(i), (*scores)[i]);
+        }
+        auto round = std::make_shared<std::size_t>(0);
+        return std::function<void()>([board, scores, round, n]() {
+            std::size_t r = ++*round;
+            for (std::size_t i = 0; i < n; ++i) {
+                double score = static_cast<double>((i * 7919 + r * 104729) % 1000);
+                board->rescore(static_cast<std::uint32_t>(i), (*scores)[i], score);
+                (*scores)[i] = score;
+            }
+            g_sink = (*scores)[0];
+        });
+    }});
+
+    // Filter on tier and total fare by pickup over an n-ride columnar
+    // table on one thread; ns/op is per ride scanned.
+    cases.push_back({"RideColumns query (per ride)", [](std::size_t n) {
+        auto table = std::make_shared<RideColumns>();
+        for (std::size_t i = 0; i < n; ++i) {
+            RideType type = i % 5 == 0 ? RideType::Premium : RideType::Standard;
+            double distance = 0.5 + (i % 40) * 0.75;
+            table->appendRow(type, RideStatus::Completed, table->locationId("Loc-" + std::to_string(i % 64)),
+                             table->locationId("Loc-" + std::to_string((i / 64) % 64)), distance,
+                             fareFor(type, distance), static_cast<TimestampMs>(i) * 1000);
+        }
+        auto rows = std::make_shared<std::vector<RideQueryRow>>();
+        return std::function<void()>([table, rows]() {
+            RideQuery query;
+            query.filterType = true;
+            query.type = RideType::Premium;
+            query.groupBy = RideGroupBy::Pickup;
+            table->query(query, *rows, 1);
+            g_sink = (*rows)[0].fare;
+        });
+    }});
+
+    // One request fed to the dashboard sketches: a HyperLogLog add, a
+    // Count-Min heavy-hitter offer and a KLL insert.
+    cases.push_back({"RideSketches record", [](std::size_t n) {
+        auto sketches = std::make_shared<RideSketches>();
+        auto names = std::make_shared<std::vector<std::string>>();
+        for (int i = 0; i < 256; ++i) {
+            names->push_back("Loc-" + std::to_string(i));
+        }
+        return std::function<void()>([sketches, names, n]() {
+            for (std::size_t i = 0; i < n; ++i) {
+                sketches->record(sketchHash(i), (*names)[i & 255], (*names)[(i >> 3) & 255],
+                                 10.0 + static_cast<double>(i % 97));
+            }
+            g_sink = static_cast<double>(sketches->fares.count());
+        });
+    }});
+
+    // One dispatch round: collect up to 8 free candidates in a region from a
+    // pool of 100k drivers spread over 64 regions, about half of them free.
+    cases.push_back({"dispatch round", [](std::size_t n) {
+        struct DispatchState {
+            std::vector<Driver> drivers;
+            DriverPool pool{64};
+            std::vector<DriverIndex> candidates;
+        };
+        auto state = std::make_shared<DispatchState>();
+        state->drivers.reserve(100000);
+        for (std::size_t i = 0; i < 100000; ++i) {
+            state->drivers.emplace_back("D" + std::to_string(i), "Driver", 4.5);
+            DriverIndex index = state->pool.registerDriver(state->drivers.back());
+            state->pool.setOnline(index, true);
+            state->pool.setBusy(index, (i * 2654435761u) % 7 < 3);
+            state->pool.moveToRegion(index, static_cast<std::uint32_t>((i * 40503u) % 64));
+        }
+        return std::function<void()>([state, n]() {
+            std::size_t found = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                found += state->pool.findCandidates(static_cast<std::uint32_t>(i % 64), 8, state->candidates);
+            }
+            g_sink = static_cast<double>(found);
+        });
+    }});
+
+    // Simulation hold model: with 10k events pending, pop the earliest and
+    // schedule a follow-up up to two minutes later (one pop + one push per op).
+    cases.push_back({"SimEventQueue hold", [](std::size_t n) {
+        struct HoldState {
+            SimEventQueue queue{0};
+            std::vector<TimestampMs> delays;
+        };
+        auto state = std::make_shared<HoldState>();
+        WorkloadRng rng(7);
+        for (std::size_t i = 0; i < 4096; ++i) {
+            state->delays.push_back(1 + static_cast<TimestampMs>(rng.below(120000)));
+        }
+        for (std::uint32_t i = 0; i < 10000; ++i) {
+            state->queue.push(static_cast<TimestampMs>(rng.below(120000)), 0, i);
+        }
+        return std::function<void()>([state, n]() {
+            SimEvent event{};
+            for (std::size_t i = 0; i < n; ++i) {
+                if (!state->queue.pop(event)) {
+                    break; // every pop is followed by a push, so the queue never drains
+                }
+                state->queue.push(event.time + state->delays[i & 4095], event.kind, event.subject);
+            }
+            g_sink = static_cast<double>(event.time);
+        });
+    }});
+
+    // Surge bookkeeping per request over 4096 zones: record the request and
+    // read the zone's multiplier, with an update() every 64k requests.
+    cases.push_back({"SurgeEngine request", [](std::size_t n) {
+        auto surge = std::make_shared<SurgeEngine>(4096);
+        auto zones = std::make_shared<std::vector<std::uint32_t>>();
+        WorkloadRng rng(11);
+        for (std::size_t i = 0; i < 4096; ++i) {
+            zones->push_back(static_cast<std::uint32_t>(rng.below(4096)));
+            surge->driverFreed(i);
+        }
+        return std::function<void()>([surge, zones, n]() {
+            double total = 0.0;
+            for (std::size_t i = 0; i < n; ++i) {
+                std::uint32_t zone = (*zones)[i & 4095];
+                surge->recordRequest(zone);
+                total += surge->multiplier(zone);
+                if ((i & 65535) == 65535) {
+                    surge->update();
+                }
+            }
+            g_sink = total;
+        });
+    }});
+
+    // Quote cache hits on a warm cache of 4096 routes (key hash + seqlock read).
+    cases.push_back({"QuoteCache hit", [](std::size_t n) {
+        struct CacheState {
+            QuoteCache cache{16384};
+            std::vector<std::string> names;
+        };
+        auto state = std::make_shared<CacheState>();
+        for (std::size_t i = 0; i < 64; ++i) state->names.push_back("Loc-" + std::to_string(i));
+        for (std::size_t i = 0; i < 4096; ++i) {
+            std::uint64_t key = QuoteCache::keyOf(RideType::Standard, state->names[i % 64], state->names[i / 64], 0);
+            state->cache.store(key, 0, 10.0, 5.0, state->cache.version());
+        }
+        return std::function<void()>([state, n]() {
+            double total = 0.0;
+            for (std::size_t i = 0; i < n; ++i) {
+                std::size_t route = i & 4095;
+                std::uint64_t key = QuoteCache::keyOf(RideType::Standard, state->names[route % 64],
+                                                      state->names[route / 64], 0);
+                double fare = 0.0;
+                double distance = 0.0;
+                state->cache.lookup(key, 0, fare, distance);
+                total += fare;
+            }
+            g_sink = total;
+        });
+    }});
+
+    // Cost of one timed scope with latency recording switched on.
+    cases.push_back({"ScopedLatency record", [](std::size_t n) {
+        static LatencyRecorder recorder("bench.scope");
+        return std::function<void()>([n]() {
+            LatencyRecorder::setEnabled(true);
+            for (std::size_t i = 0; i < n; ++i) {
+                ScopedLatency timer(recorder);
+            }
+            LatencyRecorder::setEnabled(false);
+        });
+    }});
+
+    return cases;
+}
+
+// Run one case at size n. Small sizes are repeated (with fresh state each
+// time) until at least minOps operations have been timed.
+static BenchResult runCase(const BenchCase& benchCase, std::size_t n, std::size_t minOps, PerfCounters* counters) {
+    std::size_t reps = n >= minOps ? 1 : (minOps + n - 1) / n;
+    double totalNs = 0.0;
+    std::size_t totalAllocs = 0;
+    std::size_t totalBytes = 0;
+    PerfReport perf;
+    for (std::size_t rep = 0; rep < reps; ++rep) {
+        std::function<void()> body = benchCase.prepare(n);
+        AllocStats before = AllocTracker::totals();
+        if (counters != nullptr) {
+            counters->start();
+        }
+        auto start = std::chrono::steady_clock::now();
+        body();
+        auto stop = std::chrono::steady_clock::now();
+        if (counters != nullptr) {
+            PerfReport sample = counters->stop(benchCase.name, n);
+            for (std::size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+                perf.counts[i] += sample.counts[i];
+                perf.valid[i] = sample.valid[i];
+            }
+        }
+        AllocStats after = AllocTracker::totals();
+        totalAllocs += after.allocations - before.allocations;
+        totalBytes += after.bytesAllocated - before.bytesAllocated;
+        totalNs += std::chrono::duration<double, std::nano>(stop - start).count();
+    }
+    double ops = static_cast<double>(n * reps);
+    perf.label = benchCase.name;
+    perf.ops = n * reps;
+    return BenchResult{benchCase.name, n, n * reps, totalNs / ops, totalAllocs / ops, totalBytes / ops, perf};
+}
+
+static void writeJson(std::ostream& out, const std::vector<BenchResult>& results) {
+    out << "{\n  \"benchmarks\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        char line[512];
+        std::snprintf(line, sizeof(line),
+                      "    {\"name\": \"%s\", \"n\": %zu, \"ops\": %zu, \"ns_per_op\": %.3f, "
+                      "\"allocs_per_op\": %.3f, \"bytes_per_op\": %.3f",
+                      r.name.c_str(), r.n, r.ops, r.nsPerOp, r.allocsPerOp, r.bytesPerOp);
+        out << line;
+        for (std::size_t e = 0; e < PERF_EVENT_COUNT; ++e) {
+            if (r.perf.valid[e]) {
+                std::string key = perfEventName(static_cast<PerfEvent>(e));
+                for (char& c : key) c = c == '-' ? '_' : c;
+                std::snprintf(line, sizeof(line), ", \"%s_per_op\": %.3f", key.c_str(),
+                              r.perf.perOp(static_cast<PerfEvent>(e)));
+                out << line;
+            }
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+    std::size_t maxN = 1000000;
+    std::size_t minOps = 100000;
+    std::string jsonPath;
+    bool perf = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--perf") == 0) {
+            perf = true;
+        } else if (std::strcmp(argv[i], "--max-n") == 0 && i + 1 < argc) {
+            maxN = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--min-ops") == 0 && i + 1 < argc) {
+            minOps = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--max-n N] [--min-ops N] [--json FILE|-] [--perf]" << std::endl;
+            return 2;
+        }
+    }
+
+    // Allocations per op come from the global allocation tracker.
+    if (!AllocTracker::isInstalled()) {
+        std::fprintf(stderr, "note: built without -DRIDESHARE_TRACK_ALLOCATIONS; allocs/op will read 0\n");
+    }
+    AllocTracker::enable(true);
+
+    std::unique_ptr<PerfCounters> counters;
+    if (perf) {
+        counters = std::make_unique<PerfCounters>();
+        if (!counters->available()) {
+            std::fprintf(stderr, "note: hardware performance counters are unavailable here\n");
+        }
+    }
+
+    std::vector<BenchResult> results;
+    {
+        QuietCout quiet; // requestRide prints every ride; keep the table readable
+        for (const BenchCase& benchCase : buildCases()) {
+            for (std::size_t n = 1000; n <= maxN; n *= 10) {
+                results.push_back(runCase(benchCase, n, minOps, counters.get()));
+                const BenchResult& r = results.back();
+                if (jsonPath != "-") {
+                    std::fprintf(stderr, "%-28s n=%-9zu %10.2f ns/op %8.2f allocs/op %10.1f bytes/op\n",
+                                 r.name.c_str(), r.n, r.nsPerOp, r.allocsPerOp, r.bytesPerOp);
+                    if (counters != nullptr && counters->available()) {
+                        std::ostringstream perfLine;
+                        r.perf.print(perfLine);
+                        std::fprintf(stderr, "    %s", perfLine.str().c_str());
+                    }
+                }
+            }
+        }
+    }
+
+    if (jsonPath == "-") {
+        writeJson(std::cout, results);
+    } else if (!jsonPath.empty()) {
+        std::ofstream file(jsonPath);
+        if (!file) {
+            std::cerr << "cannot write " << jsonPath << std::endl;
+            return 1;
+        }
+        writeJson(file, results);
+    }
+    return 0;
+}
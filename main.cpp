@@ -4,157 +4,13 @@
 #include <vector>
 #include <string>
 #include <memory> // For std::unique_ptr
-#include <iomanip> // For std::fixed and std::setprecision
-
-// 1. Ride Class (Base Class)
-class Ride {
-protected:
-    std::string rideID;
-    std::string pickupLocation;
-    std::string dropoffLocation;
-    double distance; // in miles
-    double fare;
-
-public:
-    Ride(const std::string& id, const std::string& pickup, const std::string& dropoff, double dist)
-        : rideID(id), pickupLocation(pickup), dropoffLocation(dropoff), distance(dist), fare(0.0) {}
-
-    // Virtual destructor: Essential for correct polymorphic deletion
-    // Ensures that derived class destructors are called when
-    // a base class pointer (like unique_ptr<Ride>) deletes a derived object.
-    virtual ~Ride() {
-        // Optional: Add debug messages here if needed for tracking object destruction.
-        // For example: std::cout << "Ride destructor called for ID: " << rideID << std::endl;
-    }
-
-    // Virtual method for fare calculation - demonstrates polymorphism
-    virtual void calculateFare() = 0; // Pure virtual function, makes Ride an abstract class
-
-    // Method to display ride information
-    void rideDetails() const {
-        std::cout << "Ride ID: " << rideID << std::endl;
-        std::cout << "  Pickup: " << pickupLocation << std::endl;
-        std::cout << "  Dropoff: " << dropoffLocation << std::endl;
-        std::cout << "  Distance: " << std::fixed << std::setprecision(1) << distance << " miles" << std::endl;
-        std::cout << "  Fare: $" << std::fixed << std::setprecision(2) << fare << std::endl;
-    }
-
-    double getFare() const {
-        return fare;
-    }
-
-    std::string getRideID() const {
-        return rideID;
-    }
-};
 
-// 2. StandardRide subclass
-class StandardRide : public Ride {
-private:
-    static constexpr double RATE_PER_MILE = 2.0; // Example rate
-
-public:
-    StandardRide(const std::string& id, const std::string& pickup, const std::string& dropoff, double dist)
-        : Ride(id, pickup, dropoff, dist) {
-        calculateFare(); // Calculate fare upon construction
-    }
-
-    // Override calculateFare method
-    void calculateFare() override {
-        fare = distance * RATE_PER_MILE;
-    }
-    // No explicit destructor needed here unless it manages its own unique resources.
-    // The base class virtual destructor handles proper destruction.
-};
-
-// 3. PremiumRide subclass
-class PremiumRide : public Ride {
-private:
-    static constexpr double RATE_PER_MILE = 3.5; // Example premium rate
-    static constexpr double PREMIUM_SURCHARGE = 5.0; // Additional flat fee
-
-public:
-    PremiumRide(const std::string& id, const std::string& pickup, const std::string& dropoff, double dist)
-        : Ride(id, pickup, dropoff, dist) {
-        calculateFare(); // Calculate fare upon construction
-    }
-
-    // Override calculateFare method
-    void calculateFare() override {
-        fare = (distance * RATE_PER_MILE) + PREMIUM_SURCHARGE;
-    }
-};
-
-// 4. Driver Class
-class Driver {
-private:
-    std::string driverID;
-    std::string name;
-    double rating;
-    std::vector<std::unique_ptr<Ride>> assignedRides; // Encapsulated: private access
-
-public:
-    Driver(const std::string& id, const std::string& n, double r)
-        : driverID(id), name(n), rating(r) {}
-
-    // Method to add rides to the driver's list
-    // Takes ownership of the unique_ptr
-    void addRide(std::unique_ptr<Ride> ride) {
-        assignedRides.push_back(std::move(ride)); // Ownership transferred
-    }
-
-    // Method to display driver details
-    void getDriverInfo() const {
-        std::cout << "\n--- Driver Details ---" << std::endl;
-        std::cout << "Driver ID: " << driverID << std::endl;
-        std::cout << "Name: " << name << std::endl;
-        std::cout << "Rating: " << std::fixed << std::setprecision(1) << rating << "/5.0" << std::endl;
-        std::cout << "Completed Rides (" << assignedRides.size() << "):" << std::endl;
-        if (assignedRides.empty()) {
-            std::cout << "  No rides completed yet." << std::endl;
-        } else {
-            for (const auto& ride : assignedRides) {
-                // Polymorphic call: correct rideDetails (from Standard or Premium) is invoked
-                ride->rideDetails();
-                std::cout << "--------------------" << std::endl;
-            }
-        }
-    }
-};
-
-// 5. Rider Class
-class Rider {
-private:
-    std::string riderID;
-    std::string name;
-    std::vector<std::unique_ptr<Ride>> requestedRides; // Using unique_ptr for ownership
-
-public:
-    Rider(const std::string& id, const std::string& n)
-        : riderID(id), name(n) {}
-
-    // Method to request a ride
-    // Takes ownership of the unique_ptr
-    void requestRide(std::unique_ptr<Ride> ride) {
-        std::cout << "\n" << name << " requested a ride." << std::endl;
-        ride->rideDetails(); // Show requested ride details
-        requestedRides.push_back(std::move(ride)); // Ownership transferred
-    }
-
-    // Method to display ride history
-    void viewRides() const {
-        std::cout << "\n--- " << name << "'s Ride History ---" << std::endl;
-        if (requestedRides.empty()) {
-            std::cout << "  No rides requested yet." << std::endl;
-        } else {
-            for (const auto& ride : requestedRides) {
-                // Polymorphic call: correct rideDetails is invoked
-                ride->rideDetails();
-                std::cout << "--------------------" << std::endl;
-            }
-        }
-    }
-};
+#include "Ride.h"
+#include "Driver.h"
+#include "Rider.h"
+#include "RideTimeouts.h"
+#include "DriverPool.h"
+#include "ScheduledRideQueue.h"
 
 // 6. System Functionality (Demonstrates Polymorphism)
 void demonstrateSystemFunctionality() {
@@ -186,6 +42,20 @@ void demonstrateSystemFunctionality() {
     std::unique_ptr<Ride> completedRide2_driver = std::make_unique<PremiumRide>("P002-C", "Airport", "City Center", 25.0);
     std::unique_ptr<Ride> completedRide3_driver = std::make_unique<StandardRide>("S003-C", "Park", "Museum", 3.2);
 
+    // Walk each driver ride through its lifecycle before handing it over.
+    for (Ride* ride : {completedRide1_driver.get(), completedRide2_driver.get(), completedRide3_driver.get()}) {
+        ride->transitionTo(RideStatus::Matched);
+        ride->transitionTo(RideStatus::EnRoute);
+        ride->transitionTo(RideStatus::InProgress);
+        ride->transitionTo(RideStatus::Completed);
+    }
+
+    // Invalid transitions are rejected and leave the ride unchanged.
+    if (!completedRide1_driver->transitionTo(RideStatus::Cancelled)) {
+        std::cout << "\nCannot cancel ride " << completedRide1_driver->getRideID()
+                  << ": it is already " << rideStatusName(completedRide1_driver->getStatus()) << "." << std::endl;
+    }
+
     alice.addRide(std::move(completedRide1_driver));
     alice.addRide(std::move(completedRide2_driver));
     alice.addRide(std::move(completedRide3_driver));
@@ -197,6 +67,13 @@ void demonstrateSystemFunctionality() {
     // View rider's ride history
     sandesh.viewRides();
 
+    // Per-state counts come straight from the maintained counters, no history scan needed.
+    std::cout << "\n--- Rides by Status ---" << std::endl;
+    for (std::size_t i = 0; i < RIDE_STATUS_COUNT; ++i) {
+        RideStatus s = static_cast<RideStatus>(i);
+        std::cout << "  " << rideStatusName(s) << ": " << Ride::countInState(s) << std::endl;
+    }
+
     // Demonstrate polymorphism by storing different ride types in a generic collection
     std::cout << "\n--- Polymorphism Demonstration (List of All Rides in System) ---" << std::endl;
     std::vector<std::unique_ptr<Ride>> systemRides;
@@ -216,6 +93,70 @@ void demonstrateSystemFunctionality() {
         std::cout << "--------------------" << std::endl;
     }
 
+    // Pending rides are cancelled by the timer wheel when nobody picks them up in time.
+    std::cout << "\n--- Ride Timeouts ---" << std::endl;
+    TimestampMs clock = currentTimeMs();
+    RideTimeouts timeouts(clock);
+    timeouts.setExpiryHandler([](Ride& ride, TimeoutKind kind) {
+        std::cout << "Ride " << ride.getRideID() << " hit its " << timeoutKindName(kind)
+                  << " timeout and is now " << rideStatusName(ride.getStatus()) << "." << std::endl;
+    });
+    Rider priya("R002", "Priya Patel");
+    std::unique_ptr<Ride> lateRide = std::make_unique<StandardRide>("S004", "Station", "Harbor", 6.0, clock);
+    Ride* lateRidePtr = lateRide.get();
+    priya.requestRide(std::move(lateRide), timeouts, clock);
+    std::unique_ptr<Ride> quickRide = std::make_unique<PremiumRide>("P005", "Hotel", "Stadium", 8.0, clock);
+    Ride* quickRidePtr = quickRide.get();
+    priya.requestRide(std::move(quickRide), timeouts, clock);
+    std::cout << "Pending rides: " << timeouts.pendingCount() << std::endl;
+
+    // One ride gets a driver after 30 seconds; the driver arrives and the trip starts.
+    clock += 30 * 1000;
+    timeouts.tick(clock);
+    timeouts.advanceRide(*quickRidePtr, RideStatus::Matched, clock);
+    timeouts.advanceRide(*quickRidePtr, RideStatus::EnRoute, clock);
+    timeouts.advanceRide(*quickRidePtr, RideStatus::InProgress, clock + 60 * 1000);
+
+    // Three minutes later the other ride has passed its match deadline.
+    clock += 3 * 60 * 1000;
+    timeouts.tick(clock);
+    std::cout << "Ride " << lateRidePtr->getRideID() << " status: " << rideStatusName(lateRidePtr->getStatus()) << std::endl;
+    std::cout << "Pending rides: " << timeouts.pendingCount() << std::endl;
+
+    // Dispatch scans availability bitmaps instead of every Driver object.
+    std::cout << "\n--- Driver Availability ---" << std::endl;
+    enum Region : std::uint32_t { DOWNTOWN, AIRPORT, REGION_COUNT };
+    DriverPool pool(REGION_COUNT);
+    Driver bob("D002", "Bob Jones", 4.6);
+    Driver chen("D003", "Chen Wei", 4.9);
+    Driver dana("D004", "Dana Lee", 4.7);
+    for (Driver* d : {&alice, &bob, &chen, &dana}) {
+        DriverIndex index = pool.registerDriver(*d);
+        pool.setOnline(index, d != &dana); // Dana has not logged in yet
+        pool.moveToRegion(index, d == &chen ? AIRPORT : DOWNTOWN);
+    }
+    pool.setBusy(bob.getPoolIndex(), true); // Bob is already on a trip
+    std::cout << "Online: " << pool.onlineCount() << ", free: " << pool.freeCount()
+              << ", free downtown: " << pool.freeCountInRegion(DOWNTOWN) << std::endl;
+    std::vector<DriverIndex> candidates;
+    pool.findCandidates(DOWNTOWN, 5, candidates);
+    for (DriverIndex index : candidates) {
+        std::cout << "Downtown candidate: " << pool.driverAt(index).getName() << std::endl;
+    }
+
+    // Airport rides booked hours ahead wait in the calendar queue until pickup approaches.
+    std::cout << "\n--- Scheduled Rides ---" << std::endl;
+    TimestampMs bookingTime = currentTimeMs();
+    ScheduledRideQueue scheduled(bookingTime);
+    sandesh.scheduleRide(std::make_unique<PremiumRide>("P006", "Airport", "City Center", 25.0, bookingTime),
+                         bookingTime + 3 * 60 * 60 * 1000, scheduled, bookingTime);
+    std::size_t released = scheduled.releaseDue(bookingTime + 60 * 60 * 1000, [](Ride&, TimestampMs) {});
+    std::cout << "Released after 1 hour: " << released << " (outstanding: " << scheduled.size() << ")" << std::endl;
+    scheduled.releaseDue(bookingTime + 3 * 60 * 60 * 1000, [bookingTime](Ride& ride, TimestampMs pickupAt) {
+        std::cout << "Released " << ride.getRideID() << " for pickup at +" << (pickupAt - bookingTime) / (60 * 1000)
+                  << " min; status is now " << rideStatusName(ride.getStatus()) << "." << std::endl;
+    });
+
     std::cout << "\n--- Demonstration Complete ---" << std::endl;
 }
 
@@ -0,0 +1,34 @@
+#!/usr/bin/env sh
+# pgo_build.sh - Build an LTO + profile-guided optimised tree in one go.
+#
+#   1. configure with RIDESHARE_PGO=GENERATE and build instrumented binaries
+#   2. run the pgo-train target (synthetic load generator + demo) to record profiles
+#   3. reconfigure the same build directory with RIDESHARE_PGO=USE and rebuild
+#
+# GCC keys profiles by object path, so both phases must share a build
+# directory. Usage: scripts/pgo_build.sh [build-dir]   (default: build-pgo)
+
+set -eu
+
+SOURCE_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_DIR=${1:-build-pgo}
+mkdir -p "$BUILD_DIR"
+PROFILE_DIR="$(cd "$BUILD_DIR" && pwd)/pgo-profiles"
+JOBS=$(nproc 2>/dev/null || echo 2)
+
+rm -rf "$PROFILE_DIR"
+
+cmake -S "$SOURCE_DIR" -B "$BUILD_DIR" -DCMAKE_BUILD_TYPE=Release \
+      -DRIDESHARE_PGO=GENERATE -DRIDESHARE_PGO_DIR="$PROFILE_DIR"
+cmake --build "$BUILD_DIR" -j"$JOBS"
+cmake --build "$BUILD_DIR" --target pgo-train
+
+# Clang writes raw profiles that must be merged before use.
+if ls "$PROFILE_DIR"/*.profraw >/dev/null 2>&1; then
+    llvm-profdata merge -output="$PROFILE_DIR/merged.profdata" "$PROFILE_DIR"/*.profraw
+fi
+
+cmake -S "$SOURCE_DIR" -B "$BUILD_DIR" -DRIDESHARE_PGO=USE
+cmake --build "$BUILD_DIR" -j"$JOBS" --clean-first
+
+echo "PGO build ready in $BUILD_DIR"
@@ -0,0 +1,29 @@
+// TestCheck.h - Check helper shared by the tests in this directory
+
+#pragma once
+
+#include <iostream>
+
+// Failed checks so far in this test binary.
+inline int& testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+// Record a failed expectation and keep going, so one run reports them all.
+inline void check(bool ok, const char* what) {
+    if (!ok) {
+        std::cerr << "FAIL: " << what << std::endl;
+        ++testFailures();
+    }
+}
+
+// Exit status for main(): 0 when every check passed.
+inline int testResult(const char* name) {
+    if (testFailures() != 0) {
+        std::cerr << name << ": " << testFailures() << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << name << ": all checks passed" << std::endl;
+    return 0;
+}
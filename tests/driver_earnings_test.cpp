@@ -0,0 +1,118 @@
+// driver_earnings_test.cpp - DriverEarnings totals and the per-day window
+//
+// Run through ctest, or directly: ./driver_earnings_test (exit status 0 = pass).
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "Driver.h"
+#include "TestCheck.h"
+
+static bool near(double a, double b) {
+    return std::fabs(a - b) < 1e-6;
+}
+
+static std::unique_ptr<Ride> completedRide(int n, RideType type, double distance, TimestampMs requestedAt,
+                                           TimestampMs completedAt) {
+    std::unique_ptr<Ride> ride;
+    if (type == RideType::Premium) {
+        ride = std::make_unique<PremiumRide>("P" + std::to_string(n), "Park", "Mall", distance, requestedAt);
+    } else {
+        ride = std::make_unique<StandardRide>("S" + std::to_string(n), "Park", "Mall", distance, requestedAt);
+    }
+    if (completedAt != 0) {
+        ride->transitionTo(RideStatus::Matched, requestedAt);
+        ride->transitionTo(RideStatus::EnRoute, requestedAt);
+        ride->transitionTo(RideStatus::InProgress, requestedAt);
+        ride->transitionTo(RideStatus::Completed, completedAt);
+    }
+    return ride;
+}
+
+// Totals, tier splits and day buckets match sums kept by hand, with rides
+// arriving out of order across more days than the window holds.
+static void totalsMatchExactSums() {
+    DriverEarnings earnings;
+    check(earnings.averageFare() == 0.0 && earnings.onDay(3).rides == 0, "no rides: empty aggregates");
+
+    std::mt19937 rng(21);
+    std::map<std::int64_t, double> dayFare;
+    std::map<std::int64_t, std::uint64_t> dayRides;
+    double fare = 0.0;
+    double distance = 0.0;
+    double premiumFare = 0.0;
+    std::uint64_t premiumRides = 0;
+    const std::int64_t LAST_DAY = 40;
+    for (int i = 0; i < 2000; ++i) {
+        RideType type = rng() % 3 == 0 ? RideType::Premium : RideType::Standard;
+        std::int64_t day = (i * LAST_DAY) / 2000 - static_cast<std::int64_t>(rng() % 2); // mostly ascending
+        TimestampMs requestedAt = day * MS_PER_DAY + static_cast<TimestampMs>(rng() % MS_PER_DAY);
+        bool completes = rng() % 4 != 0;
+        TimestampMs completedAt = completes ? requestedAt + 30 * 60 * 1000 : 0; // may cross midnight
+        std::unique_ptr<Ride> ride = completedRide(i, type, 1.0 + rng() % 200 / 10.0, requestedAt, completedAt);
+        std::int64_t countedDay = dayOf(completes ? completedAt : requestedAt);
+        fare += ride->getFare();
+        distance += ride->getDistance();
+        if (type == RideType::Premium) {
+            premiumFare += ride->getFare();
+            ++premiumRides;
+        }
+        dayFare[countedDay] += ride->getFare();
+        ++dayRides[countedDay];
+        earnings.add(*ride);
+    }
+    check(earnings.rides() == 2000 && near(earnings.fare(), fare) && near(earnings.distance(), distance),
+          "totals count every ride");
+    check(earnings.rides(RideType::Premium) == premiumRides && near(earnings.fare(RideType::Premium), premiumFare) &&
+              earnings.rides(RideType::Standard) == 2000 - premiumRides,
+          "tier totals split the rides");
+    check(near(earnings.averageFare(), fare / 2000), "average fare");
+
+    bool recent = true;
+    for (std::int64_t day = LAST_DAY - static_cast<std::int64_t>(DriverEarnings::DAYS_KEPT) + 1; day <= LAST_DAY;
+         ++day) {
+        DayEarnings bucket = earnings.onDay(day);
+        recent = bucket.rides == dayRides[day] && near(bucket.fare, dayFare[day]) && recent;
+    }
+    check(recent, "each recent day matches its rides (by completion, else request)");
+    check(earnings.onDay(2).rides == 0 && earnings.onDay(LAST_DAY + 1).rides == 0,
+          "days outside the window are empty");
+}
+
+// A late ride for a day already pushed out of the window only counts in
+// the totals; it does not clobber the newer day sharing its slot.
+static void lateRideKeepsNewerDay() {
+    DriverEarnings earnings;
+    const std::int64_t NEW_DAY = 100;
+    const std::int64_t OLD_DAY = NEW_DAY - static_cast<std::int64_t>(DriverEarnings::DAYS_KEPT);
+    earnings.add(*completedRide(1, RideType::Standard, 5.0, NEW_DAY * MS_PER_DAY, 0));
+    earnings.add(*completedRide(2, RideType::Standard, 7.0, OLD_DAY * MS_PER_DAY, 0));
+    check(earnings.onDay(NEW_DAY).rides == 1, "the newer day keeps its slot");
+    check(earnings.onDay(OLD_DAY).rides == 0 && earnings.rides() == 2, "the late ride counts in the totals only");
+}
+
+// Drivers keep earnings over every assigned ride, including folded ones.
+static void driverCountsFoldedRides() {
+    Driver driver("D1", "Bob", 4.5);
+    RideHistoryPolicy policy;
+    policy.recentRides = 2;
+    driver.setHistoryPolicy(policy);
+    double fare = 0.0;
+    for (int i = 0; i < 10; ++i) {
+        std::unique_ptr<Ride> ride = completedRide(i, RideType::Standard, 3.0 + i, 1000 * i, 1000 * i + 500);
+        fare += ride->getFare();
+        driver.addRide(std::move(ride));
+    }
+    check(driver.getEarnings().rides() == 10 && near(driver.getEarnings().fare(), fare),
+          "earnings include rides folded out of the history");
+}
+
+int main() {
+    totalsMatchExactSums();
+    lateRideKeepsNewerDay();
+    driverCountsFoldedRides();
+    return testResult("driver_earnings_test");
+}
@@ -0,0 +1,116 @@
+// driver_pool_test.cpp - DriverPool bitmaps against a per-driver model
+//
+// Build:  g++ -O2 -std=c++17 -I. tests/driver_pool_test.cpp -o driver_pool_test
+// Run through ctest, or directly: ./driver_pool_test (exit status 0 = pass).
+
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DriverPool.h"
+#include "TestCheck.h"
+
+struct DriverModel {
+    bool online = false;
+    bool busy = false;
+    std::uint32_t region = DriverPool::NO_REGION;
+};
+
+// Every query the pool answers from its bitmaps, recomputed by walking the
+// model one driver at a time.
+static bool poolMatchesModel(const DriverPool& pool, const std::vector<DriverModel>& model, std::uint32_t regions) {
+    std::size_t online = 0;
+    std::size_t free = 0;
+    for (DriverIndex d = 0; d < model.size(); ++d) {
+        bool isFree = model[d].online && !model[d].busy;
+        online += model[d].online;
+        free += isFree;
+        if (pool.isOnline(d) != model[d].online || pool.isBusy(d) != model[d].busy || pool.isFree(d) != isFree) {
+            return false;
+        }
+        DriverIndex next = d;
+        while (next < model.size() && !(model[next].online && !model[next].busy)) {
+            ++next;
+        }
+        if (pool.findNextFree(d) != (next == model.size() ? INVALID_DRIVER_INDEX : next)) {
+            return false;
+        }
+    }
+    if (pool.onlineCount() != online || pool.freeCount() != free) {
+        return false;
+    }
+    std::vector<DriverIndex> candidates;
+    for (std::uint32_t r = 0; r < regions; ++r) {
+        std::vector<DriverIndex> expected;
+        for (DriverIndex d = 0; d < model.size(); ++d) {
+            if (model[d].region == r && model[d].online && !model[d].busy) {
+                expected.push_back(d);
+            }
+        }
+        if (pool.freeCountInRegion(r) != expected.size()) {
+            return false;
+        }
+        pool.findCandidates(r, model.size(), candidates);
+        if (candidates != expected) {
+            return false;
+        }
+        std::size_t limit = expected.size() / 2;
+        pool.findCandidates(r, limit, candidates);
+        if (candidates != std::vector<DriverIndex>(expected.begin(), expected.begin() + limit)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Random logins, trips and moves over 300 drivers (several 64-bit words
+// and a partial last word).
+static void randomChangesMatchModel() {
+    const std::uint32_t REGIONS = 5;
+    std::vector<std::unique_ptr<Driver>> drivers;
+    DriverPool pool(REGIONS);
+    std::vector<DriverModel> model(300);
+    for (std::size_t i = 0; i < model.size(); ++i) {
+        drivers.push_back(std::make_unique<Driver>("D" + std::to_string(i), "Driver", 4.5));
+        check(pool.registerDriver(*drivers.back()) == i, "indices are dense");
+    }
+    check(poolMatchesModel(pool, model, REGIONS), "new drivers are offline and in no region");
+
+    std::mt19937 rng(7);
+    bool ok = true;
+    for (int step = 0; step < 3000 && ok; ++step) {
+        DriverIndex d = rng() % model.size();
+        switch (rng() % 3) {
+            case 0: model[d].online = !model[d].online; pool.setOnline(d, model[d].online); break;
+            case 1: model[d].busy = !model[d].busy; pool.setBusy(d, model[d].busy); break;
+            case 2: model[d].region = rng() % REGIONS; pool.moveToRegion(d, model[d].region); break;
+        }
+        if (step % 100 == 0) {
+            ok = poolMatchesModel(pool, model, REGIONS);
+        }
+    }
+    check(ok && poolMatchesModel(pool, model, REGIONS), "bitmaps match the model after random changes");
+}
+
+// A driver who goes offline mid-trip is not free when they log back in.
+static void busyDriverReturningStaysBusy() {
+    Driver driver("D1", "Driver", 4.5);
+    DriverPool pool;
+    DriverIndex d = pool.registerDriver(driver);
+    pool.moveToRegion(d, 0);
+    pool.setOnline(d, true);
+    pool.setBusy(d, true);
+    pool.setOnline(d, false);
+    pool.setOnline(d, true);
+    check(!pool.isFree(d) && pool.freeCount() == 0, "back online but still on the trip");
+    pool.setBusy(d, false);
+    check(pool.isFree(d) && pool.findNextFree() == d, "free once the trip ends");
+}
+
+int main() {
+    randomChangesMatchModel();
+    busyDriverReturningStaysBusy();
+    return testResult("driver_pool_test");
+}
@@ -0,0 +1,98 @@
+// driver_ratings_test.cpp - DriverRatings statistics, including concurrent submits
+//
+// Run through ctest, or directly: ./driver_ratings_test (exit status 0 = pass).
+
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Driver.h"
+#include "TestCheck.h"
+
+static bool near(double a, double b, double tolerance = 1e-9) {
+    return std::fabs(a - b) < tolerance;
+}
+
+// Count, mean and variance match a two-pass computation over the same
+// ratings; out-of-range stars are refused.
+static void statisticsMatchExactValues() {
+    DriverRatings ratings(4.2);
+    check(ratings.count() == 0 && near(ratings.mean(), 4.2) && near(ratings.lastRatingsAverage(), 4.2),
+          "the initial rating stands in before any arrive");
+    check(!ratings.submit(0) && !ratings.submit(6) && ratings.count() == 0, "out-of-range stars are refused");
+    check(ratings.submit(3) && near(ratings.variance(), 0.0), "one rating has no variance");
+
+    std::mt19937 rng(4);
+    std::vector<int> given = {3};
+    for (int i = 0; i < 5000; ++i) {
+        int stars = 1 + static_cast<int>(rng() % 5);
+        stars = stars < 3 && rng() % 2 ? 5 : stars; // skewed towards 5
+        ratings.submit(stars);
+        given.push_back(stars);
+    }
+    double sum = 0.0;
+    for (int stars : given) {
+        sum += stars;
+    }
+    double mean = sum / static_cast<double>(given.size());
+    double squares = 0.0;
+    for (int stars : given) {
+        squares += (stars - mean) * (stars - mean);
+    }
+    check(ratings.count() == given.size(), "count");
+    check(near(ratings.mean(), mean), "mean");
+    check(near(ratings.variance(), squares / static_cast<double>(given.size()), 1e-9), "population variance");
+    std::uint64_t fives = 0;
+    for (int stars : given) {
+        fives += stars == 5;
+    }
+    check(ratings.count(5) == fives && ratings.count(9) == 0, "per-star counts");
+}
+
+// The last-ratings average follows recent ratings: after a long run of one
+// value it sits near that value whatever came before.
+static void lastRatingsFollowRecentRatings() {
+    DriverRatings ratings(5.0);
+    for (int i = 0; i < 500; ++i) {
+        ratings.submit(5);
+    }
+    for (int i = 0; i < 100; ++i) {
+        ratings.submit(1);
+    }
+    check(ratings.lastRatingsAverage() < 1.05, "recent ratings dominate the last-ratings average");
+    check(ratings.mean() > 4.0, "the mean keeps the whole history");
+    double before = ratings.lastRatingsAverage();
+    ratings.submit(5);
+    check(near(ratings.lastRatingsAverage(), before + DriverRatings::LAST_RATINGS_WEIGHT * (5 - before)),
+          "each rating moves the average by its weight");
+}
+
+// Submissions from many threads are all counted, and the lock-free average
+// stays within the range of the ratings given.
+static void concurrentSubmitsAreCounted() {
+    Driver driver("D1", "Bob", 3.0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&driver, t] {
+            for (int i = 0; i < 20000; ++i) {
+                driver.rate(t % 2 == 0 ? 4 : 5);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const DriverRatings& ratings = driver.getRatings();
+    check(ratings.count() == 80000 && ratings.count(4) == 40000, "no concurrent rating is lost");
+    check(near(ratings.mean(), 4.5), "the mean of concurrent ratings is exact");
+    check(ratings.lastRatingsAverage() >= 4.0 && ratings.lastRatingsAverage() <= 5.0,
+          "the last-ratings average stays within the given ratings");
+}
+
+int main() {
+    statisticsMatchExactValues();
+    lastRatingsFollowRecentRatings();
+    concurrentSubmitsAreCounted();
+    return testResult("driver_ratings_test");
+}
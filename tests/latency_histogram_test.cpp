@@ -0,0 +1,93 @@
+// latency_histogram_test.cpp - LatencyHistogram buckets, percentiles and per-thread merging
+//
+// Build:  g++ -O2 -std=c++17 -pthread -I. tests/latency_histogram_test.cpp -o latency_histogram_test
+// Run through ctest, or directly: ./latency_histogram_test (exit status 0 = pass).
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "LatencyHistogram.h"
+#include "TestCheck.h"
+
+// Every value lands in a bucket whose upper bound covers it within the
+// advertised 1/64 relative error, and buckets are monotonic.
+static void bucketsBoundValues() {
+    bool covered = true;
+    bool tight = true;
+    bool monotonic = true;
+    std::size_t previous = 0;
+    for (std::uint64_t value = 0; value < (std::uint64_t(1) << 41); value = value < 4096 ? value + 1 : value + value / 97) {
+        std::size_t bucket = LatencyHistogram::bucketOf(value);
+        std::uint64_t bound = LatencyHistogram::bucketUpperBound(bucket);
+        covered = covered && bound >= value;
+        tight = tight && bound - value <= value / 64;
+        monotonic = monotonic && bucket >= previous;
+        previous = bucket;
+    }
+    check(covered, "a bucket's upper bound covers its values");
+    check(tight, "bucket width stays within 1/64 of the value");
+    check(monotonic, "buckets grow with the value");
+    check(LatencyHistogram::bucketOf(100) == 100, "small values are exact");
+}
+
+// Percentiles match the exact order statistics to within one bucket.
+static void percentilesTrackExactRanks() {
+    LatencyHistogram histogram;
+    std::mt19937_64 rng(3);
+    std::vector<std::uint64_t> values;
+    for (int i = 0; i < 100000; ++i) {
+        std::uint64_t value = 200 + rng() % (rng() % 10 == 0 ? 5000000 : 20000); // long tail
+        values.push_back(value);
+        histogram.record(value);
+    }
+    std::sort(values.begin(), values.end());
+    bool close = true;
+    for (double q : {0.0, 0.5, 0.9, 0.99, 0.999, 1.0}) {
+        std::uint64_t exact = values[static_cast<std::size_t>(q * static_cast<double>(values.size() - 1))];
+        std::uint64_t reported = histogram.percentile(q);
+        close = close && reported >= exact && reported - exact <= exact / 64;
+    }
+    check(close, "percentiles are within one bucket above the exact rank");
+    check(histogram.count() == values.size(), "count matches");
+    check(histogram.max() == values.back() && histogram.percentile(1.0) == values.back(),
+          "max is exact and caps p100");
+    check(LatencyHistogram().percentile(0.5) == 0, "an empty histogram reports 0");
+}
+
+// Recorders keep one histogram per thread; the snapshot sees them all.
+static void recorderMergesThreads() {
+    static LatencyRecorder recorder("test");
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < 1000; ++i) {
+                recorder.record(static_cast<std::uint64_t>(1000 * (t + 1)));
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    std::unique_ptr<LatencyHistogram> merged = recorder.snapshot();
+    check(merged->count() == 4000, "the snapshot merges every thread's samples");
+    check(merged->max() == 4000, "the snapshot keeps the overall max");
+    std::uint64_t median = merged->percentile(0.5);
+    check(median >= 2000 && median <= 2000 + 2000 / 64, "the merged median sits in the second thread's samples");
+
+    LatencyRecorder::setEnabled(false);
+    { ScopedLatency timer(recorder); }
+    check(recorder.snapshot()->count() == 4000, "a disabled scope records nothing");
+    LatencyRecorder::setEnabled(true);
+    { ScopedLatency timer(recorder); }
+    check(recorder.snapshot()->count() == 4001, "an enabled scope records once");
+    LatencyRecorder::setEnabled(false);
+}
+
+int main() {
+    bucketsBoundValues();
+    percentilesTrackExactRanks();
+    recorderMergesThreads();
+    return testResult("latency_histogram_test");
+}
@@ -0,0 +1,107 @@
+// leaderboard_test.cpp - Leaderboard ranking and per-region daily boards
+//
+// Run through ctest, or directly: ./leaderboard_test (exit status 0 = pass).
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Leaderboard.h"
+#include "TestCheck.h"
+
+static std::vector<std::uint32_t> topOf(const Leaderboard<double>& board, std::size_t k) {
+    std::vector<std::uint32_t> out;
+    board.top(k, out);
+    return out;
+}
+
+// Rescoring moves a member to its new rank; ties go to the lower index.
+static void rankFollowsScoreUpdates() {
+    Leaderboard<double> board;
+    std::vector<double> scores = {10.0, 30.0, 20.0, 20.0};
+    for (std::uint32_t m = 0; m < scores.size(); ++m) {
+        board.insert(m, scores[m]);
+    }
+    check(topOf(board, 4) == std::vector<std::uint32_t>{1, 2, 3, 0}, "ranked best first, ties by index");
+    check(topOf(board, 2) == std::vector<std::uint32_t>{1, 2}, "top k stops at k");
+
+    board.rescore(0, scores[0], 35.0);
+    scores[0] = 35.0;
+    check(topOf(board, 4) == std::vector<std::uint32_t>{0, 1, 2, 3}, "a raised score moves to the top");
+    board.rescore(2, scores[2], 5.0);
+    scores[2] = 5.0;
+    check(topOf(board, 4) == std::vector<std::uint32_t>{0, 1, 3, 2}, "a lowered score moves down");
+    check(board.size() == 4, "rescoring keeps one entry per member");
+
+    board.erase(1, scores[1]);
+    check(topOf(board, 4) == std::vector<std::uint32_t>{0, 3, 2}, "erased member leaves the board");
+}
+
+static std::unique_ptr<Ride> completedRide(const std::string& id, double distance, TimestampMs at) {
+    auto ride = std::make_unique<StandardRide>(id, "Park", "Mall", distance, at);
+    ride->transitionTo(RideStatus::Matched, at);
+    ride->transitionTo(RideStatus::EnRoute, at);
+    ride->transitionTo(RideStatus::InProgress, at);
+    ride->transitionTo(RideStatus::Completed, at);
+    return ride;
+}
+
+template <typename Top>
+static std::vector<DriverIndex> listed(Top&& top) {
+    std::vector<DriverIndex> out;
+    top([&out](DriverIndex d, double) { out.push_back(d); });
+    return out;
+}
+
+// Earnings boards rank today's drivers; after midnight, drivers without a
+// ride on the new day drop out of that day's listing until they drive.
+static void dailyBoardsRollOver() {
+    const TimestampMs DAY = 24LL * 60 * 60 * 1000;
+    const TimestampMs START = 20000 * DAY + 8LL * 60 * 60 * 1000; // 08:00 on some day
+    std::vector<std::unique_ptr<Driver>> drivers;
+    for (int i = 0; i < 3; ++i) {
+        drivers.push_back(std::make_unique<Driver>("D" + std::to_string(i), "Driver " + std::to_string(i), 4.0 + i / 10.0));
+    }
+    DriverLeaderboards boards(2);
+    for (DriverIndex d = 0; d < drivers.size(); ++d) {
+        boards.update(d, 0, *drivers[d], START);
+    }
+    std::int64_t today = dayOf(START);
+    check(listed([&](auto visit) { boards.topByEarnings(0, today, 3, visit); }).empty(), "no rides, no earners");
+
+    drivers[0]->addRide(completedRide("A", 5.0, START + 1000));
+    boards.update(0, 0, *drivers[0], START + 1000);
+    drivers[1]->addRide(completedRide("B", 12.0, START + 2000));
+    boards.update(1, 0, *drivers[1], START + 2000);
+    check(listed([&](auto visit) { boards.topByEarnings(0, today, 3, visit); }) == std::vector<DriverIndex>{1, 0},
+          "earners ranked by fare");
+    check(listed([&](auto visit) { boards.topByRating(0, 3, visit); }) == std::vector<DriverIndex>{2, 1, 0},
+          "everyone ranked by rating");
+
+    drivers[0]->addRide(completedRide("C", 9.0, START + 3000));
+    boards.update(0, 0, *drivers[0], START + 3000);
+    check(listed([&](auto visit) { boards.topByEarnings(0, today, 3, visit); }) == std::vector<DriverIndex>{0, 1},
+          "a second ride lifts the driver's rank");
+    check(listed([&](auto visit) { boards.topByRides(0, today, 1, visit); }) == std::vector<DriverIndex>{0},
+          "most rides today");
+
+    TimestampMs tomorrow = START + DAY;
+    drivers[2]->addRide(completedRide("D", 1.0, tomorrow));
+    boards.update(2, 0, *drivers[2], tomorrow);
+    check(listed([&](auto visit) { boards.topByEarnings(0, today + 1, 3, visit); }) == std::vector<DriverIndex>{2},
+          "after midnight only the new day's earners are listed");
+    check(listed([&](auto visit) { boards.topByRides(0, today + 1, 3, visit); }) == std::vector<DriverIndex>{2},
+          "the rides board rolls over too");
+
+    boards.update(1, 1, *drivers[1], tomorrow);
+    check(boards.driversIn(0) == 2 && boards.driversIn(1) == 1, "a driver moves between regions");
+    check(listed([&](auto visit) { boards.topByEarnings(1, today + 1, 3, visit); }).empty(),
+          "a re-ranked driver with no rides today is not an earner");
+}
+
+int main() {
+    rankFollowsScoreUpdates();
+    dailyBoardsRollOver();
+    return testResult("leaderboard_test");
+}
@@ -0,0 +1,124 @@
+// metrics_test.cpp - Metric counters, gauges and the Prometheus exposition
+//
+// Run through ctest, or directly: ./metrics_test (exit status 0 = pass).
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Metrics.h"
+#include "MetricsServer.h"
+#include "TestCheck.h"
+
+static std::string scrape() {
+    std::ostringstream text;
+    MetricsRegistry::writePrometheus(text);
+    return text.str();
+}
+
+static std::size_t occurrences(const std::string& text, const std::string& what) {
+    std::size_t count = 0;
+    for (std::size_t at = text.find(what); at != std::string::npos; at = text.find(what, at + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+// Per-thread cells add up to the exact total.
+static void countersSumEveryThread() {
+    MetricCounter counter("test_events_total", "Events counted by the test.");
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&counter] {
+            for (int i = 0; i < 10000; ++i) {
+                counter.increment();
+            }
+            counter.add(0.5);
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    check(counter.value() == 40002.0, "the counter sums every thread's cell");
+    check(scrape().find("test_events_total 40002\n") != std::string::npos, "the scrape shows the total");
+}
+
+// Each family gets one HELP/TYPE header, gauges of one family registered
+// apart are emitted together, and metrics leave the scrape with their owners.
+static void expositionGroupsFamilies() {
+    {
+        MetricCounter standard("test_rides_total", "Rides by type.", "type=\"standard\"");
+        MetricCounter premium("test_rides_total", "Rides by type.", "type=\"premium\"");
+        ScopedGauge zoneA("test_free_drivers", "Free drivers by zone.", "zone=\"a\"");
+        ScopedGauge queueA("test_queue_depth", "Queue depth by zone.", "zone=\"a\"");
+        ScopedGauge zoneB("test_free_drivers", "Free drivers by zone.", "zone=\"b\"");
+        standard.add(3);
+        zoneA.set(7);
+        zoneB.set(2.5);
+        std::string text = scrape();
+        check(occurrences(text, "# TYPE test_rides_total counter\n") == 1 &&
+                  occurrences(text, "# HELP test_rides_total Rides by type.\n") == 1,
+              "a counter family has one header");
+        check(text.find("test_rides_total{type=\"standard\"} 3\n") != std::string::npos &&
+                  text.find("test_rides_total{type=\"premium\"} 0\n") != std::string::npos,
+              "labelled samples carry their values");
+        check(occurrences(text, "# TYPE test_free_drivers gauge\n") == 1, "a gauge family has one header");
+        std::size_t a = text.find("test_free_drivers{zone=\"a\"} 7\n");
+        std::size_t b = text.find("test_free_drivers{zone=\"b\"} 2.5\n");
+        std::size_t queue = text.find("test_queue_depth{zone=\"a\"}");
+        check(a != std::string::npos && b != std::string::npos && queue != std::string::npos && a < b && b < queue,
+              "gauges of a family registered apart are emitted together");
+        check(text.find("rideshare_live_rides{status=\"Requested\"}") != std::string::npos,
+              "live ride counts are exported");
+    }
+    std::string text = scrape();
+    check(text.find("test_rides_total") == std::string::npos && text.find("test_free_drivers") == std::string::npos,
+          "destroyed counters and gauges leave the scrape");
+}
+
+// The endpoint serves the same text over HTTP. Skipped where loopback
+// sockets are unavailable.
+static void endpointServesMetrics() {
+#ifdef RIDESHARE_HAVE_METRICS_SERVER
+    MetricsServer server;
+    if (!server.start(0)) {
+        std::cout << "metrics_test: no loopback socket, endpoint check skipped" << std::endl;
+        return;
+    }
+    auto get = [&server](const std::string& request) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(server.port());
+        std::string response;
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+            ::send(fd, request.data(), request.size(), 0);
+            char chunk[4096];
+            ssize_t n;
+            while ((n = ::recv(fd, chunk, sizeof(chunk), 0)) > 0) {
+                response.append(chunk, static_cast<std::size_t>(n));
+            }
+        }
+        ::close(fd);
+        return response;
+    };
+    MetricCounter counter("test_scraped_total", "Counted before the scrape.");
+    counter.add(12);
+    std::string ok = get("GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    check(ok.compare(0, 15, "HTTP/1.1 200 OK") == 0 && ok.find("test_scraped_total 12\n") != std::string::npos,
+          "GET /metrics serves the exposition");
+    check(get("GET / HTTP/1.1\r\n\r\n").compare(0, 12, "HTTP/1.1 404") == 0, "other paths are not found");
+    check(get("POST /metrics HTTP/1.1\r\n\r\n").compare(0, 12, "HTTP/1.1 405") == 0, "other methods are refused");
+    server.stop();
+#endif
+}
+
+int main() {
+    countersSumEveryThread();
+    expositionGroupsFamilies();
+    endpointServesMetrics();
+    return testResult("metrics_test");
+}
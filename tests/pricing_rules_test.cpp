@@ -0,0 +1,166 @@
+// pricing_rules_test.cpp - Rule file parsing and compiled fare tables
+//
+// Run through ctest, or directly: ./pricing_rules_test (exit status 0 = pass).
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "PricingRules.h"
+#include "RideEngine.h"
+#include "QuietOutput.h"
+#include "TestCheck.h"
+
+static const TimestampMs HOUR = 60 * 60 * 1000;
+
+static bool near(double a, double b) {
+    return std::fabs(a - b) < 1e-9;
+}
+
+static bool compile(const std::string& text, PricingTable& table) {
+    PricingRuleSet rules;
+    std::string error;
+    if (!rules.parse(text, error)) {
+        return false;
+    }
+    table = PricingTable(rules);
+    return true;
+}
+
+// Malformed rules are refused with the number of the offending line, and
+// leave no rules behind.
+static void parseErrorsNameTheLine() {
+    const char* BAD[][2] = {
+        {"tier standard rate 2.0\ntier economy rate 1.0\n", "line 2: "},
+        {"# comment\n\ntime 7:00-10:00 multiplier 1.2\n", "line 3: "},
+        {"time 07:00-24:30 multiplier 1.2\n", "line 1: "},
+        {"time 24:00-02:00 multiplier 1.2\n", "line 1: "},
+        {"zone Downtown multiplier\n", "line 1: "},
+        {"zone Downtown surcharge 2\n", "line 1: unknown option 'surcharge'"},
+        {"zone \"City Center multiplier 1.1\n", "line 1: unterminated quote"},
+        {"tier premium rate -3\n", "line 1: bad number for rate"},
+        {"time 07:00-10:00 multiplier 1.2 tier gold\n", "line 1: unknown tier 'gold'"},
+        {"airport\n", "line 1: expected a location name"},
+        {"tier standard rate 2\nsurge Downtown 2\n", "line 2: unknown rule 'surge'"},
+    };
+    bool named = true;
+    bool cleared = true;
+    for (const auto& bad : BAD) {
+        PricingRuleSet rules;
+        std::string error;
+        named = !rules.parse(bad[0], error) && error.compare(0, std::strlen(bad[1]), bad[1]) == 0 && named;
+        cleared = rules.getTimeRules().empty() && rules.getZoneRules().empty() &&
+                  rules.getTiers()[0].rate == StandardFare::RATE_PER_MILE && cleared;
+        if (!named) {
+            std::cerr << "  for rule text: " << bad[0] << "  got: " << error << std::endl;
+            break;
+        }
+    }
+    check(named, "parse errors name the offending line and reason");
+    check(cleared, "a failed parse leaves the built-in prices and no rules");
+
+    PricingRuleSet rules;
+    std::string error;
+    check(rules.parse("# only comments\n\n   \t\n", error) && rules.getTimeRules().empty(),
+          "blank lines and comments parse to no rules");
+    check(!rules.load("/nonexistent/pricing.rules", error) && error.find("cannot read") == 0,
+          "a missing file is reported");
+}
+
+// With no rules the table reproduces the tiers' compiled-in fares.
+static void emptyRulesMatchBuiltInFares() {
+    PricingTable table;
+    bool same = true;
+    for (double distance = 0.0; distance < 60.0; distance += 0.37) {
+        for (RideType type : {RideType::Standard, RideType::Premium}) {
+            same = near(table.fare(type, "Anywhere", "Elsewhere", distance, 5 * HOUR), fareFor(type, distance)) && same;
+        }
+    }
+    check(same, "an empty rule set prices like the built-in fare policies");
+}
+
+// Overlapping and repeated rules multiply or add; tier-specific time rules
+// touch only their tier; the minimum applies before the fees.
+static void rulesCombine() {
+    PricingTable table;
+    check(compile("tier standard rate 2 base 1 minimum 10\n"
+                  "tier premium rate 4 base 0 minimum 0\n"
+                  "time 08:00-10:00 multiplier 1.5\n"
+                  "time 09:00-11:00 multiplier 2\n"
+                  "time 09:30-09:45 multiplier 3 tier premium\n"
+                  "zone Downtown multiplier 1.1\n"
+                  "zone Downtown multiplier 1.2 pickup-fee 1\n"
+                  "airport Airport fee 4\n"
+                  "zone Airport dropoff-fee 0.5\n",
+                  table),
+          "the combined rule set parses");
+    const std::string PLAIN = "Suburb";
+    check(near(table.fare(RideType::Standard, PLAIN, PLAIN, 10, 7 * HOUR), 21.0), "base + distance * rate");
+    check(near(table.fare(RideType::Standard, PLAIN, PLAIN, 10, 8 * HOUR), 31.5), "a time rule multiplies");
+    check(near(table.fare(RideType::Standard, PLAIN, PLAIN, 10, 9 * HOUR), 63.0), "overlapping time rules multiply");
+    check(near(table.fare(RideType::Standard, PLAIN, PLAIN, 10, 11 * HOUR), 21.0), "a time range's end is exclusive");
+    check(near(table.fare(RideType::Premium, PLAIN, PLAIN, 10, 9 * HOUR + 30 * 60000), 360.0) &&
+              near(table.fare(RideType::Standard, PLAIN, PLAIN, 10, 9 * HOUR + 30 * 60000), 63.0),
+          "a tier-specific time rule applies to its tier only");
+    check(near(table.fare(RideType::Standard, "Downtown", PLAIN, 10, 7 * HOUR), 21.0 * 1.1 * 1.2 + 1.0),
+          "repeated zone rules multiply and add up");
+    check(near(table.fare(RideType::Standard, PLAIN, "Downtown", 10, 7 * HOUR), 21.0),
+          "the zone multiplier follows the pickup only");
+    check(near(table.fare(RideType::Standard, "Airport", "Airport", 10, 7 * HOUR), 21.0 + 4.0 + 4.5),
+          "airport fees apply at both ends");
+    check(near(table.fare(RideType::Standard, PLAIN, "Airport", 1, 7 * HOUR), 10.0 + 4.5),
+          "the minimum applies before the fees");
+
+    PricingInput trips[] = {{10, 9 * HOUR, table.zoneOf("Downtown"), table.zoneOf("Airport"), RideType::Standard},
+                            {3, 9 * HOUR + 30 * 60000, table.neutralZone(), table.zoneOf(PLAIN), RideType::Premium}};
+    double fares[2];
+    table.fareBatch(trips, fares, 2);
+    check(near(fares[0], table.fare(RideType::Standard, "Downtown", "Airport", 10, 9 * HOUR)) &&
+              near(fares[1], table.fare(RideType::Premium, PLAIN, PLAIN, 3, 9 * HOUR + 30 * 60000)),
+          "the batch API prices like the per-trip API");
+    check(table.zoneCount() == 2, "one table entry per named zone");
+}
+
+// Ranges may wrap midnight, equal ends cover the whole day, and times are
+// read in UTC from the Unix timestamp (negative ones included).
+static void timeRangesWrapInUtc() {
+    PricingTable table;
+    check(compile("tier standard rate 1\ntime 22:00-02:00 multiplier 2\ntime 05:00-05:00 multiplier 3\n", table),
+          "wrapping and whole-day rules parse");
+    const TimestampMs DAY = 24 * HOUR;
+    check(near(table.fare(RideType::Standard, "A", "B", 10, 23 * HOUR), 60.0) &&
+              near(table.fare(RideType::Standard, "A", "B", 10, DAY + HOUR), 60.0),
+          "a wrapping range covers both sides of midnight");
+    check(near(table.fare(RideType::Standard, "A", "B", 10, 2 * HOUR), 30.0), "a wrapping range ends on time");
+    check(near(table.fare(RideType::Standard, "A", "B", 10, -HOUR), 60.0), "times before 1970 map to the UTC clock");
+    check(near(table.fare(RideType::Standard, "A", "B", 10, DAY - 1), 60.0) &&
+              near(table.fare(RideType::Standard, "A", "B", 10, DAY + 2 * HOUR - 1), 60.0),
+          "the last millisecond before each range end is still inside it");
+}
+
+// An engine with rules charges rides and quotes the same table fare.
+static void engineChargesTableFares() {
+    PricingTable table;
+    check(compile("tier standard rate 2 base 0 minimum 0\nzone Downtown multiplier 1.5\n", table),
+          "the engine's rule set parses");
+    QuietCout quiet; // requestRide prints every ride
+    RideEngine engine;
+    engine.setPricing(&table);
+    RiderHandle rider = engine.addRider(0, "R1", "Alice");
+    double charged = engine.requestRide(8 * HOUR, rider, RideType::Standard, "T1", "Downtown", "Mall", 4.0);
+    double quoted = engine.quote(8 * HOUR, RideType::Standard, "Downtown", "Mall", 4.0);
+    check(near(charged, 12.0) && near(quoted, 12.0), "quotes and rides use the rules");
+    double stored = 0.0;
+    engine.rider(rider).forEachRide([&stored](const Ride& ride) { stored = ride.getFare(); });
+    check(near(stored, 12.0), "the rider's ride keeps the rule fare");
+}
+
+int main() {
+    parseErrorsNameTheLine();
+    emptyRulesMatchBuiltInFares();
+    rulesCombine();
+    timeRangesWrapInUtc();
+    engineChargesTableFares();
+    return testResult("pricing_rules_test");
+}
@@ -0,0 +1,71 @@
+// quote_cache_test.cpp - QuoteCache hits, misses and invalidation
+//
+// Run through ctest, or directly: ./quote_cache_test (exit status 0 = pass).
+
+#include <iostream>
+#include <string>
+
+#include "QuoteCache.h"
+#include "RideEngine.h"
+#include "QuietOutput.h"
+#include "TestCheck.h"
+
+// A quote is served only under the key, cache version and epoch it was
+// stored with.
+static void entriesMatchKeyVersionAndEpoch() {
+    QuoteCache cache(64);
+    std::uint64_t key = QuoteCache::keyOf(RideType::Standard, "Downtown", "Airport", 0);
+    double fare = 0.0;
+    double distance = 0.0;
+    check(!cache.lookup(key, 0, fare, distance), "an empty cache misses");
+
+    cache.store(key, 3, 24.0, 12.0, cache.version());
+    check(cache.lookup(key, 3, fare, distance) && fare == 24.0 && distance == 12.0, "stored quote hits");
+    check(!cache.lookup(key, 4, fare, distance), "another epoch misses");
+    check(!cache.lookup(QuoteCache::keyOf(RideType::Premium, "Downtown", "Airport", 0), 3, fare, distance),
+          "another tier misses");
+    check(!cache.lookup(QuoteCache::keyOf(RideType::Standard, "Downtown", "Airport", 1), 3, fare, distance),
+          "another time slot misses");
+
+    cache.invalidate();
+    check(!cache.lookup(key, 3, fare, distance), "invalidate drops the quote");
+
+    std::uint32_t pricedUnder = cache.version();
+    cache.invalidate(); // the rules change while the quote is being priced
+    cache.store(key, 3, 30.0, 12.0, pricedUnder);
+    check(!cache.lookup(key, 3, fare, distance), "a quote priced under old rules is stale on arrival");
+}
+
+// Once surge moves a multiplier, a cached quote from before the change must
+// miss and be re-priced; until the next change it is served from the cache.
+static void surgeChangeMissesTheCache() {
+    const TimestampMs START = 1700000000000;
+    QuietCout quiet;
+    RideEngine engine;
+    QuoteCache cache(256);
+    SurgeEngine surge(4);
+    engine.setQuoteCache(&cache);
+    engine.setSurge(&surge, 5000);
+    RiderHandle rider = engine.addRider(START, "R1", "Rider");
+
+    double before = engine.quote(START, RideType::Standard, "Downtown", "Airport", 10.0);
+    check(before == StandardRide::fareFor(10.0), "no surge before the first update");
+    for (int i = 0; i < 10; ++i) {
+        engine.requestRide(START, rider, RideType::Standard, "S" + std::to_string(i), "Downtown", "Airport", 10.0);
+    }
+    double hits = RideMetrics::quoteCacheHits.value();
+    double surged = engine.quote(START + 6000, RideType::Standard, "Downtown", "Airport", 10.0);
+    check(surge.epoch() == 1, "demand with no free drivers moves a multiplier");
+    check(surged > before, "the changed multiplier reaches the quote");
+    check(RideMetrics::quoteCacheHits.value() == hits, "the quote priced before the change misses");
+
+    double again = engine.quote(START + 6500, RideType::Standard, "Downtown", "Airport", 10.0);
+    check(again == surged, "same multiplier, same quote");
+    check(RideMetrics::quoteCacheHits.value() == hits + 1, "the re-priced quote is cached");
+}
+
+int main() {
+    entriesMatchKeyVersionAndEpoch();
+    surgeChangeMissesTheCache();
+    return testResult("quote_cache_test");
+}
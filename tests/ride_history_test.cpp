@@ -0,0 +1,197 @@
+// ride_history_test.cpp - RideHistory's cap, fold hook and time index
+//
+// Run through ctest, or directly: ./ride_history_test (exit status 0 = pass).
+
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+
+#include "Rider.h"
+#include "QuietOutput.h"
+#include "TestCheck.h"
+
+static std::size_t heldRides(const Rider& rider) {
+    std::size_t held = 0;
+    rider.forEachRide([&held](const Ride&) { ++held; });
+    return held;
+}
+
+// Every ride a range query visits must still be held by the rider. Only
+// addresses are compared, so a stale index entry is caught without
+// dereferencing it.
+static bool rangeMatchesHistory(const Rider& rider, TimestampMs from, TimestampMs to, std::size_t expected) {
+    std::set<const Ride*> held;
+    rider.forEachRide([&held](const Ride& ride) { held.insert(&ride); });
+    std::size_t visited = 0;
+    bool allHeld = true;
+    rider.forEachRideBetween(from, to, [&](const Ride& ride) {
+        ++visited;
+        allHeld = allHeld && held.count(&ride) != 0;
+    });
+    return allHeld && visited == expected;
+}
+
+// The cap holds even when no ride ever finishes: unfinished rides are
+// folded oldest first, and the onFold hook lets RideTimeouts drop them
+// before they are freed.
+static void capHoldsForUnfinishedRides() {
+    const TimestampMs MINUTE = 60 * 1000;
+    QuietCout quiet;
+    Rider rider("R003", "Test Rider");
+    RideTimeouts timeouts(0);
+    std::size_t hooked = 0;
+    RideHistoryPolicy policy;
+    policy.recentRides = 4;
+    policy.onFold = [&timeouts, &hooked](Ride& ride) {
+        ++hooked;
+        timeouts.forget(ride);
+    };
+    rider.setHistoryPolicy(policy);
+    for (int i = 0; i < 10; ++i) {
+        rider.requestRide(std::make_unique<StandardRide>("A" + std::to_string(i), "Park", "Mall", 3.0, i * MINUTE),
+                          timeouts, i * MINUTE);
+    }
+    check(heldRides(rider) == 4, "active rides are capped");
+    check(rider.getOlderRides().rides == 6, "the six oldest are summarised");
+    check(rider.getOlderRides().statusRides[static_cast<std::size_t>(RideStatus::Requested)] == 6,
+          "they are summarised as still requested");
+    check(hooked == 6, "onFold sees every unfinished ride it folds");
+    check(timeouts.pendingCount() == 4, "folded rides no longer have timeouts");
+    std::string oldestKept;
+    rider.forEachRide([&oldestKept](const Ride& ride) {
+        if (oldestKept.empty()) {
+            oldestKept = ride.getRideID();
+        }
+    });
+    check(oldestKept == "A6", "the newest rides are the ones kept");
+    timeouts.tick(60 * MINUTE); // would touch freed rides if any were still tracked
+    check(timeouts.pendingCount() == 0, "kept rides time out normally");
+}
+
+// Scheduled rides are exempt from the cap until their queue releases them.
+static void scheduledRidesWaitForRelease() {
+    const TimestampMs MINUTE = 60 * 1000;
+    QuietCout quiet;
+    Rider rider("R004", "Test Rider");
+    ScheduledRideQueue queue(0);
+    RideHistoryPolicy policy;
+    policy.recentRides = 2;
+    rider.setHistoryPolicy(policy);
+    for (int i = 0; i < 3; ++i) {
+        rider.scheduleRide(std::make_unique<StandardRide>("B" + std::to_string(i), "Park", "Mall", 3.0, 0),
+                           (120 + i) * MINUTE, queue, 0);
+    }
+    check(heldRides(rider) == 3, "scheduled rides stay while the queue holds them");
+    queue.releaseDue(3 * 60 * MINUTE, [](Ride&, TimestampMs) {});
+    rider.requestRide(std::make_unique<StandardRide>("B3", "Park", "Mall", 3.0, 4 * 60 * MINUTE));
+    check(heldRides(rider) == 2, "released rides are folded down to the cap");
+    check(queue.size() == 0, "nothing left in the queue");
+}
+
+// A scheduled ride is re-stamped Requested when the queue releases it. The
+// index must still find it under its original request time when the ride is
+// folded out of the history.
+static void scheduledRideReleasedThenFolded() {
+    const TimestampMs MINUTE = 60 * 1000;
+    QuietCout quiet;
+    Rider rider("R001", "Test Rider");
+    ScheduledRideQueue queue(0);
+    rider.scheduleRide(std::make_unique<StandardRide>("S1", "Downtown", "Airport", 12.0, 0), 90 * MINUTE, queue, 0);
+    std::size_t released = queue.releaseDue(2 * 60 * MINUTE, [](Ride&, TimestampMs) {});
+    check(released == 1, "scheduled ride is released");
+
+    Ride* scheduled = nullptr;
+    rider.forEachRide([&scheduled](const Ride& ride) { scheduled = const_cast<Ride*>(&ride); });
+    check(scheduled != nullptr && scheduled->getStatus() == RideStatus::Requested, "released ride is requested");
+    check(scheduled != nullptr && scheduled->getRequestedAt() == 0, "request time survives the release");
+    check(scheduled != nullptr && scheduled->getStatusTime(RideStatus::Requested) != 0, "release re-stamps the state time");
+    if (scheduled == nullptr) {
+        return;
+    }
+    scheduled->transitionTo(RideStatus::Cancelled, 2 * 60 * MINUTE);
+
+    RideHistoryPolicy policy;
+    policy.recentRides = 2;
+    rider.setHistoryPolicy(policy);
+    for (int i = 0; i < 3; ++i) {
+        auto ride = std::make_unique<StandardRide>("R" + std::to_string(i), "Park", "Mall", 3.0, (i + 1) * MINUTE);
+        ride->transitionTo(RideStatus::Cancelled, (i + 1) * MINUTE);
+        rider.requestRide(std::move(ride));
+    }
+    check(rider.getOlderRides().rides == 2, "the scheduled ride and the oldest new ride are folded");
+    check(rangeMatchesHistory(rider, 0, 3 * 60 * MINUTE, 2), "range query sees only rides still held");
+    check(rangeMatchesHistory(rider, 0, MINUTE + 1, 0), "folded rides leave the index");
+}
+
+// A matched ride that falls back to Requested is re-stamped the same way.
+static void matchedRideFallsBackThenFolded() {
+    const TimestampMs MINUTE = 60 * 1000;
+    QuietCout quiet;
+    Rider rider("R002", "Test Rider");
+    auto ride = std::make_unique<StandardRide>("M1", "Downtown", "Airport", 12.0, 5 * MINUTE);
+    Ride& first = *ride;
+    rider.requestRide(std::move(ride));
+    first.transitionTo(RideStatus::Matched, 6 * MINUTE);
+    first.transitionTo(RideStatus::Requested, 7 * MINUTE);
+    first.transitionTo(RideStatus::Cancelled, 8 * MINUTE);
+    check(rangeMatchesHistory(rider, 5 * MINUTE, 5 * MINUTE + 1, 1), "indexed under its first request time");
+
+    RideHistoryPolicy policy;
+    policy.recentRides = 1;
+    rider.setHistoryPolicy(policy);
+    rider.requestRide(std::make_unique<StandardRide>("M2", "Park", "Mall", 3.0, 10 * MINUTE));
+    check(rangeMatchesHistory(rider, 0, 60 * MINUTE, 1), "fallen-back ride is folded out of the index");
+    check(rider.getOlderRides().firstRequested == 5 * MINUTE, "the summary keeps the first request time");
+}
+
+// Random ranges over rides requested out of order, with and without a cap,
+// visit exactly the held rides requested in [from, to), earliest first.
+static void rangeQueriesMatchBruteForce() {
+    QuietCout quiet;
+    std::mt19937 rng(13);
+    bool same = true;
+    bool ordered = true;
+    for (std::size_t cap : {std::size_t(0), std::size_t(40)}) {
+        Rider rider("R001", "Test Rider");
+        if (cap != 0) {
+            RideHistoryPolicy policy;
+            policy.recentRides = cap;
+            rider.setHistoryPolicy(policy);
+        }
+        for (int i = 0; i < 300; ++i) {
+            TimestampMs at = static_cast<TimestampMs>(rng() % 10000) - 2000; // some before 1970
+            rider.requestRide(std::make_unique<StandardRide>("T" + std::to_string(i), "Park", "Mall", 1.0, at));
+        }
+        for (int query = 0; query < 200; ++query) {
+            TimestampMs from = static_cast<TimestampMs>(rng() % 12000) - 3000;
+            TimestampMs to = from + static_cast<TimestampMs>(rng() % 3000);
+            std::multiset<std::string> expected;
+            rider.forEachRide([&](const Ride& ride) {
+                if (ride.getRequestedAt() >= from && ride.getRequestedAt() < to) {
+                    expected.insert(ride.getRideID());
+                }
+            });
+            std::multiset<std::string> visited;
+            TimestampMs previous = from;
+            rider.forEachRideBetween(from, to, [&](const Ride& ride) {
+                visited.insert(ride.getRideID());
+                ordered = ordered && ride.getRequestedAt() >= previous;
+                previous = ride.getRequestedAt();
+            });
+            same = same && visited == expected;
+        }
+    }
+    check(same, "range queries visit exactly the held rides in range");
+    check(ordered, "range queries visit rides earliest first");
+}
+
+int main() {
+    capHoldsForUnfinishedRides();
+    scheduledRidesWaitForRelease();
+    scheduledRideReleasedThenFolded();
+    matchedRideFallsBackThenFolded();
+    rangeQueriesMatchBruteForce();
+    return testResult("ride_history_test");
+}
@@ -0,0 +1,89 @@
+// ride_lifecycle_test.cpp - Ride state machine and live per-state counts
+//
+// Build:  g++ -O2 -std=c++17 -pthread -I. tests/ride_lifecycle_test.cpp -o ride_lifecycle_test
+// Run through ctest, or directly: ./ride_lifecycle_test (exit status 0 = pass).
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Ride.h"
+#include "TestCheck.h"
+
+// Every (from, to) pair against the lifecycle written out by hand: a
+// refused move leaves the ride and its state times untouched.
+static void transitionsFollowTheLifecycle() {
+    const RideStatus ALL[] = {RideStatus::Requested, RideStatus::Matched,   RideStatus::EnRoute,
+                              RideStatus::InProgress, RideStatus::Completed, RideStatus::Cancelled,
+                              RideStatus::Scheduled};
+    auto expected = [](RideStatus from, RideStatus to) {
+        switch (from) {
+            case RideStatus::Requested:
+                return to == RideStatus::Matched || to == RideStatus::Cancelled || to == RideStatus::Scheduled;
+            case RideStatus::Matched:
+                return to == RideStatus::Requested || to == RideStatus::EnRoute || to == RideStatus::Cancelled;
+            case RideStatus::EnRoute:
+                return to == RideStatus::InProgress || to == RideStatus::Cancelled;
+            case RideStatus::InProgress:
+                return to == RideStatus::Completed;
+            case RideStatus::Scheduled:
+                return to == RideStatus::Requested || to == RideStatus::Cancelled;
+            default:
+                return false; // Completed and Cancelled are final
+        }
+    };
+    bool table = true;
+    for (RideStatus from : ALL) {
+        for (RideStatus to : ALL) {
+            table = table && isValidTransition(from, to) == expected(from, to);
+        }
+    }
+    check(table, "the transition table matches the lifecycle");
+
+    StandardRide ride("T1", "Park", "Mall", 2.0, 100);
+    check(ride.getStatus() == RideStatus::Requested && ride.getStatusTime(RideStatus::Requested) == 100,
+          "a new ride is Requested at its request time");
+    check(!ride.transitionTo(RideStatus::Completed, 200) && ride.getStatus() == RideStatus::Requested &&
+              ride.getStatusTime(RideStatus::Completed) == 0,
+          "a refused move changes nothing");
+    check(ride.transitionTo(RideStatus::Matched, 300) && ride.transitionTo(RideStatus::Requested, 400),
+          "a matched ride can fall back to Requested");
+    check(ride.getStatusTime(RideStatus::Requested) == 400 && ride.getRequestedAt() == 100,
+          "falling back re-stamps the state, not the request time");
+    check(ride.transitionTo(RideStatus::Matched, 500) && ride.transitionTo(RideStatus::EnRoute, 600) &&
+              ride.transitionTo(RideStatus::InProgress, 700) && ride.transitionTo(RideStatus::Completed, 800),
+          "the happy path completes");
+    check(!ride.transitionTo(RideStatus::Cancelled, 900) && ride.getStatusTime(RideStatus::Completed) == 800,
+          "a completed ride is final");
+}
+
+// Live counts follow construction, every transition and destruction,
+// including rides created on one thread and moved or freed on another.
+static void liveCountsFollowRides() {
+    const std::size_t requested = Ride::countInState(RideStatus::Requested);
+    const std::size_t matched = Ride::countInState(RideStatus::Matched);
+    std::vector<std::unique_ptr<Ride>> rides;
+    std::thread creator([&rides] {
+        for (int i = 0; i < 1000; ++i) {
+            rides.push_back(std::make_unique<StandardRide>("T", "Park", "Mall", 1.0, 0));
+        }
+    });
+    creator.join();
+    check(Ride::countInState(RideStatus::Requested) == requested + 1000, "rides made on a thread are counted");
+    for (std::size_t i = 0; i < 400; ++i) {
+        rides[i]->transitionTo(RideStatus::Matched, 1);
+    }
+    check(Ride::countInState(RideStatus::Requested) == requested + 600 &&
+              Ride::countInState(RideStatus::Matched) == matched + 400,
+          "transitions move counts between states");
+    std::thread destroyer([&rides] { rides.clear(); });
+    destroyer.join();
+    check(Ride::countInState(RideStatus::Requested) == requested && Ride::countInState(RideStatus::Matched) == matched,
+          "rides freed on another thread leave the counts exact");
+}
+
+int main() {
+    transitionsFollowTheLifecycle();
+    liveCountsFollowRides();
+    return testResult("ride_lifecycle_test");
+}
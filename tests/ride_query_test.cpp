@@ -0,0 +1,166 @@
+// ride_query_test.cpp - RideColumns queries against a brute-force scan
+//
+// Run through ctest, or directly: ./ride_query_test (exit status 0 = pass).
+
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "RideQuery.h"
+#include "Workload.h"
+#include "TestCheck.h"
+
+struct TestRow {
+    RideType type;
+    RideStatus status;
+    std::uint32_t pickup;
+    std::uint32_t dropoff;
+    float distance;
+    float fare;
+    TimestampMs requestedAt;
+};
+
+static std::string hourName(TimestampMs at) {
+    TimestampMs ms = at % MS_PER_DAY;
+    char text[8];
+    std::snprintf(text, sizeof(text), "%02d:00", static_cast<int>((ms < 0 ? ms + MS_PER_DAY : ms) / 3600000));
+    return text;
+}
+
+// The group a row lands in, named the way query() names it. Days are
+// compared by number and named through a one-row query, so the test does
+// not depend on the date formatting.
+static std::string groupOf(const RideColumns& table, const TestRow& row, RideGroupBy groupBy) {
+    switch (groupBy) {
+        case RideGroupBy::None: return "all";
+        case RideGroupBy::Pickup: return table.locationName(row.pickup);
+        case RideGroupBy::Dropoff: return table.locationName(row.dropoff);
+        case RideGroupBy::Type: return rideTypeName(row.type);
+        case RideGroupBy::Status: return rideStatusName(row.status);
+        case RideGroupBy::Day: return std::to_string(dayOf(row.requestedAt));
+        case RideGroupBy::HourOfDay: return hourName(row.requestedAt);
+    }
+    return "";
+}
+
+static bool matches(const RideColumns& table, const TestRow& row, const RideQuery& q) {
+    return (!q.filterType || row.type == q.type) && (!q.filterStatus || row.status == q.status) &&
+           row.requestedAt >= q.requestedFrom && row.requestedAt < q.requestedTo &&
+           (q.pickup.empty() || table.locationName(row.pickup) == q.pickup) &&
+           (q.dropoff.empty() || table.locationName(row.dropoff) == q.dropoff) &&
+           row.distance >= static_cast<float>(q.minDistance) && row.distance <= static_cast<float>(q.maxDistance);
+}
+
+static bool close(double a, double b) {
+    return std::fabs(a - b) <= 1e-9 * (std::fabs(a) + std::fabs(b)) + 1e-6;
+}
+
+// Compare query() on `threads` threads with a scan over every row.
+static void checkQuery(const RideColumns& table, const std::vector<TestRow>& rows, const RideQuery& q,
+                       unsigned threads, const char* what) {
+    struct Expected {
+        std::uint64_t rides = 0;
+        double fare = 0.0;
+        double distance = 0.0;
+    };
+    std::map<std::string, Expected> expected;
+    std::map<std::int64_t, std::string> dayKeys; // day number -> key, ordered by day
+    for (const TestRow& row : rows) {
+        if (matches(table, row, q)) {
+            Expected& e = expected[groupOf(table, row, q.groupBy)];
+            ++e.rides;
+            e.fare += row.fare;
+            e.distance += row.distance;
+            dayKeys[dayOf(row.requestedAt)] = std::to_string(dayOf(row.requestedAt));
+        }
+    }
+    std::vector<RideQueryRow> out;
+    table.query(q, out, threads);
+    bool ok = out.size() == expected.size();
+    std::vector<std::string> dayOrder;
+    for (const auto& entry : dayKeys) {
+        dayOrder.push_back(entry.second);
+    }
+    for (std::size_t i = 0; ok && i < out.size(); ++i) {
+        // Day rows are named YYYY-MM-DD; match them to day numbers by position,
+        // which also checks that they come out in date order.
+        std::string key = q.groupBy == RideGroupBy::Day ? dayOrder[i] : out[i].group;
+        auto it = expected.find(key);
+        ok = it != expected.end() && it->second.rides == out[i].rides && close(it->second.fare, out[i].fare) &&
+             close(it->second.distance, out[i].distance);
+    }
+    check(ok, what);
+}
+
+int main() {
+    RideColumns table;
+    std::vector<TestRow> rows;
+    WorkloadRng rng(42);
+    const TimestampMs START = 1700000000000; // November 2023
+    std::vector<std::uint32_t> locations;
+    for (int l = 0; l < 40; ++l) {
+        locations.push_back(table.locationId("Loc-" + std::to_string(l)));
+    }
+    for (std::size_t i = 0; i < 100000; ++i) {
+        TestRow row;
+        row.type = rng.below(5) == 0 ? RideType::Premium : RideType::Standard;
+        row.status = rng.below(10) == 0 ? RideStatus::Cancelled : RideStatus::Completed;
+        row.pickup = locations[rng.below(locations.size())];
+        row.dropoff = locations[rng.below(locations.size())];
+        row.distance = static_cast<float>(0.5 + rng.below(4000) / 100.0);
+        row.fare = static_cast<float>(fareFor(row.type, row.distance));
+        row.requestedAt = START + static_cast<TimestampMs>(rng.below(10ull * MS_PER_DAY));
+        rows.push_back(row);
+    }
+    // Outliers: one ride decades ahead, one before the epoch.
+    rows.push_back(TestRow{RideType::Standard, RideStatus::Completed, locations[0], locations[1], 3.0f, 6.0f,
+                           START + 20000LL * MS_PER_DAY});
+    rows.push_back(TestRow{RideType::Premium, RideStatus::Completed, locations[2], locations[3], 4.0f, 19.0f,
+                           -5 * MS_PER_DAY + 1234});
+    for (const TestRow& row : rows) {
+        table.appendRow(row.type, row.status, row.pickup, row.dropoff, row.distance, row.fare, row.requestedAt);
+    }
+
+    const RideGroupBy GROUPS[] = {RideGroupBy::None, RideGroupBy::Pickup, RideGroupBy::Dropoff, RideGroupBy::Type,
+                                  RideGroupBy::Status, RideGroupBy::Day, RideGroupBy::HourOfDay};
+    for (RideGroupBy groupBy : GROUPS) {
+        for (unsigned threads : {1u, 4u}) {
+            RideQuery all;
+            all.groupBy = groupBy;
+            checkQuery(table, rows, all, threads, "group-by over every ride");
+
+            RideQuery filtered;
+            filtered.groupBy = groupBy;
+            filtered.filterType = true;
+            filtered.type = RideType::Premium;
+            filtered.filterStatus = true;
+            filtered.status = RideStatus::Completed;
+            filtered.requestedFrom = START + 2 * MS_PER_DAY;
+            filtered.requestedTo = START + 7 * MS_PER_DAY;
+            filtered.minDistance = 5.0;
+            filtered.maxDistance = 25.0;
+            checkQuery(table, rows, filtered, threads, "group-by with every filter");
+
+            RideQuery route;
+            route.groupBy = groupBy;
+            route.pickup = "Loc-3";
+            route.dropoff = "Loc-7";
+            checkQuery(table, rows, route, threads, "group-by over one route");
+        }
+    }
+
+    RideQuery unknown;
+    unknown.pickup = "Nowhere";
+    std::vector<RideQueryRow> out;
+    table.query(unknown, out, 1);
+    check(out.empty(), "an unknown location matches nothing");
+
+    RideQuery byDay;
+    byDay.groupBy = RideGroupBy::Day;
+    table.query(byDay, out, 1);
+    check(out.size() == 13, "outliers add one day group each, not the days between");
+    check(!out.empty() && out.front().group == "1969-12-27", "before-epoch day is named and sorted first");
+    return testResult("ride_query_test");
+}
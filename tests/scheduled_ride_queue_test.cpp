@@ -0,0 +1,110 @@
+// scheduled_ride_queue_test.cpp - ScheduledRideQueue release order and timing
+//
+// Build:  g++ -O2 -std=c++17 -I. tests/scheduled_ride_queue_test.cpp -o scheduled_ride_queue_test
+// Run through ctest, or directly: ./scheduled_ride_queue_test (exit status 0 = pass).
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ScheduledRideQueue.h"
+#include "TestCheck.h"
+
+// Random bookings spanning the ring, its boundaries and several overflow
+// revolutions come out exactly once, bucket by bucket, in the bucket their
+// pickup falls in (or the next release for pickups already due).
+static void releaseOrderMatchesBuckets() {
+    const TimestampMs WIDTH = 1000;
+    const std::size_t BUCKETS = 16; // horizon of 16 s, so most bookings overflow
+    ScheduledRideQueue queue(0, WIDTH, BUCKETS);
+    std::mt19937 rng(5);
+
+    std::vector<std::unique_ptr<StandardRide>> rides;
+    std::vector<TimestampMs> pickups;
+    auto book = [&](TimestampMs pickupAt, TimestampMs now) {
+        rides.push_back(std::make_unique<StandardRide>("S" + std::to_string(rides.size()), "Park", "Mall", 2.0, now));
+        pickups.push_back(pickupAt);
+        return queue.schedule(*rides.back(), pickupAt, now);
+    };
+    // Pickups just either side of the ring edge and of revolution edges, then random ones.
+    const TimestampMs EDGES[] = {0, 999, 1000, 15999, 16000, 16001, 31999, 32000, 64000, 160000 - 1};
+    bool booked = true;
+    for (TimestampMs pickupAt : EDGES) {
+        booked = book(pickupAt, 0) && booked;
+    }
+    for (int i = 0; i < 500; ++i) {
+        booked = book(rng() % 200000, 0) && booked;
+    }
+    check(booked, "requested rides can be scheduled");
+    check(queue.size() == rides.size(), "every booking is outstanding");
+
+    std::vector<int> releasedAt(rides.size(), -1);
+    TimestampMs now = 0;
+    bool inBucket = true;
+    bool statusOk = true;
+    while (now <= 210000) {
+        queue.releaseDue(now, [&](Ride& ride, TimestampMs pickupAt) {
+            std::size_t index = std::stoul(ride.getRideID().substr(1));
+            if (releasedAt[index] != -1) {
+                inBucket = false; // released twice
+            }
+            releasedAt[index] = static_cast<int>(now);
+            // Released once the pickup's bucket has started, and no earlier.
+            inBucket = inBucket && pickupAt == pickups[index] && pickupAt / WIDTH <= now / WIDTH &&
+                       now / WIDTH == pickupAt / WIDTH;
+            statusOk = statusOk && ride.getStatus() == RideStatus::Requested;
+        });
+        now += 1 + rng() % 700; // never skips a whole bucket
+    }
+    check(inBucket, "each ride is released in its pickup's bucket");
+    check(statusOk, "released rides are Requested again");
+    check(std::count(releasedAt.begin(), releasedAt.end(), -1) == 0, "every booking is released");
+    check(queue.size() == 0, "nothing outstanding after the last pickup");
+}
+
+// Bookings already due go out with the next bucket; a large jump releases
+// every bucket passed over, in bucket order.
+static void lateAndSkippedBucketsRelease() {
+    ScheduledRideQueue queue(0, 1000, 8);
+    StandardRide early("E", "Park", "Mall", 1.0, 0);
+    StandardRide mid("M", "Park", "Mall", 1.0, 0);
+    StandardRide far("F", "Park", "Mall", 1.0, 0);
+    queue.schedule(far, 50000, 0);
+    queue.schedule(mid, 9000, 0);
+    queue.releaseDue(5000, [](Ride&, TimestampMs) {});
+    queue.schedule(early, 100, 5000); // pickup already in the past
+    std::vector<std::string> order;
+    auto record = [&order](Ride& ride, TimestampMs) { order.push_back(ride.getRideID()); };
+    queue.releaseDue(5999, record);
+    check(order.empty(), "a released bucket is not revisited");
+    queue.releaseDue(6000, record);
+    check(order == std::vector<std::string>{"E"}, "an overdue booking releases with the next bucket");
+    order.clear();
+    queue.releaseDue(60000, record);
+    check((order == std::vector<std::string>{"M", "F"}), "a jump releases skipped buckets in order");
+}
+
+// A ride cancelled while scheduled is dropped on release, not handed out.
+static void cancelledBookingIsSkipped() {
+    ScheduledRideQueue queue(0, 1000, 8);
+    StandardRide kept("K", "Park", "Mall", 1.0, 0);
+    StandardRide cancelled("C", "Park", "Mall", 1.0, 0);
+    queue.schedule(kept, 3000, 0);
+    queue.schedule(cancelled, 3000, 0);
+    check(cancelled.transitionTo(RideStatus::Cancelled, 100), "a scheduled ride can be cancelled");
+    std::size_t handed = 0;
+    std::size_t released = queue.releaseDue(3000, [&handed](Ride&, TimestampMs) { ++handed; });
+    check(released == 1 && handed == 1, "only the live booking is released");
+    check(queue.size() == 0, "the cancelled booking is dropped");
+    check(queue.schedule(kept, 9000, 3000) && queue.size() == 1, "a released ride can be booked again");
+    check(!queue.schedule(cancelled, 9000, 3000), "a cancelled ride cannot be booked");
+}
+
+int main() {
+    releaseOrderMatchesBuckets();
+    lateAndSkippedBucketsRelease();
+    cancelledBookingIsSkipped();
+    return testResult("scheduled_ride_queue_test");
+}
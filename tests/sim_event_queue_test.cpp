@@ -0,0 +1,85 @@
+// sim_event_queue_test.cpp - SimEventQueue order against a reference heap
+//
+// Run through ctest, or directly: ./sim_event_queue_test (exit status 0 = pass).
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "SimEventQueue.h"
+#include "TestCheck.h"
+
+// (time, push order) min-heap: the order the queue promises.
+using Expected = std::tuple<TimestampMs, std::uint64_t>;
+using ReferenceQueue = std::priority_queue<Expected, std::vector<Expected>, std::greater<Expected>>;
+
+// A hold-pattern run with delays inside the ring, at its horizon and far in
+// the overflow pops in exactly the reference order.
+static void holdMatchesReferenceHeap() {
+    const TimestampMs WIDTH = 10;
+    SimEventQueue queue(1000, WIDTH, 64); // horizon of 640 ms
+    ReferenceQueue reference;
+    std::mt19937 rng(9);
+    std::uint64_t pushed = 0;
+    auto push = [&](TimestampMs time) {
+        queue.push(time, 0, 0, pushed);
+        reference.emplace(time, pushed++);
+    };
+    for (int i = 0; i < 200; ++i) {
+        push(1000 + rng() % 5000);
+    }
+    TimestampMs now = 1000;
+    bool ordered = true;
+    std::size_t popped = 0;
+    SimEvent event{};
+    while (queue.pop(event)) {
+        Expected expected = reference.top();
+        reference.pop();
+        ordered = ordered && event.data == std::get<1>(expected) && event.time == std::get<0>(expected);
+        now = std::max(now, event.time);
+        if (++popped < 20000) {
+            switch (rng() % 6) {
+            case 0: push(now); break;                           // same time: FIFO
+            case 1: push(now + WIDTH * 64 - 1); break;          // ring edge
+            case 2: push(now + WIDTH * 64 + rng() % 5000); break; // overflow
+            case 3: push(now + 50000 + rng() % 100000); break;  // far overflow
+            default: push(now + rng() % 200); break;
+            }
+            if (rng() % 4 == 0) {
+                push(now + rng() % 30);
+            }
+        }
+    }
+    check(ordered, "events pop in (time, push order)");
+    check(reference.empty() && queue.empty(), "every event pops once");
+    check(popped > 20000, "the run exercised the queue");
+}
+
+// Equal times pop in push order even across the overflow heap; events
+// pushed into the past are delivered next.
+static void tiesAndLateEvents() {
+    SimEventQueue queue(0, 10, 64);
+    for (std::uint32_t i = 0; i < 5; ++i) {
+        queue.push(100000, i, 0);
+    }
+    queue.push(50, 9, 0);
+    SimEvent event{};
+    check(queue.pop(event) && event.kind == 9, "the earliest event pops first");
+    queue.push(10, 7, 0); // already in the past
+    check(queue.pop(event) && event.kind == 7, "a past event is delivered next");
+    bool fifo = true;
+    for (std::uint32_t i = 0; i < 5; ++i) {
+        fifo = queue.pop(event) && event.kind == i && fifo;
+    }
+    check(fifo, "equal times pop in push order after migrating from overflow");
+    check(!queue.pop(event) && queue.size() == 0, "an empty queue pops nothing");
+}
+
+int main() {
+    holdMatchesReferenceHeap();
+    tiesAndLateEvents();
+    return testResult("sim_event_queue_test");
+}
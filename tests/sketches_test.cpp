@@ -0,0 +1,123 @@
+// sketches_test.cpp - Sketch estimates against exact counts
+//
+// Run through ctest, or directly: ./sketches_test (exit status 0 = pass).
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Sketches.h"
+#include "TestCheck.h"
+
+// Distinct counts stay within four standard errors (3.3%) from tiny to
+// large sets, and a merged sketch estimates the union.
+static void hyperLogLogWithinErrorBound() {
+    const double BOUND = 4 * 1.04 / std::sqrt(static_cast<double>(HyperLogLog::REGISTERS));
+    bool within = true;
+    for (std::uint64_t distinct : {10ull, 1000ull, 50000ull, 2000000ull}) {
+        HyperLogLog sketch;
+        for (std::uint64_t i = 0; i < distinct; ++i) {
+            sketch.add(sketchHash(i));
+            sketch.add(sketchHash(i / 2)); // duplicates must not count
+        }
+        double error = std::fabs(sketch.estimate() - static_cast<double>(distinct)) / static_cast<double>(distinct);
+        if (error > BOUND) {
+            std::cerr << "  " << distinct << " distinct estimated as " << sketch.estimate() << std::endl;
+            within = false;
+        }
+    }
+    check(within, "distinct estimates are within the error bound");
+
+    HyperLogLog left;
+    HyperLogLog right;
+    HyperLogLog both;
+    for (std::uint64_t i = 0; i < 300000; ++i) {
+        (i % 3 == 0 ? left : right).add(sketchHash(i));
+        both.add(sketchHash(i));
+        left.add(sketchHash(i % 1000)); // overlap between the halves
+    }
+    left.merge(right);
+    check(left.estimate() == both.estimate(), "a merged sketch equals one fed every item");
+    check(HyperLogLog().estimate() == 0.0, "an empty sketch estimates zero");
+}
+
+// On a skewed stream the heavy hitters are the true top keys, and every
+// count is at least the true count and at most e / WIDTH of the stream over.
+static void heavyHittersFindTheTopKeys() {
+    std::mt19937 rng(17);
+    std::map<std::uint64_t, std::uint64_t> exact;
+    HeavyHitters first(32);
+    HeavyHitters second(32);
+    const std::size_t STREAM = 400000;
+    for (std::size_t i = 0; i < STREAM; ++i) {
+        // Zipf-like: key k has weight ~ 1/k over 100k keys.
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        std::uint64_t key = static_cast<std::uint64_t>(std::exp(u * std::log(100000.0)));
+        ++exact[key];
+        (i % 2 == 0 ? first : second).offer(sketchHash(key), [key](std::string& label) {
+            label = std::to_string(key);
+        });
+    }
+    first.merge(second);
+    check(first.totalCount() == STREAM, "the merged summary counts the whole stream");
+
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> truth(exact.begin(), exact.end());
+    std::sort(truth.begin(), truth.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    std::vector<HeavyHitter> top = first.top(10);
+    bool sameKeys = top.size() == 10;
+    bool bounded = true;
+    const double OVERSHOOT = std::exp(1.0) / HeavyHitters::WIDTH * STREAM;
+    for (std::size_t i = 0; i < top.size(); ++i) {
+        std::uint64_t key = std::stoull(top[i].label);
+        std::uint64_t count = exact[key];
+        sameKeys = sameKeys && top[i].key == sketchHash(key) && count >= truth[9].second;
+        bounded = bounded && top[i].count >= count && static_cast<double>(top[i].count - count) <= OVERSHOOT;
+    }
+    check(sameKeys, "the top ten candidates are the ten most frequent keys");
+    check(bounded, "estimated counts overshoot by at most e / WIDTH of the stream");
+    check(top.size() < 2 || top[0].count >= top[1].count, "top() is ordered by count");
+}
+
+// Quantiles are within 2% rank of the exact ones, for one sketch and for
+// a merge of several.
+static void kllWithinRankError() {
+    std::mt19937 rng(8);
+    std::lognormal_distribution<double> fares(3.0, 0.6);
+    std::vector<double> values;
+    KllSketch whole(200);
+    std::vector<KllSketch> shards(4, KllSketch(200));
+    for (int i = 0; i < 300000; ++i) {
+        double fare = fares(rng);
+        values.push_back(fare);
+        whole.add(fare);
+        shards[static_cast<std::size_t>(i) % shards.size()].add(fare);
+    }
+    KllSketch merged(200);
+    for (const KllSketch& shard : shards) {
+        merged.merge(shard);
+    }
+    std::sort(values.begin(), values.end());
+    auto rankOf = [&values](double value) {
+        return static_cast<double>(std::upper_bound(values.begin(), values.end(), value) - values.begin()) /
+               static_cast<double>(values.size());
+    };
+    bool within = true;
+    for (double q : {0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99}) {
+        within = within && std::fabs(rankOf(whole.quantile(q)) - q) <= 0.02 &&
+                 std::fabs(rankOf(merged.quantile(q)) - q) <= 0.02;
+    }
+    check(within, "quantiles are within 2% rank of the exact ones");
+    check(whole.count() == values.size() && merged.count() == values.size(), "counts cover the stream");
+    check(whole.retained() < 2000, "memory stays bounded");
+    check(whole.quantile(1.0) == values.back(), "the maximum is exact");
+}
+
+int main() {
+    hyperLogLogWithinErrorBound();
+    heavyHittersFindTheTopKeys();
+    kllWithinRankError();
+    return testResult("sketches_test");
+}
@@ -0,0 +1,119 @@
+// surge_engine_test.cpp - SurgeEngine multipliers and the engine's surge wiring
+//
+// Run through ctest, or directly: ./surge_engine_test (exit status 0 = pass).
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "SurgeEngine.h"
+#include "RideEngine.h"
+#include "QuietOutput.h"
+#include "TestCheck.h"
+
+static bool near(double a, double b) {
+    return std::fabs(a - b) < 1e-9;
+}
+
+static void requests(SurgeEngine& surge, std::size_t zone, int n) {
+    for (int i = 0; i < n; ++i) {
+        surge.recordRequest(zone);
+    }
+}
+
+// multiplier = 1 + sensitivity * (demand / max(free, 1) - threshold),
+// clamped to [1, max]; a zone with no free drivers counts as one.
+static void multiplierFollowsPressure() {
+    SurgeConfig config;
+    config.smoothing = 1.0; // demand = the last window's requests
+    config.step = 0.0;
+    SurgeEngine surge(4, config);
+    for (int d = 0; d < 4; ++d) {
+        surge.driverFreed(1);
+    }
+    surge.driverFreed(2);
+    surge.driverTaken(2);
+    requests(surge, 0, 2);  // no drivers: pressure 2
+    requests(surge, 1, 10); // 4 drivers: pressure 2.5
+    requests(surge, 2, 2);  // driver taken again: pressure 2
+    requests(surge, 3, 50); // far past the cap
+    double peak = surge.update();
+    check(near(surge.multiplier(0), 1.75), "an empty zone divides by one driver");
+    check(near(surge.multiplier(1), 2.0), "demand is divided by the free drivers");
+    check(near(surge.multiplier(2), 1.75) && surge.freeDrivers(2) == 0, "taken drivers leave the supply");
+    check(near(surge.multiplier(3), config.maxMultiplier) && near(peak, config.maxMultiplier),
+          "the multiplier is capped and update() reports the peak");
+    surge.update();
+    check(near(surge.multiplier(0), 1.0), "an idle window falls back to no surge");
+}
+
+// Demand is an exponential moving average of the windows, and published
+// multipliers are rounded down to the step.
+static void demandIsSmoothedAndStepped() {
+    SurgeConfig config; // smoothing 0.3, step 0.05
+    SurgeEngine surge(1, config);
+    requests(surge, 0, 10);
+    surge.update(); // demand 3: 1 + 0.5 * 2.5 = 2.25
+    check(near(surge.multiplier(0), 2.25), "the first window counts at the smoothing weight");
+    surge.update(); // demand 2.1: 1.8, or 1.75 if rounding lands just below the step
+    double second = surge.multiplier(0);
+    check(second <= 1.8 + 1e-9 && second >= 1.75 - 1e-9, "demand decays between windows");
+    double steps = (second - 1.0) / config.step;
+    check(std::fabs(steps - std::round(steps)) < 1e-6, "multipliers sit on the step grid");
+}
+
+// The epoch moves only when some multiplier changed.
+static void epochCountsChanges() {
+    SurgeEngine surge(2);
+    surge.update();
+    check(surge.epoch() == 0, "a quiet update keeps the epoch");
+    requests(surge, 1, 20);
+    surge.update();
+    check(surge.epoch() == 1, "a changed multiplier bumps the epoch");
+}
+
+// Counters are plain atomic adds, so concurrent feeders lose nothing.
+static void concurrentRequestsAllCount() {
+    SurgeConfig config;
+    config.smoothing = 1.0;
+    config.step = 0.0;
+    config.maxMultiplier = 1e9;
+    SurgeEngine surge(1, config);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&surge] { requests(surge, 0, 25000); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    surge.update();
+    check(near(surge.multiplier(0), 1.0 + 0.5 * (100000 - 0.5)), "every concurrent request is counted");
+}
+
+// Through RideEngine: demand from requestRide raises the pickup zone's
+// fares once the engine's surge clock ticks.
+static void engineSurgesBusyZones() {
+    QuietCout quiet; // requestRide prints every ride
+    SurgeEngine surge(ENGINE_SURGE_ZONES);
+    RideEngine engine;
+    engine.setSurge(&surge, 1000);
+    RiderHandle rider = engine.addRider(0, "R1", "Alice");
+    double calm = engine.quote(0, RideType::Standard, "Stadium", "Mall", 5.0);
+    for (int i = 0; i < 40; ++i) {
+        engine.requestRide(10 * i, rider, RideType::Standard, "T" + std::to_string(i), "Stadium", "Mall", 5.0);
+    }
+    double busy = engine.quote(1500, RideType::Standard, "Stadium", "Mall", 5.0);
+    double elsewhere = engine.quote(1500, RideType::Standard, "Suburb", "Mall", 5.0);
+    check(busy > calm, "a busy pickup zone surges after a tick");
+    check(surge.epoch() >= 1, "the engine runs update() on its call clock");
+    check(near(elsewhere, calm), "other zones keep their fares");
+}
+
+int main() {
+    multiplierFollowsPressure();
+    demandIsSmoothedAndStepped();
+    epochCountsChanges();
+    concurrentRequestsAllCount();
+    engineSurgesBusyZones();
+    return testResult("surge_engine_test");
+}
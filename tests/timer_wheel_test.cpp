@@ -0,0 +1,140 @@
+// timer_wheel_test.cpp - TimerWheel cascading and cancellation, RideTimeouts expiry
+//
+// Build:  g++ -O2 -std=c++17 -I. tests/timer_wheel_test.cpp -o timer_wheel_test
+// Run through ctest, or directly: ./timer_wheel_test (exit status 0 = pass).
+
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "TimerWheel.h"
+#include "RideTimeouts.h"
+#include "TestCheck.h"
+
+// Timers on every level fire on their exact tick once cascaded down, and a
+// cancelled timer never fires.
+static void cascadeFiresOnTime() {
+    TimerWheel wheel(1000);
+    const std::uint64_t DELAYS[] = {1, 255, 256, 257, 65535, 65536, 65537, 300000, (1u << 24) - 1, (1u << 24) + 3};
+    std::map<std::uint64_t, std::uint64_t> due; // payload -> expiry tick
+    for (std::uint64_t delay : DELAYS) {
+        wheel.schedule(delay, delay);
+        due[delay] = 1000 + delay;
+    }
+    TimerWheel::TimerId cancelled = wheel.schedule(70000, 12345);
+    check(wheel.size() == due.size() + 1, "every timer is armed");
+    check(wheel.cancel(cancelled), "an armed timer cancels");
+    check(!wheel.cancel(cancelled), "a timer cancels once");
+
+    bool onTime = true;
+    std::size_t fired = 0;
+    // Advance in uneven steps so cascades happen both inside and at the end of a step.
+    std::uint64_t now = 1000;
+    while (now < 1000 + (1u << 24) + 10) {
+        now += 1 + (now % 7919);
+        wheel.advance(now, [&](std::uint64_t payload) {
+            onTime = onTime && due.count(payload) != 0 && due[payload] == wheel.now();
+            ++fired;
+        });
+    }
+    check(onTime, "each timer fires on its expiry tick");
+    check(fired == due.size(), "every armed timer fires exactly once");
+    check(wheel.size() == 0, "nothing left armed");
+}
+
+// Random schedules and cancels against a brute-force list of deadlines,
+// including callbacks that arm new timers.
+static void randomTimersMatchDeadlines() {
+    TimerWheel wheel(0);
+    std::mt19937 rng(11);
+    std::map<std::uint64_t, std::uint64_t> due; // payload -> expiry
+    std::map<std::uint64_t, TimerWheel::TimerId> ids;
+    std::uint64_t nextPayload = 1;
+    bool onTime = true;
+    std::size_t fired = 0;
+    auto onExpire = [&](std::uint64_t payload) {
+        auto it = due.find(payload);
+        onTime = onTime && it != due.end() && it->second == wheel.now();
+        if (it != due.end()) {
+            due.erase(it);
+        }
+        ids.erase(payload);
+        ++fired;
+        if (payload % 5 == 0) { // re-arm from inside the callback
+            std::uint64_t delay = 1 + rng() % 70000;
+            ids[nextPayload] = wheel.schedule(delay, nextPayload);
+            due[nextPayload++] = wheel.now() + delay;
+        }
+    };
+    for (int round = 0; round < 200; ++round) {
+        for (int i = 0; i < 50; ++i) {
+            std::uint64_t delay = 1 + rng() % (rng() % 2 ? 300 : 200000);
+            ids[nextPayload] = wheel.schedule(delay, nextPayload);
+            due[nextPayload++] = wheel.now() + delay;
+        }
+        for (int i = 0; i < 10 && !ids.empty(); ++i) {
+            auto it = ids.begin();
+            std::advance(it, rng() % ids.size());
+            onTime = onTime && wheel.cancel(it->second);
+            due.erase(it->first);
+            ids.erase(it);
+        }
+        wheel.advance(wheel.now() + rng() % 5000, onExpire);
+    }
+    wheel.advance(wheel.now() + 400000, onExpire);
+    check(onTime, "random timers fire on time and cancels succeed");
+    check(due.empty() && wheel.size() == 0, "every uncancelled timer fired");
+    check(fired > 0, "timers fired");
+}
+
+// A handle to a recycled node must not cancel the node's new timer.
+static void staleHandleIsRejected() {
+    TimerWheel wheel(0);
+    TimerWheel::TimerId first = wheel.schedule(10, 1);
+    wheel.advance(10, [](std::uint64_t) {});
+    TimerWheel::TimerId second = wheel.schedule(10, 2); // reuses the node
+    check(!wheel.cancel(first), "a fired timer's handle is stale");
+    check(wheel.size() == 1, "the new timer is still armed");
+    check(wheel.cancel(second), "the new handle cancels");
+    check(!wheel.cancel(TimerWheel::INVALID_TIMER), "the invalid handle cancels nothing");
+}
+
+// Rides are cancelled when the state they wait in times out, re-armed as
+// they advance, and left alone once they move on.
+static void rideTimeoutsFollowTheLifecycle() {
+    TimeoutPolicy policy;
+    RideTimeouts timeouts(0, policy);
+    std::vector<const Ride*> expired;
+    timeouts.setExpiryHandler([&expired](Ride& ride, TimeoutKind) { expired.push_back(&ride); });
+
+    StandardRide unmatched("T1", "Park", "Mall", 3.0, 0);
+    StandardRide accepted("T2", "Park", "Mall", 3.0, 0);
+    StandardRide movedOn("T3", "Park", "Mall", 3.0, 0);
+    timeouts.track(unmatched, 0);
+    timeouts.track(accepted, 0);
+    timeouts.track(movedOn, 0);
+    timeouts.advanceRide(accepted, RideStatus::Matched, 1000);
+    timeouts.advanceRide(accepted, RideStatus::EnRoute, 2000);
+    movedOn.transitionTo(RideStatus::Matched, 1000); // bypasses the tracker
+
+    timeouts.tick(policy.matchTimeoutMs);
+    check(unmatched.getStatus() == RideStatus::Cancelled, "an unmatched ride is cancelled at the match timeout");
+    check(movedOn.getStatus() == RideStatus::Matched, "a ride that left the waited-in state is not cancelled");
+    check(accepted.getStatus() == RideStatus::EnRoute, "a re-armed ride waits for its new deadline");
+    check(expired.size() == 1 && expired[0] == &unmatched, "the handler sees only the cancelled ride");
+    check(!timeouts.isPending(movedOn) && timeouts.isPending(accepted), "pending set follows the rides");
+
+    timeouts.advanceRide(accepted, RideStatus::InProgress, 3000);
+    timeouts.tick(2000 + policy.noShowTimeoutMs + 1);
+    check(accepted.getStatus() == RideStatus::InProgress && timeouts.pendingCount() == 0,
+          "a picked-up ride is no longer pending");
+}
+
+int main() {
+    cascadeFiresOnTime();
+    randomTimersMatchDeadlines();
+    staleHandleIsRejected();
+    rideTimeoutsFollowTheLifecycle();
+    return testResult("timer_wheel_test");
+}
@@ -0,0 +1,117 @@
+// traffic_log_test.cpp - TrafficLog round trip and RideEngine replay digests
+//
+// Run through ctest, or directly: ./traffic_log_test (exit status 0 = pass).
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "RideEngine.h"
+#include "TrafficLog.h"
+#include "QuietOutput.h"
+#include "TestCheck.h"
+
+static const char* LOG_PATH = "traffic_log_test.rstl";
+
+// A short session through every entry point, with one call on a bad handle.
+static void drive(RideEngine& engine) {
+    RiderHandle alice = engine.addRider(1000, "R1", "Alice");
+    DriverHandle bob = engine.addDriver(900, "D1", "Bob", 4.8); // clock runs backwards
+    for (int i = 0; i < 50; ++i) {
+        TimestampMs at = 2000 + 37 * i;
+        std::string pickup = "Stop" + std::to_string(i % 7);
+        engine.quote(at, i % 2 ? RideType::Premium : RideType::Standard, pickup, "Airport", 1.5 + i);
+        engine.requestRide(at, alice, RideType::Standard, "RR" + std::to_string(i), pickup, "Airport", 2.25 * i);
+        engine.addRide(at + 1, bob, RideType::Premium, "DR" + std::to_string(i), "Airport", pickup, 0.5 + i);
+    }
+    check(engine.requestRide(9000, 7, RideType::Standard, "X", "Park", "Mall", 1.0) == RideEngine::REJECTED,
+          "an unknown rider handle is rejected");
+    check(engine.addRide(9000, 7, RideType::Standard, "X", "Park", "Mall", 1.0) == RideEngine::REJECTED,
+          "an unknown driver handle is rejected");
+}
+
+// Replaying a recorded session reproduces its calls and digest exactly;
+// rejected calls are neither recorded nor digested.
+static void replayReproducesDigest() {
+    QuietCout quiet; // requestRide prints every ride
+    RideEngine live;
+    TrafficRecorder recorder;
+    check(recorder.open(LOG_PATH), "the log opens for writing");
+    live.setRecorder(&recorder);
+    drive(live);
+    check(recorder.close(), "the log closes cleanly");
+    check(recorder.recordedCalls() == 152 && live.callCount() == 152, "only accepted calls are recorded");
+
+    TrafficReader reader;
+    check(reader.open(LOG_PATH), "the log opens for reading");
+    RideEngine replayed;
+    TrafficCall call;
+    std::vector<TrafficCall> calls;
+    bool applied = true;
+    while (reader.next(call)) {
+        applied = replayed.apply(call) && applied;
+        calls.push_back(call);
+    }
+    check(applied && !reader.isCorrupt(), "every recorded call replays");
+    check(replayed.callCount() == live.callCount(), "the replay makes the same number of calls");
+    check(replayed.digest() == live.digest(), "the replay reproduces the digest");
+    check(calls.size() == 152 && calls[1].op == TrafficOp::AddDriver && calls[1].timestamp == 900 &&
+              calls[1].rating == 4.8 && calls[1].name == "Bob",
+          "a negative timestamp delta and a rating decode exactly");
+    check(calls[4].op == TrafficOp::AddRide && calls[4].id == "DR0" && *calls[4].pickup == "Airport" &&
+              *calls[4].dropoff == "Stop0" && calls[4].distance == 0.5,
+          "ride fields decode exactly");
+    check(replayed.rider(0).getRideCount() == 50, "the replayed rider has every ride");
+}
+
+// The digest covers more than fares: the same fares on a different route,
+// or a different ride ID, change it.
+static void digestCoversRideIdentity() {
+    QuietCout quiet;
+    auto digestOf = [](const std::string& rideID, const std::string& dropoff) {
+        RideEngine engine;
+        RiderHandle rider = engine.addRider(0, "R1", "Alice");
+        engine.requestRide(0, rider, RideType::Standard, rideID, "Park", dropoff, 3.0);
+        return engine.digest();
+    };
+    std::uint64_t base = digestOf("A", "Mall");
+    check(digestOf("A", "Mall") == base, "the digest is deterministic");
+    check(digestOf("B", "Mall") != base, "the ride ID is digested");
+    check(digestOf("A", "Zoo") != base, "the route is digested");
+}
+
+// A truncated log stops at the last whole record and reports corruption;
+// a file that is not a traffic log does not open.
+static void truncatedLogIsCorrupt() {
+    std::FILE* file = std::fopen(LOG_PATH, "rb");
+    std::vector<char> bytes(1 << 16);
+    std::size_t size = file != nullptr ? std::fread(bytes.data(), 1, bytes.size(), file) : 0;
+    if (file != nullptr) {
+        std::fclose(file);
+    }
+    file = std::fopen(LOG_PATH, "wb");
+    std::fwrite(bytes.data(), 1, size - 3, file);
+    std::fclose(file);
+
+    TrafficReader reader;
+    TrafficCall call;
+    std::size_t decoded = 0;
+    check(reader.open(LOG_PATH), "a truncated log still opens");
+    while (reader.next(call)) {
+        ++decoded;
+    }
+    check(reader.isCorrupt() && decoded == 151, "decoding stops at the torn record");
+
+    file = std::fopen(LOG_PATH, "wb");
+    std::fputs("not a traffic log", file);
+    std::fclose(file);
+    check(!reader.open(LOG_PATH), "a file without the magic is refused");
+    std::remove(LOG_PATH);
+}
+
+int main() {
+    replayReproducesDigest();
+    digestCoversRideIdentity();
+    truncatedLogIsCorrupt();
+    return testResult("traffic_log_test");
+}
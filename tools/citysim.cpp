@@ -0,0 +1,185 @@
+// citysim.cpp - Discrete-event city simulation for capacity planning
+//
+// Build:  g++ -O2 -std=c++17 -I. tools/citysim.cpp -o citysim -pthread
+// Run:    ./citysim [--seed N] [--riders N] [--drivers N] [--locations N]
+//                   [--rate N] [--hours H] [--grid N] [--speed MPH]
+//                   [--partitions N] [--metrics-port N] [--surge] [--leaderboard K]
+//                   [--sketches]
+//
+// Simulates --hours of virtual city traffic from midnight (--rate is the
+// daily mean request rate; demand follows the diurnal curve) and reports
+// served, cancelled and revenue figures, rider wait times and driver
+// utilisation, plus how fast the simulation ran. The same arguments always
+// give the same results. --partitions N splits the city into N independent
+// districts simulated on N threads. --surge prices rides with per-region
+// surge multipliers driven by live demand and free drivers. --metrics-port serves Prometheus
+// metrics (ride counters, per-district queue depths and driver availability)
+// on http://127.0.0.1:N/metrics while the simulation runs. --leaderboard
+// keeps per-region driver leaderboards as trips complete and prints the top
+// K drivers by rating, earnings and rides on the last simulated day in the
+// region with the most drivers (single partition only). --sketches feeds
+// every request to per-district sketches, merges them and prints distinct
+// riders, the busiest routes and fare percentiles.
+
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include "CitySimulator.h"
+#include "QuietOutput.h"
+#include "MetricsServer.h"
+
+struct CitysimOptions {
+    SimulationConfig simulation;
+    std::size_t partitions = 1;
+    int metricsPort = -1;
+    std::size_t leaderboardSize = 0;
+};
+
+static bool parseArgs(int argc, char** argv, CitysimOptions& options) {
+    SimulationConfig& sim = options.simulation;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--surge") == 0) {
+            sim.surge = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--sketches") == 0) {
+            sim.sketches = true;
+            continue;
+        }
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr) {
+            return false;
+        }
+        if (std::strcmp(arg, "--seed") == 0) {
+            sim.workload.seed = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--riders") == 0) {
+            sim.workload.riderCount = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--drivers") == 0) {
+            sim.workload.driverCount = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--locations") == 0) {
+            sim.workload.locationCount = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--rate") == 0) {
+            sim.workload.requestsPerSecond = std::strtod(value, nullptr);
+        } else if (std::strcmp(arg, "--hours") == 0) {
+            sim.durationMs = static_cast<TimestampMs>(std::strtod(value, nullptr) * 3600.0 * 1000.0);
+        } else if (std::strcmp(arg, "--grid") == 0) {
+            sim.gridSize = static_cast<std::uint32_t>(std::strtoul(value, nullptr, 10));
+        } else if (std::strcmp(arg, "--speed") == 0) {
+            sim.speedMph = std::strtod(value, nullptr);
+        } else if (std::strcmp(arg, "--partitions") == 0) {
+            options.partitions = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--leaderboard") == 0) {
+            options.leaderboardSize = std::strtoull(value, nullptr, 10);
+            sim.leaderboards = options.leaderboardSize > 0;
+        } else if (std::strcmp(arg, "--metrics-port") == 0) {
+            options.metricsPort = std::atoi(value);
+            if (options.metricsPort < 0 || options.metricsPort > 65535) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return sim.workload.riderCount > 0 && sim.workload.driverCount > 0 && sim.workload.locationCount > 1 &&
+           sim.workload.requestsPerSecond > 0.0 && sim.gridSize > 0 && sim.speedMph > 0.0 && options.partitions > 0 &&
+           (options.leaderboardSize == 0 || options.partitions == 1);
+}
+
+int main(int argc, char** argv) {
+    CitysimOptions options;
+    // A mid-sized city by default; the simulation keeps every ride in memory.
+    options.simulation.workload.riderCount = 200000;
+    options.simulation.workload.driverCount = 20000;
+    options.simulation.workload.requestsPerSecond = 10.0;
+    if (!parseArgs(argc, argv, options)) {
+        std::cerr << "usage: " << argv[0] << " [--seed N] [--riders N] [--drivers N] [--locations N]"
+                  << " [--rate N] [--hours H] [--grid N] [--speed MPH] [--partitions N]"
+                  << " [--metrics-port N] [--surge] [--leaderboard K]"
+                  << " [--sketches]" << std::endl;
+        return 2;
+    }
+
+    MetricsServer metricsServer;
+    if (options.metricsPort >= 0) {
+        if (!metricsServer.start(static_cast<std::uint16_t>(options.metricsPort))) {
+            std::cerr << "cannot serve metrics on port " << options.metricsPort << std::endl;
+            return 1;
+        }
+        std::fprintf(stderr, "metrics: http://127.0.0.1:%u/metrics\n", static_cast<unsigned>(metricsServer.port()));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    SimulationStats stats;
+    std::unique_ptr<CitySimulator> ranked; // kept after the run for --leaderboard
+    {
+        QuietCout quiet; // requestRide prints every ride
+        if (options.leaderboardSize > 0) {
+            ranked = std::make_unique<CitySimulator>(options.simulation);
+            stats = ranked->run();
+        } else {
+            stats = runPartitioned(options.simulation, options.partitions);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double hours = stats.simulatedMs / 3600000.0;
+    std::printf("simulated:       %.2f h in %.3f s wall (%.0fx real time)\n", hours, seconds,
+                stats.simulatedMs / 1000.0 / seconds);
+    std::printf("partitions:      %zu\n", options.partitions);
+    std::printf("events:          %llu (%.2f M events/s in the event loop)\n",
+                static_cast<unsigned long long>(stats.events), stats.events / stats.loopSeconds / 1e6);
+    std::printf("requested:       %llu (%llu premium)\n", static_cast<unsigned long long>(stats.requested),
+                static_cast<unsigned long long>(stats.premium));
+    std::printf("completed:       %llu\n", static_cast<unsigned long long>(stats.completed));
+    std::printf("cancelled:       %llu (no driver within the match timeout)\n",
+                static_cast<unsigned long long>(stats.cancelled));
+    std::printf("revenue:         $%.2f\n", stats.revenue);
+    if (options.simulation.surge) {
+        std::printf("surge:           %llu requests surged (%.1f%%), peak %.2fx\n",
+                    static_cast<unsigned long long>(stats.surged),
+                    stats.requested == 0 ? 0.0 : 100.0 * stats.surged / stats.requested, stats.peakSurge);
+    }
+    if (options.simulation.sketches) {
+        const RideSketches& sketches = stats.sketches;
+        std::printf("distinct riders: ~%.0f (HyperLogLog)\n", sketches.riders.estimate());
+        std::printf("fare p50/p90/p99: $%.2f / $%.2f / $%.2f (KLL)\n", sketches.fares.quantile(0.5),
+                    sketches.fares.quantile(0.9), sketches.fares.quantile(0.99));
+        std::printf("top routes (Count-Min):\n");
+        for (const HeavyHitter& route : sketches.routes.top(5)) {
+            std::printf("  %-28s ~%llu\n", route.label.c_str(), static_cast<unsigned long long>(route.count));
+        }
+    }
+    std::printf("mean rating:     %.2f stars (riders rate by wait time)\n", stats.meanRating());
+    std::printf("mean wait:       %.1f s (request to pickup)\n", stats.meanWaitSeconds());
+    std::printf("utilisation:     %.1f%% of %zu drivers\n", stats.driverUtilisation() * 100.0, stats.driverCount);
+
+    if (ranked != nullptr) {
+        const DriverLeaderboards& boards = ranked->getLeaderboards();
+        const DriverPool& pool = ranked->getPool();
+        std::uint32_t region = 0;
+        for (std::uint32_t r = 1; r < boards.regionCount(); ++r) {
+            region = boards.driversIn(r) > boards.driversIn(region) ? r : region;
+        }
+        const SimulationConfig& sim = options.simulation;
+        std::int64_t day = dayOf(sim.workload.startTime + sim.durationMs - 1);
+        std::printf("leaderboards:    region %u (%zu drivers)\n", region, boards.driversIn(region));
+        auto row = [&pool](const char* format) {
+            return [&pool, format](DriverIndex d, double value) {
+                std::printf(format, pool.driverAt(d).getName().c_str(), value);
+            };
+        };
+        std::printf("  by rating:\n");
+        boards.topByRating(region, options.leaderboardSize, row("    %-14s %.2f stars\n"));
+        std::printf("  by earnings today:\n");
+        boards.topByEarnings(region, day, options.leaderboardSize, row("    %-14s $%.2f\n"));
+        std::printf("  by rides today:\n");
+        boards.topByRides(region, day, options.leaderboardSize, row("    %-14s %.0f rides\n"));
+    }
+    return 0;
+}
@@ -0,0 +1,348 @@
+// loadgen.cpp - Drive the ride APIs with a synthetic city-scale workload
+//
+// Build:  g++ -O2 -std=c++17 -I. tools/loadgen.cpp AllocTracker.cpp -o loadgen
+//         (add -DRIDESHARE_TRACK_ALLOCATIONS for --alloc-report)
+// Run:    ./loadgen [--seed N] [--riders N] [--drivers N] [--locations N]
+//                   [--requests N] [--rate N] [--zipf S] [--premium F] [--latency]
+//                   [--trace FILE] [--alloc-report] [--record FILE] [--metrics-port N]
+//                   [--pricing RULES] [--quote-cache N] [--history N] [--archive FILE]
+//                   [--sketches] [--surge]
+//
+// --rate is the wall-clock target in requests per second (0 = as fast as
+// possible). The workload itself (who rides where, and when in virtual time)
+// depends only on the seed and the shape options, so two runs with the same
+// arguments issue exactly the same calls. --latency records per-call
+// latency histograms for requestRide/addRide and prints their percentiles.
+// --trace records spans for the run and writes the most recent ones as
+// Chrome trace-event JSON to FILE. --alloc-report prints heap allocations
+// per subsystem (ride creation, history, reporting, dispatch) for the run.
+// --record writes every engine call (including rider and driver setup) to a
+// binary traffic log that tools/replay.cpp can feed back; the digest printed
+// at the end must match the replay's. --metrics-port serves Prometheus
+// metrics on http://127.0.0.1:N/metrics while the run lasts. --pricing
+// prices quotes and rides with a rule file (see PricingRules.h and
+// config/pricing.rules); the quoted and charged totals are reported. --quote-cache serves
+// repeated quotes from an N-entry cache and reports its hit rate. --history
+// keeps only the N most recent rides per rider and driver in full and folds
+// older ones into per-entity summaries; --archive appends the folded rides
+// to a ride archive file (see RideHistory.h). --sketches feeds every request
+// to fixed-memory sketches and prints distinct riders, the busiest routes
+// and fare percentiles (see Sketches.h). --surge prices quotes and rides with
+// per-zone surge driven by the engine's own calls (RideEngine::setSurge());
+// replay a recording made with it using replay --surge.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Ride.h"
+#include "Driver.h"
+#include "Rider.h"
+#include "RideEngine.h"
+#include "TrafficLog.h"
+#include "RideHistory.h"
+#include "Sketches.h"
+#include "PricingRules.h"
+#include "DriverPool.h"
+#include "Workload.h"
+#include "QuietOutput.h"
+#include "LatencyHistogram.h"
+#include "Trace.h"
+#include "AllocTracker.h"
+#include "Metrics.h"
+#include "MetricsServer.h"
+
+struct LoadgenOptions {
+    WorkloadConfig workload;
+    std::size_t requests = 1000000;
+    double wallRate = 0.0;
+    bool latency = false;
+    std::string tracePath;
+    bool allocReport = false;
+    std::string recordPath;
+    int metricsPort = -1;
+    std::string pricingPath;
+    std::size_t quoteCacheEntries = 0;
+    std::size_t historyRides = 0;
+    std::string archivePath;
+    bool sketches = false;
+    bool surge = false;
+};
+
+static bool parseArgs(int argc, char** argv, LoadgenOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--latency") == 0) {
+            options.latency = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--alloc-report") == 0) {
+            options.allocReport = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--sketches") == 0) {
+            options.sketches = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--surge") == 0) {
+            options.surge = true;
+            continue;
+        }
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr) {
+            return false;
+        }
+        if (std::strcmp(arg, "--seed") == 0) {
+            options.workload.seed = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--riders") == 0) {
+            options.workload.riderCount = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--drivers") == 0) {
+            options.workload.driverCount = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--locations") == 0) {
+            options.workload.locationCount = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--requests") == 0) {
+            options.requests = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--rate") == 0) {
+            options.wallRate = std::strtod(value, nullptr);
+        } else if (std::strcmp(arg, "--zipf") == 0) {
+            options.workload.zipfExponent = std::strtod(value, nullptr);
+        } else if (std::strcmp(arg, "--premium") == 0) {
+            options.workload.premiumShare = std::strtod(value, nullptr);
+        } else if (std::strcmp(arg, "--trace") == 0) {
+            options.tracePath = value;
+        } else if (std::strcmp(arg, "--record") == 0) {
+            options.recordPath = value;
+        } else if (std::strcmp(arg, "--quote-cache") == 0) {
+            options.quoteCacheEntries = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--history") == 0) {
+            options.historyRides = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--archive") == 0) {
+            options.archivePath = value;
+        } else if (std::strcmp(arg, "--pricing") == 0) {
+            options.pricingPath = value;
+        } else if (std::strcmp(arg, "--metrics-port") == 0) {
+            options.metricsPort = std::atoi(value);
+            if (options.metricsPort < 0 || options.metricsPort > 65535) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return options.workload.riderCount > 0 && options.workload.driverCount > 0 && options.workload.locationCount > 1;
+}
+
+int main(int argc, char** argv) {
+    LoadgenOptions options;
+    if (!parseArgs(argc, argv, options)) {
+        std::cerr << "usage: " << argv[0] << " [--seed N] [--riders N] [--drivers N] [--locations N]"
+                  << " [--requests N] [--rate N] [--zipf S] [--premium F] [--latency] [--trace FILE] [--alloc-report] [--record FILE]"
+                  << " [--metrics-port N] [--pricing RULES] [--quote-cache N] [--history N] [--archive FILE]"
+                  << " [--sketches] [--surge]" << std::endl;
+        return 2;
+    }
+    const WorkloadConfig& cfg = options.workload;
+
+    TrafficRecorder recorder;
+    RideEngine engine;
+    if (!options.recordPath.empty()) {
+        if (!recorder.open(options.recordPath)) {
+            std::cerr << "cannot write " << options.recordPath << std::endl;
+            return 1;
+        }
+        engine.setRecorder(&recorder);
+    }
+
+    PricingRuleSet rules;
+    std::string pricingError;
+    if (!options.pricingPath.empty() && !rules.load(options.pricingPath, pricingError)) {
+        std::cerr << options.pricingPath << ": " << pricingError << std::endl;
+        return 1;
+    }
+    PricingTable pricing(rules);
+    if (!options.pricingPath.empty()) {
+        engine.setPricing(&pricing);
+    }
+
+    QuoteCache quoteCache(options.quoteCacheEntries > 0 ? options.quoteCacheEntries : 1);
+    if (options.quoteCacheEntries > 0) {
+        engine.setQuoteCache(&quoteCache);
+    }
+
+    SurgeEngine surge(ENGINE_SURGE_ZONES);
+    if (options.surge) {
+        engine.setSurge(&surge);
+    }
+
+    RideArchive archive;
+    if (!options.archivePath.empty() && !archive.open(options.archivePath)) {
+        std::cerr << "cannot write " << options.archivePath << std::endl;
+        return 1;
+    }
+    if (options.historyRides > 0) {
+        RideHistoryPolicy history;
+        history.recentRides = options.historyRides;
+        history.archive = archive.isOpen() ? &archive : nullptr;
+        engine.setHistoryPolicy(history);
+    }
+
+    RideSketches sketches;
+    if (options.sketches) {
+        engine.setSketches(&sketches);
+    }
+
+    MetricsServer metricsServer;
+    if (options.metricsPort >= 0) {
+        if (!metricsServer.start(static_cast<std::uint16_t>(options.metricsPort))) {
+            std::cerr << "cannot serve metrics on port " << options.metricsPort << std::endl;
+            return 1;
+        }
+        std::fprintf(stderr, "metrics: http://127.0.0.1:%u/metrics\n", static_cast<unsigned>(metricsServer.port()));
+    }
+    ScopedGauge ridersGauge("rideshare_riders", "Riders registered with the engine.");
+    ScopedGauge driversOnlineGauge("rideshare_drivers_online", "Drivers logged in.");
+    ScopedGauge driversFreeGauge("rideshare_drivers_free", "Drivers online and not on a trip.");
+
+    AllocTracker::enable(options.allocReport);
+    auto setupStart = std::chrono::steady_clock::now();
+    WorkloadGenerator generator(cfg);
+    for (std::size_t i = 0; i < cfg.riderCount; ++i) {
+        engine.addRider(cfg.startTime, "R" + std::to_string(i), "Rider " + std::to_string(i));
+    }
+    DriverPool pool;
+    for (std::size_t i = 0; i < cfg.driverCount; ++i) {
+        DriverHandle handle = engine.addDriver(cfg.startTime, "D" + std::to_string(i), "Driver " + std::to_string(i),
+                                               4.0 + (i % 10) / 10.0);
+        pool.setOnline(pool.registerDriver(engine.driver(handle)), true);
+    }
+    ridersGauge.set(static_cast<double>(engine.riderCount()));
+    driversOnlineGauge.set(static_cast<double>(pool.onlineCount()));
+    driversFreeGauge.set(static_cast<double>(pool.freeCount()));
+    double setupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - setupStart).count();
+    std::fprintf(stderr, "setup: %zu riders, %zu drivers, %zu locations in %.2f s\n",
+                 cfg.riderCount, cfg.driverCount, cfg.locationCount, setupSeconds);
+
+    std::vector<std::size_t> pickupCounts(cfg.locationCount, 0);
+    std::size_t premiumCount = 0;
+    double quotedTotal = 0.0;
+    double chargedTotal = 0.0;
+    DriverIndex nextDriver = 0;
+    TimestampMs firstRequest = 0;
+    TimestampMs lastRequest = 0;
+
+    LatencyRecorder::setEnabled(options.latency);
+    if (!options.tracePath.empty()) {
+        Trace::start();
+    }
+    auto runStart = std::chrono::steady_clock::now();
+    {
+        QuietCout quiet; // requestRide prints every ride
+        for (std::size_t i = 0; i < options.requests; ++i) {
+            RideRequestEvent event = generator.next();
+            if (i == 0) {
+                firstRequest = event.timestamp;
+            }
+            lastRequest = event.timestamp;
+            const std::string& pickup = generator.locationName(event.pickup);
+            const std::string& dropoff = generator.locationName(event.dropoff);
+            std::string rideID = "L" + std::to_string(i);
+            RideType type = event.premium ? RideType::Premium : RideType::Standard;
+            premiumCount += event.premium ? 1 : 0;
+
+            // The rider sees a quote, then requests. As in the demo, the
+            // rider's request and the driver's completed ride are separate objects.
+            quotedTotal += engine.quote(event.timestamp, type, pickup, dropoff, event.distance);
+            chargedTotal += engine.requestRide(event.timestamp, event.riderIndex, type, rideID, pickup, dropoff,
+                                               event.distance);
+
+            // Round-robin over free drivers (pool indices match engine handles).
+            nextDriver = pool.findNextFree(nextDriver + 1);
+            if (nextDriver == INVALID_DRIVER_INDEX) {
+                nextDriver = pool.findNextFree(0);
+            }
+            engine.addRide(event.timestamp, nextDriver, type, rideID + "-C", pickup, dropoff, event.distance);
+            ++pickupCounts[event.pickup];
+
+            // Pace to the wall-clock target rate, checking every 1024 requests.
+            if (options.wallRate > 0.0 && (i & 1023) == 1023) {
+                auto target = runStart + std::chrono::duration<double>((i + 1) / options.wallRate);
+                std::this_thread::sleep_until(target);
+            }
+        }
+    }
+    double runSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+    if (!options.recordPath.empty() && !recorder.close()) {
+        std::cerr << "error writing " << options.recordPath << std::endl;
+        return 1;
+    }
+    if (!options.archivePath.empty() && !archive.close()) {
+        std::cerr << "error writing " << options.archivePath << std::endl;
+        return 1;
+    }
+    if (!options.tracePath.empty()) {
+        Trace::stop();
+        if (!Trace::writeChromeJson(options.tracePath)) {
+            std::cerr << "cannot write " << options.tracePath << std::endl;
+            return 1;
+        }
+    }
+
+    std::printf("requests:        %zu (%zu premium)\n", options.requests, premiumCount);
+    std::printf("wall time:       %.3f s\n", runSeconds);
+    std::printf("achieved rate:   %.0f requests/s\n", options.requests / runSeconds);
+    std::printf("quoted fares:    $%.2f%s\n", quotedTotal, options.pricingPath.empty() ? "" : " (pricing rules)");
+    std::printf("charged fares:   $%.2f%s\n", chargedTotal, options.pricingPath.empty() ? "" : " (pricing rules)");
+    if (options.quoteCacheEntries > 0) {
+        double hits = RideMetrics::quoteCacheHits.value();
+        double lookups = hits + RideMetrics::quoteCacheMisses.value();
+        std::printf("quote cache:     %.1f%% hits over %.0f lookups (%zu entries)\n",
+                    lookups == 0 ? 0.0 : 100.0 * hits / lookups, lookups, quoteCache.capacity());
+    }
+    if (options.surge) {
+        std::printf("surge:           %llu updates changed a multiplier (%zu zones)\n",
+                    static_cast<unsigned long long>(surge.epoch()), surge.zoneCount());
+    }
+    if (options.historyRides > 0) {
+        std::printf("history:         %zu recent rides kept per entity, %llu archived\n", options.historyRides,
+                    static_cast<unsigned long long>(archive.archivedRides()));
+    }
+    if (options.sketches) {
+        std::printf("distinct riders: ~%.0f (HyperLogLog)\n", sketches.riders.estimate());
+        std::printf("fare p50/p90/p99: $%.2f / $%.2f / $%.2f (KLL)\n", sketches.fares.quantile(0.5),
+                    sketches.fares.quantile(0.9), sketches.fares.quantile(0.99));
+        std::printf("top routes (Count-Min):\n");
+        for (const HeavyHitter& route : sketches.routes.top(5)) {
+            std::printf("  %-28s ~%llu\n", route.label.c_str(), static_cast<unsigned long long>(route.count));
+        }
+    }
+    std::printf("virtual span:    %.2f h\n", (lastRequest - firstRequest) / 3600000.0);
+    std::printf("engine digest:   %016llx (%llu calls)\n", static_cast<unsigned long long>(engine.digest()),
+                static_cast<unsigned long long>(engine.callCount()));
+    if (options.allocReport) {
+        std::printf("allocations:\n");
+        std::fflush(stdout);
+        AllocTracker::report(std::cout);
+    }
+    if (options.latency) {
+        std::printf("latency:\n");
+        HotPathLatency::dumpAll(std::cout);
+    }
+    std::vector<std::uint32_t> ranked(cfg.locationCount);
+    for (std::uint32_t i = 0; i < ranked.size(); ++i) ranked[i] = i;
+    std::size_t top = std::min<std::size_t>(5, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + top, ranked.end(),
+                      [&](std::uint32_t a, std::uint32_t b) { return pickupCounts[a] > pickupCounts[b]; });
+    std::printf("top pickups:\n");
+    for (std::size_t i = 0; i < top; ++i) {
+        std::printf("  %-12s %zu\n", generator.locationName(ranked[i]).c_str(), pickupCounts[ranked[i]]);
+    }
+    return 0;
+}
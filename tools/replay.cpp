@@ -0,0 +1,109 @@
+// replay.cpp - Feed a recorded traffic log back into the ride engine
+//
+// Build:  g++ -O2 -std=c++17 -I. tools/replay.cpp -o replay
+// Run:    ./replay FILE [--speed max|original] [--pricing RULES] [--surge]
+//
+// Reads a log written by `loadgen --record FILE` (or any RideEngine with a
+// TrafficRecorder attached) and runs every call through a fresh engine.
+// --speed max (the default) replays as fast as possible; --speed original
+// keeps the recorded gaps between calls. The digest printed at the end
+// depends only on the log, so two builds replaying the same file must print
+// the same digest; a difference means their results differ. --pricing
+// prices quotes and rides with a rule file; pass the one the recording used.
+// --surge turns on engine surge pricing, for logs recorded with loadgen --surge.
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+
+#include "RideEngine.h"
+#include "TrafficLog.h"
+#include "PricingRules.h"
+#include "QuietOutput.h"
+
+int main(int argc, char** argv) {
+    std::string path;
+    std::string pricingPath;
+    bool originalSpeed = false;
+    bool surgePricing = false;
+    bool usageError = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            std::string speed = argv[++i];
+            usageError |= speed != "max" && speed != "original";
+            originalSpeed = speed == "original";
+        } else if (std::strcmp(argv[i], "--pricing") == 0 && i + 1 < argc) {
+            pricingPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--surge") == 0) {
+            surgePricing = true;
+        } else if (path.empty() && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            usageError = true;
+        }
+    }
+    if (path.empty() || usageError) {
+        std::cerr << "usage: " << argv[0] << " FILE [--speed max|original] [--pricing RULES] [--surge]" << std::endl;
+        return 2;
+    }
+
+    TrafficReader reader;
+    if (!reader.open(path)) {
+        std::cerr << "cannot read traffic log " << path << std::endl;
+        return 1;
+    }
+
+    RideEngine engine;
+    PricingRuleSet rules;
+    std::string error;
+    if (!pricingPath.empty() && !rules.load(pricingPath, error)) {
+        std::cerr << pricingPath << ": " << error << std::endl;
+        return 1;
+    }
+    PricingTable pricing(rules);
+    if (!pricingPath.empty()) {
+        engine.setPricing(&pricing);
+    }
+    SurgeEngine surge(ENGINE_SURGE_ZONES);
+    if (surgePricing) {
+        engine.setSurge(&surge);
+    }
+    TrafficCall call;
+    std::uint64_t replayed = 0;
+    TimestampMs firstCall = 0;
+    TimestampMs lastCall = 0;
+    auto start = std::chrono::steady_clock::now();
+    {
+        QuietCout quiet; // requestRide prints every ride
+        while (reader.next(call)) {
+            if (replayed == 0) {
+                firstCall = call.timestamp;
+            }
+            lastCall = call.timestamp;
+            if (originalSpeed) {
+                std::this_thread::sleep_until(start + std::chrono::milliseconds(call.timestamp - firstCall));
+            }
+            if (!engine.apply(call)) {
+                std::cerr << "call " << replayed << " names an unknown rider or driver" << std::endl;
+                return 1;
+            }
+            ++replayed;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (reader.isCorrupt()) {
+        std::cerr << "traffic log is truncated or corrupt after " << replayed << " calls" << std::endl;
+        return 1;
+    }
+
+    std::printf("log:             %s (%.1f MB)\n", path.c_str(), reader.sizeBytes() / 1e6);
+    std::printf("calls:           %llu over %.2f h of recorded time\n", static_cast<unsigned long long>(replayed),
+                (lastCall - firstCall) / 3600000.0);
+    std::printf("wall time:       %.3f s (%.0f calls/s)\n", seconds, replayed / seconds);
+    std::printf("engine digest:   %016llx (%llu calls)\n", static_cast<unsigned long long>(engine.digest()),
+                static_cast<unsigned long long>(engine.callCount()));
+    return 0;
+}
@@ -0,0 +1,185 @@
+// ridequery.cpp - Analytics queries over a synthetic columnar ride history
+//
+// Build:  g++ -O2 -std=c++17 -I. tools/ridequery.cpp -o ridequery -pthread
+// Run:    ./ridequery [--seed N] [--rides N] [--days N] [--locations N] [--threads N]
+//                     [--group-by none|pickup|dropoff|type|status|day|hour]
+//                     [--type standard|premium] [--status completed|cancelled]
+//                     [--pickup NAME] [--dropoff NAME] [--last-days N]
+//                     [--min-distance MILES] [--max-distance MILES] [--limit N]
+//
+// Generates --rides rides spread over --days days with the load generator's
+// workload (one in twenty is cancelled) straight into a RideColumns table,
+// then runs one filter/group-by/aggregate query and prints the groups with
+// their ride count, total and average fare and average distance, plus the
+// best of three query times. Location groups are listed by total fare,
+// highest first; --limit caps the rows printed. --last-days keeps only
+// rides requested in the final N days of the history.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "RideQuery.h"
+#include "Workload.h"
+
+struct RidequeryOptions {
+    WorkloadConfig workload;
+    std::size_t rides = 10000000;
+    double days = 7.0;
+    unsigned threads = 0;
+    RideQuery query;
+    double lastDays = 0.0;
+    std::size_t limit = 20;
+};
+
+static bool parseGroupBy(const char* value, RideGroupBy& groupBy) {
+    static const struct {
+        const char* name;
+        RideGroupBy groupBy;
+    } NAMES[] = {
+        {"none", RideGroupBy::None}, {"pickup", RideGroupBy::Pickup}, {"dropoff", RideGroupBy::Dropoff},
+        {"type", RideGroupBy::Type}, {"status", RideGroupBy::Status}, {"day", RideGroupBy::Day},
+        {"hour", RideGroupBy::HourOfDay}
+    };
+    for (const auto& entry : NAMES) {
+        if (std::strcmp(value, entry.name) == 0) {
+            groupBy = entry.groupBy;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parseArgs(int argc, char** argv, RidequeryOptions& options) {
+    RideQuery& query = options.query;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr) {
+            return false;
+        }
+        if (std::strcmp(arg, "--seed") == 0) {
+            options.workload.seed = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--rides") == 0) {
+            options.rides = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--days") == 0) {
+            options.days = std::strtod(value, nullptr);
+        } else if (std::strcmp(arg, "--locations") == 0) {
+            options.workload.locationCount = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--threads") == 0) {
+            options.threads = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+        } else if (std::strcmp(arg, "--group-by") == 0) {
+            if (!parseGroupBy(value, query.groupBy)) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--type") == 0) {
+            query.filterType = true;
+            if (std::strcmp(value, "standard") == 0) {
+                query.type = RideType::Standard;
+            } else if (std::strcmp(value, "premium") == 0) {
+                query.type = RideType::Premium;
+            } else {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--status") == 0) {
+            query.filterStatus = true;
+            if (std::strcmp(value, "completed") == 0) {
+                query.status = RideStatus::Completed;
+            } else if (std::strcmp(value, "cancelled") == 0) {
+                query.status = RideStatus::Cancelled;
+            } else {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--pickup") == 0) {
+            query.pickup = value;
+        } else if (std::strcmp(arg, "--dropoff") == 0) {
+            query.dropoff = value;
+        } else if (std::strcmp(arg, "--last-days") == 0) {
+            options.lastDays = std::strtod(value, nullptr);
+        } else if (std::strcmp(arg, "--min-distance") == 0) {
+            query.minDistance = std::strtod(value, nullptr);
+        } else if (std::strcmp(arg, "--max-distance") == 0) {
+            query.maxDistance = std::strtod(value, nullptr);
+        } else if (std::strcmp(arg, "--limit") == 0) {
+            options.limit = std::strtoull(value, nullptr, 10);
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return options.rides > 0 && options.days > 0.0 && options.workload.locationCount > 1;
+}
+
+int main(int argc, char** argv) {
+    RidequeryOptions options;
+    if (!parseArgs(argc, argv, options)) {
+        std::cerr << "usage: " << argv[0] << " [--seed N] [--rides N] [--days N] [--locations N] [--threads N]"
+                  << " [--group-by none|pickup|dropoff|type|status|day|hour] [--type standard|premium]"
+                  << " [--status completed|cancelled] [--pickup NAME] [--dropoff NAME] [--last-days N]"
+                  << " [--min-distance MILES] [--max-distance MILES] [--limit N]" << std::endl;
+        return 2;
+    }
+
+    // Pace the workload so the rides span --days of virtual time.
+    WorkloadConfig& cfg = options.workload;
+    cfg.requestsPerSecond = options.rides / (options.days * 86400.0);
+    auto loadStart = std::chrono::steady_clock::now();
+    WorkloadGenerator generator(cfg);
+    RideColumns table;
+    table.reserve(options.rides);
+    for (std::uint32_t i = 0; i < generator.locationCount(); ++i) {
+        table.locationId(generator.locationName(i)); // column ids match generator indices
+    }
+    TimestampMs lastRequest = cfg.startTime;
+    for (std::size_t i = 0; i < options.rides; ++i) {
+        RideRequestEvent event = generator.next();
+        RideType type = event.premium ? RideType::Premium : RideType::Standard;
+        RideStatus status = i % 20 == 19 ? RideStatus::Cancelled : RideStatus::Completed;
+        table.appendRow(type, status, event.pickup, event.dropoff, event.distance, fareFor(type, event.distance),
+                        event.timestamp);
+        lastRequest = event.timestamp;
+    }
+    double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+    std::fprintf(stderr, "loaded %zu rides over %.1f days in %.2f s\n", table.size(), options.days, loadSeconds);
+
+    RideQuery& query = options.query;
+    if (options.lastDays > 0.0) {
+        query.requestedFrom = lastRequest - static_cast<TimestampMs>(options.lastDays * MS_PER_DAY);
+    }
+
+    std::vector<RideQueryRow> rows;
+    double bestSeconds = 0.0;
+    for (int run = 0; run < 3; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        table.query(query, rows, options.threads);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        bestSeconds = run == 0 || seconds < bestSeconds ? seconds : bestSeconds;
+    }
+    if (query.groupBy == RideGroupBy::Pickup || query.groupBy == RideGroupBy::Dropoff) {
+        std::stable_sort(rows.begin(), rows.end(),
+                         [](const RideQueryRow& a, const RideQueryRow& b) { return a.fare > b.fare; });
+    }
+
+    std::uint64_t matched = 0;
+    for (const RideQueryRow& row : rows) {
+        matched += row.rides;
+    }
+    std::printf("%-14s %12s %16s %10s %10s\n", "group", "rides", "fare", "avg fare", "avg miles");
+    for (std::size_t r = 0; r < rows.size() && r < options.limit; ++r) {
+        const RideQueryRow& row = rows[r];
+        std::printf("%-14s %12llu %16.2f %10.2f %10.2f\n", row.group.c_str(),
+                    static_cast<unsigned long long>(row.rides), row.fare, row.averageFare(), row.averageDistance());
+    }
+    if (rows.size() > options.limit) {
+        std::printf("(%zu more groups)\n", rows.size() - options.limit);
+    }
+    std::printf("query:           %llu of %zu rides matched, %zu groups in %.1f ms (%.0f M rides/s)\n",
+                static_cast<unsigned long long>(matched), table.size(), rows.size(), bestSeconds * 1000.0,
+                table.size() / bestSeconds / 1e6);
+    return 0;
+}